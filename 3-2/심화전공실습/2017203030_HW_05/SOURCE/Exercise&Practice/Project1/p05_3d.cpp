@@ -1,4 +1,5 @@
 #include "glSetup.h"
+#include "offReader.h"
 
 #ifdef	_WIN32
 #define _USE_MATH_DEFINES	// To include the definition of M_PI in math. h
@@ -9,7 +10,7 @@
 using namespace glm;
 
 #include <iostream>
-#include <fstream>
+#include <vector>
 #include <list>
 using namespace std;
 
@@ -255,22 +256,22 @@ bool
 readMesh(const char* filename)
 {
 	int countEdges = 0;
-	ifstream	is(filename);
-	if (is.fail()) return false;
+	MappedFile	mf;
+	if (!mapFile(filename, mf)) return false;
 
-	char	magicNumber[256];
-	is >> magicNumber;
-
-	// # vertices, # faces, # edges	
-	is >> nVertices >> nFaces >> nEdges;
+	// # vertices, # faces, # edges
+	const char*	body = parseOFFHeader(mf.data, mf.size, nVertices, nFaces, nEdges);
+	if (body == NULL) { unmapFile(mf); return false; }
 	cout << "# vertices = " << nVertices << endl;
 	cout << "# faces = " << nFaces << endl;
 	cout << "# edge = " << nEdges << endl;
 
-	// Vertices
+	// Vertices and faces with the parallel scanner: vec3 is 3 packed floats
 	vertex = new vec3[nVertices];
-	for (int i = 0; i < nVertices; i++)
-		is >> vertex[i].x >> vertex[i].y >> vertex[i].z;
+	vector<int>	corner(3 * size_t(nFaces));	// Only support triangles
+	bool	parsed = parseOFFBody(body, mf.data + mf.size, nVertices, nFaces, (float*)vertex, corner.data());
+	unmapFile(mf);
+	if (!parsed) { nVertices = nFaces = 0; return false; }
 
 	// Faces
 	face[0] = new int[nFaces];	// Only support triangles
@@ -279,9 +280,10 @@ readMesh(const char* filename)
 
 	head = new list<int>[nVertices];
 
-	int n;
 	for (int i = 0; i < nFaces; i++) {
-		is >> n >> face[0][i] >> face[1][i] >> face[2][i];
+		face[0][i] = corner[3 * i];
+		face[1][i] = corner[3 * i + 1];
+		face[2][i] = corner[3 * i + 2];
 
 		for (int j = 0; j < 2; j++) {
 			for (int k = j + 1; k < 3; k++) {
@@ -308,9 +310,6 @@ readMesh(const char* filename)
 			head[face[1][i]].push_back(face[2][i]);
 			countEdges++;
 		}
-
-
-		if (n != 3) cout << "# vertices of the " << i << "-th faces = " << n << endl;
 	}
 	cout << "# countEdges = " << countEdges << endl;
 	return true;
@@ -0,0 +1,38 @@
+#ifndef _OFF_READER_H_
+#define _OFF_READER_H_
+
+#include <stddef.h>
+
+// Memory mapping of a whole file
+struct MappedFile
+{
+	char*		data;	// First byte of the file
+	size_t		size;	// # bytes
+
+#ifdef _WIN32
+	void*	file;		// HANDLE of the file
+	void*	mapping;	// HANDLE of the file mapping
+#else
+	int		fd;			// File descriptor
+#endif
+
+	MappedFile();
+};
+
+bool	mapFile(const char* filename, MappedFile& mf);
+
+void	unmapFile(MappedFile& mf);
+
+// Parse the header and return the first byte of the body, or NULL for a malformed header
+const char*	parseOFFHeader(const char* data, size_t size, int& nVertices, int& nFaces, int& nEdges);
+
+// Parse one vertex or face record skipping blank lines and comments.
+// Return the beginning of the next line, or NULL for a malformed record.
+const char*	scanVertexRecord(const char* p, const char* end, float v[3]);
+const char*	scanFaceRecord(const char* p, const char* end, int f[3], int& n);
+
+// Parse the body after the header into caller-owned arrays of 3 x nVertices floats and
+// 3 x nFaces ints with a line-aligned parallel scanner. Returns false for a malformed body.
+bool	parseOFFBody(const char* p, const char* end, int nVertices, int nFaces, float* vertex, int* face);
+
+#endif	// _OFF_READER_H_
@@ -1,11 +1,12 @@
 #include "glSetup.h"
+#include "offReader.h"
 
 #include <glm/glm.hpp>	// OpenGL Mathematics
 #include <glm/gtc/type_ptr.hpp>	// glm: : value_ptr()
 using namespace glm;
 
 #include <iostream>
-#include <fstream>
+#include <vector>
 using namespace std;
 
 void init();
@@ -219,21 +220,21 @@ int* face[3] = { NULL, NULL, NULL };
 bool
 readMesh(const char* filename)
 {
-	ifstream	is(filename);
-	if (is.fail()) return false;
-
-	char	magicNumber[256];
-	is >> magicNumber;
+	MappedFile	mf;
+	if (!mapFile(filename, mf)) return false;
 
 	// # vertices, # faces, # edges
-	is >> nVertices >> nFaces >> nEdges;
+	const char*	body = parseOFFHeader(mf.data, mf.size, nVertices, nFaces, nEdges);
+	if (body == NULL) { unmapFile(mf); return false; }
 	cout << "# vertices = " << nVertices << endl;
 	cout << "# faces = " << nFaces << endl;
 
-	// Vertices
+	// Vertices and faces with the parallel scanner: glm::vec3 is 3 packed floats
 	vertex = new glm::vec3[nVertices];
-	for (int i = 0; i < nVertices; i++)
-		is >> vertex[i].x >> vertex[i].y >> vertex[i].z;
+	vector<int>	corner(3 * size_t(nFaces));	// Only support triangles
+	bool	parsed = parseOFFBody(body, mf.data + mf.size, nVertices, nFaces, (float*)vertex, corner.data());
+	unmapFile(mf);
+	if (!parsed) { nVertices = nFaces = 0; return false; }
 
 	// Vertex normals
 	vnormal = new glm::vec3[nVertices];
@@ -248,12 +249,12 @@ readMesh(const char* filename)
 	face[1] = new int[nFaces];
 	face[2] = new int[nFaces];
 	
-	int n;
 	for (int i = 0; i < nFaces; i++)
 	{
-		is >> n >> face[0][i] >> face[1][i] >> face[2][i];
+		face[0][i] = corner[3 * i];
+		face[1][i] = corner[3 * i + 1];
+		face[2][i] = corner[3 * i + 2];
 		
-		if (n != 3) cout << "# vertices of the " << i << "-th faces = " << n << endl;
 
 		// Normal vector of the face
 		glm::vec3	v1 = vertex[face[1][i]] - vertex[face[0][i]];
@@ -0,0 +1,108 @@
+#include "meshVBO.h"
+
+#include <vector>
+
+#include <iostream>
+using namespace std;
+
+static bool
+isOK(const char* message)
+{
+	GLenum	error = glGetError();
+	if (error == GL_NO_ERROR) return true;
+
+	cerr << "ERROR: " << message << " with " << gluErrorString(error) << endl;
+	return false;
+}
+
+bool
+uploadMeshVBO(int numVertices, const GLfloat* vertex, const GLfloat* normal, int numTris, const GLuint* index,
+	MeshVBO& vbo)
+{
+	deleteMeshVBO(vbo);
+
+	glGenBuffers(1, &vbo.vertexId);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.vertexId);
+	glBufferData(GL_ARRAY_BUFFER, 3 * numVertices * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &vbo.normalId);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.normalId);
+	glBufferData(GL_ARRAY_BUFFER, 3 * numVertices * sizeof(GLfloat), normal, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &vbo.indexId);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.indexId);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, 3 * numTris * sizeof(GLuint), index, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	vbo.numTris = numTris;
+	vbo.numVertices = numVertices;
+
+	return isOK("uploadMeshVBO()");
+}
+
+bool
+uploadFlatMeshVBO(const GLfloat* vertex, int numTris, const GLuint* index, const GLfloat* faceNormal,
+	MeshVBO& vbo)
+{
+	// Split the shared vertices so that each corner carries the normal of its face
+	vector<GLfloat>	position(9 * numTris);
+	vector<GLfloat>	normal(9 * numTris);
+	for (int i = 0; i < numTris; i++)
+		for (int j = 0; j < 3; j++)
+			for (int k = 0; k < 3; k++)
+			{
+				position[9 * i + 3 * j + k] = vertex[3 * index[3 * i + j] + k];
+				normal[9 * i + 3 * j + k] = faceNormal[3 * i + k];
+			}
+
+	deleteMeshVBO(vbo);
+
+	glGenBuffers(1, &vbo.vertexId);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.vertexId);
+	glBufferData(GL_ARRAY_BUFFER, position.size() * sizeof(GLfloat), position.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &vbo.normalId);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.normalId);
+	glBufferData(GL_ARRAY_BUFFER, normal.size() * sizeof(GLfloat), normal.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	vbo.numTris = numTris;
+	vbo.numVertices = 3 * numTris;
+
+	return isOK("uploadFlatMeshVBO()");
+}
+
+void
+drawMeshVBO(const MeshVBO& vbo)
+{
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.vertexId);
+	glVertexPointer(3, GL_FLOAT, 0, 0);
+
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.normalId);
+	glNormalPointer(GL_FLOAT, 0, 0);
+
+	if (vbo.indexId)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.indexId);
+		glDrawElements(GL_TRIANGLES, 3 * vbo.numTris, GL_UNSIGNED_INT, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	else	glDrawArrays(GL_TRIANGLES, 0, vbo.numVertices);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void
+deleteMeshVBO(MeshVBO& vbo)
+{
+	if (vbo.vertexId)	glDeleteBuffers(1, &vbo.vertexId);
+	if (vbo.normalId)	glDeleteBuffers(1, &vbo.normalId);
+	if (vbo.indexId)	glDeleteBuffers(1, &vbo.indexId);
+
+	vbo = MeshVBO();
+}
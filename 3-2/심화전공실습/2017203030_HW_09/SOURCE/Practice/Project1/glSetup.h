@@ -1,10 +1,14 @@
 #ifndef __GL_SETUP_H_
 #define __GL_SETUP_H_
 
+#include <GL/glew.h>	// Before gl.h
+
 #if defined(__APPLE__)  && defined(__MACH__)
 	#include <OpenGL/glu.h>
 #else
+	#ifdef _WIN32
 	#include <windows.h>
+	#endif
 	#include <GL/glu.h>
 #endif
 
@@ -18,6 +22,41 @@ extern float	dpiScaling;
 
 extern int vsync;
 
+// Headless mode for machines without a display, e.g. CI and render nodes:
+//	--headless[=egl|osmesa]	or the environment variable GL_HEADLESS=egl|osmesa
+//	--size=WxH				framebuffer size, 1280x720 by default
+//	--frames=N				frames to draw before closing, 300 by default
+//	--output=file.ppm		last frame to save
+// The context comes from EGL without a surface or from OSMesa, and the frames are
+// drawn into a framebuffer object of the requested size and read back by swapBuffers().
+extern bool		headless;
+extern int		headlessFrames;
+
+void		swapBuffers(GLFWwindow* window);	// glfwSwapBuffers() or the readback in the headless mode
+
+// Profiler enabled by --profile, --trace=file.json or GL_PROFILE=1:
+//	PROFILE_ZONE("name")		CPU time of the enclosing scope
+//	PROFILE_GPU_ZONE("name")	and its GPU time by timestamp queries read back frames later
+// swapBuffers() delimits the frames and draws the frame-time graph over the bottom left
+// with the CPU and GPU p50/p95/p99 on it and in the title. At the end the percentiles
+// are printed and the zones are saved in the Chrome trace-event format. The names must
+// be string literals.
+extern bool		profiling;
+
+void		profileBeginZone(const char* name, bool gpu);
+void		profileEndZone();
+
+struct ProfileScope
+{
+	ProfileScope(const char* name, bool gpu) { profileBeginZone(name, gpu); }
+	~ProfileScope() { profileEndZone(); }
+};
+
+#define PROFILE_CONCAT_(a, b)	a##b
+#define PROFILE_CONCAT(a, b)	PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name)		ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, false)
+#define PROFILE_GPU_ZONE(name)	ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+
 extern bool		perspectiveView;
 extern float	fovy;
 extern float	nearDist;
@@ -0,0 +1,385 @@
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX				// Keep min/max away from Eigen
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "offReader.h"
+
+#ifdef _OPENMP
+#include <omp.h>	// OpenMP for parallel parsing
+#endif
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include <iostream>
+using namespace std;
+
+MappedFile::MappedFile()
+{
+	data = NULL;
+	size = 0;
+
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#else
+	fd = -1;
+#endif
+}
+
+bool
+mapFile(const char* filename, MappedFile& mf)
+{
+#ifdef _WIN32
+	HANDLE	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER	size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void*	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mf.file = file;
+	mf.mapping = mapping;
+	mf.data = (char*)data;
+	mf.size = size_t(size.QuadPart);
+#else
+	int	fd = open(filename, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat	st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void*	data = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		close(fd);
+		return false;
+	}
+	madvise(data, size_t(st.st_size), MADV_SEQUENTIAL);
+
+	mf.fd = fd;
+	mf.data = (char*)data;
+	mf.size = size_t(st.st_size);
+#endif
+
+	return true;
+}
+
+void
+unmapFile(MappedFile& mf)
+{
+	if (mf.data == NULL) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(mf.data);
+	CloseHandle(mf.mapping);
+	CloseHandle(mf.file);
+	mf.file = INVALID_HANDLE_VALUE;
+	mf.mapping = NULL;
+#else
+	munmap(mf.data, mf.size);
+	close(mf.fd);
+	mf.fd = -1;
+#endif
+
+	mf.data = NULL;
+	mf.size = 0;
+}
+
+// Scanners: locale-independent and without any stream overhead
+//
+static inline bool	isDigit(char c) { return c >= '0' && c <= '9'; }
+static inline bool	isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static inline void
+skipBlanks(const char*& p, const char* end)
+{
+	while (p < end && isBlank(*p)) p++;
+}
+
+// Skip white spaces, new lines and comments
+static inline void
+skipSpaces(const char*& p, const char* end)
+{
+	while (p < end)
+	{
+		if (isBlank(*p) || *p == '\n') p++;
+		else if (*p == '#') { while (p < end && *p != '\n') p++; }
+		else break;
+	}
+}
+
+static inline bool
+scanInt(const char*& p, const char* end, int& i)
+{
+	skipBlanks(p, end);
+
+	bool	negative = false;
+	if (p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); p++; }
+	if (p == end || !isDigit(*p)) return false;
+
+	int		value = 0;
+	for (; p < end && isDigit(*p); p++)
+		value = value * 10 + (*p - '0');
+
+	i = negative ? -value : value;
+	return true;
+}
+
+// Exact powers of ten in double precision
+static const double	pow10Table[23] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool
+scanFloat(const char*& p, const char* end, float& f)
+{
+	skipBlanks(p, end);
+
+	bool	negative = false;
+	if (p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); p++; }
+
+	// Up to 19 significant digits fit in the 64-bit mantissa.
+	uint64_t	mantissa = 0;
+	int		nDigits = 0, exponent = 0;
+	bool	any = false;
+
+	for (; p < end && isDigit(*p); p++, any = true)
+	{
+		if (nDigits < 19)	{ mantissa = mantissa * 10 + (*p - '0'); if (mantissa) nDigits++; }
+		else				exponent++;
+	}
+
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && isDigit(*p); p++, any = true)
+		{
+			if (nDigits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) nDigits++; exponent--; }
+		}
+	}
+	if (!any) return false;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+		int	e = 0;
+		if (!scanInt(p, end, e)) return false;
+		exponent += e;
+	}
+
+	double	value = double(mantissa);
+	while (exponent > 22)	{ value *= 1e22;	exponent -= 22; }
+	while (exponent < -22)	{ value /= 1e22;	exponent += 22; }
+	if (exponent >= 0)	value *= pow10Table[exponent];
+	else				value /= pow10Table[-exponent];
+
+	f = float(negative ? -value : value);
+	return true;
+}
+
+// Does the line starting at p hold a record, i.e. neither blank nor a comment?
+static inline bool
+isRecord(const char* p, const char* end)
+{
+	skipBlanks(p, end);
+	return p < end && *p != '\n' && *p != '#';
+}
+
+static inline const char*
+nextLine(const char* p, const char* end)
+{
+	const char*	q = (const char*)memchr(p, '\n', end - p);
+	return q ? q + 1 : end;
+}
+
+const char*
+parseOFFHeader(const char* data, size_t size, int& nVertices, int& nFaces, int& nEdges)
+{
+	const char*	p = data;
+	const char*	end = data + size;
+
+	// Magic number
+	skipSpaces(p, end);
+	if (end - p < 3 || strncmp(p, "OFF", 3) != 0)
+	{
+		cerr << "ERROR: Not an OFF file" << endl;
+		return NULL;
+	}
+	p = nextLine(p, end);
+
+	// # vertices, # faces, # edges
+	nVertices = nFaces = nEdges = 0;
+	skipSpaces(p, end);
+	if (!scanInt(p, end, nVertices) || !scanInt(p, end, nFaces) || nVertices < 0 || nFaces < 0)
+	{
+		cerr << "ERROR: Invalid OFF header" << endl;
+		return NULL;
+	}
+	scanInt(p, end, nEdges);	// Optional
+
+	return nextLine(p, end);
+}
+
+// Skip blank and comment lines
+static inline const char*
+nextRecord(const char* p, const char* end)
+{
+	while (p < end && !isRecord(p, end)) p = nextLine(p, end);
+	return p;
+}
+
+const char*
+scanVertexRecord(const char* p, const char* end, float v[3])
+{
+	p = nextRecord(p, end);
+	if (p == end) return NULL;
+
+	if (!scanFloat(p, end, v[0]) || !scanFloat(p, end, v[1]) || !scanFloat(p, end, v[2])) return NULL;
+
+	return nextLine(p, end);
+}
+
+const char*
+scanFaceRecord(const char* p, const char* end, int f[3], int& n)
+{
+	p = nextRecord(p, end);
+	if (p == end) return NULL;
+
+	if (!scanInt(p, end, n) || !scanInt(p, end, f[0]) || !scanInt(p, end, f[1]) || !scanInt(p, end, f[2])) return NULL;
+
+	return nextLine(p, end);
+}
+
+bool
+parseOFFBody(const char* p, const char* end, int nVertices, int nFaces, float* vertex, int* face)
+{
+	// Split the body into chunks at line boundaries, a few per thread for load balancing
+	const size_t	chunkSize = 64 * 1024;
+	int		nThreads = 1;
+#ifdef _OPENMP
+	nThreads = omp_get_max_threads();
+#endif
+	int		nChunks = int((end - p) / chunkSize) + 1;
+	if (nChunks > 4 * nThreads) nChunks = 4 * nThreads;
+
+	vector<const char*>	chunk(nChunks + 1);
+	chunk[0] = p;
+	chunk[nChunks] = end;
+	for (int i = 1; i < nChunks; i++)
+	{
+		const char*	q = p + (end - p) * i / nChunks;
+		if (q < chunk[i - 1]) q = chunk[i - 1];
+		chunk[i] = (q > p && q[-1] == '\n') ? q : nextLine(q, end);
+	}
+
+	// Pass 1: count the records in each chunk
+	vector<int>	first(nChunks + 1, 0);
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < nChunks; i++)
+	{
+		int	count = 0;
+		for (const char* q = chunk[i]; q < chunk[i + 1]; q = nextLine(q, chunk[i + 1]))
+			if (isRecord(q, chunk[i + 1])) count++;
+		first[i + 1] = count;
+	}
+
+	// Prefix sum gives the global record index where each chunk starts
+	for (int i = 0; i < nChunks; i++)
+		first[i + 1] += first[i];
+
+	if (first[nChunks] < nVertices + nFaces)
+	{
+		cerr << "ERROR: Unexpected end of the OFF file" << endl;
+		return false;
+	}
+
+	// Pass 2: parse the vertices and faces of each chunk independently
+	vector<int>	nErrors(nChunks, 0);
+	vector<int>	nNonTriangles(nChunks, 0);
+
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < nChunks; i++)
+	{
+		int	r = first[i];
+		if (r >= nVertices + nFaces) continue;
+
+		for (const char* q = chunk[i]; q < chunk[i + 1]; q = nextLine(q, chunk[i + 1]))
+		{
+			if (!isRecord(q, chunk[i + 1])) continue;
+			if (r >= nVertices + nFaces) break;
+
+			const char*	s = q;
+			if (r < nVertices)
+			{
+				float*	v = vertex + 3 * size_t(r);
+				if (!scanFloat(s, chunk[i + 1], v[0]) || !scanFloat(s, chunk[i + 1], v[1])
+					|| !scanFloat(s, chunk[i + 1], v[2]))
+					nErrors[i]++;
+			}
+			else
+			{
+				int		k = r - nVertices;
+				int		n = 0;
+				int*	f = face + 3 * size_t(k);
+				if (!scanInt(s, chunk[i + 1], n) || !scanInt(s, chunk[i + 1], f[0])
+					|| !scanInt(s, chunk[i + 1], f[1]) || !scanInt(s, chunk[i + 1], f[2]))
+					nErrors[i]++;
+				else if (f[0] < 0 || f[0] >= nVertices || f[1] < 0 || f[1] >= nVertices
+					|| f[2] < 0 || f[2] >= nVertices)
+					nErrors[i]++;
+				if (n != 3) nNonTriangles[i]++;
+			}
+			r++;
+		}
+	}
+
+	int	errors = 0, nonTriangles = 0;
+	for (int i = 0; i < nChunks; i++)
+	{
+		errors += nErrors[i];
+		nonTriangles += nNonTriangles[i];
+	}
+
+	if (nonTriangles > 0) cout << "# non-triangular faces = " << nonTriangles << endl;
+	if (errors > 0)
+	{
+		cerr << "ERROR: " << errors << " malformed records in the OFF file" << endl;
+		return false;
+	}
+
+	return true;
+}
@@ -1,4 +1,6 @@
 #include "glSetup.h"
+#include "meshVBO.h"
+#include "offReader.h"
 
 #ifdef	_WIN32
 #define _USE_MATH_DEFINES	// To include the definition of M_PI in math. h
@@ -9,7 +11,7 @@
 using namespace glm;
 
 #include <iostream>
-#include <fstream>
+#include <vector>
 using namespace std;
 
 void init();
@@ -19,6 +21,8 @@ void keyboard(GLFWwindow* window, int key, int code, int action, int mods);
 
 bool readMesh(const char* filename);
 void deleteMesh();
+void uploadMesh();
+void benchmarkDrawMesh(GLFWwindow* window, int nFrames = 300);
 
 // Camera configuation
 struct Camera {
@@ -50,6 +54,11 @@ float fovys[6] = { 46.4f, 37.8f, 27.0f, 16.1f, 11.4f, 6.9f };
 int m_fovys = 6;
 int i_fovys = 1;
 
+// Retained VBOs uploaded once, or immediate mode for comparison
+MeshVBO	flatVBO;
+MeshVBO	smoothVBO;
+bool	retained = true;
+
 int
 main(int argc, char* argv[])
 {
@@ -89,7 +98,7 @@ main(int argc, char* argv[])
 		glfwPollEvents();	// Events
 
 		render(window);		// Draw one frame
-		glfwSwapBuffers(window);	// Swap buffers
+		swapBuffers(window);	// Swap buffers
 	}
 
 	// Finalization
@@ -121,12 +130,15 @@ init()
 
 	// Prepare mesh
 	readMesh("m01_bunny.off");
+	uploadMesh();
 
 	// Keyboard
 	cout << endl;
 	cout << "Keyboard input :	up, down, left, right for viewing" << endl;
 	cout << "Keyboard input :	p for perspective/orthographic viewing" << endl;
 	cout << "Keyboard input :	f to change field of view angle" << endl;
+	cout << "Keyboard input :	r for the retained VBO/immediate mode" << endl;
+	cout << "Keyboard input :	b for the frame rates of both" << endl;
 	cout << endl;
 	cout << "Keyboard input :	1 for a spheres" << endl;
 	cout << "Keyboard input :	2 for a flat bunnies" << endl;
@@ -141,6 +153,8 @@ quit()
 
 	// Delete mesh
 	deleteMesh();
+	deleteMeshVBO(flatVBO);
+	deleteMeshVBO(smoothVBO);
 }
 
 // Material
@@ -176,22 +190,21 @@ int* face[3] = { NULL, NULL, NULL };
 bool
 readMesh(const char* filename)
 {
-	ifstream	is(filename);
-	if (is.fail()) return false;
-
-	char	magicNumber[256];
-	is >> magicNumber;
+	MappedFile	mf;
+	if (!mapFile(filename, mf)) return false;
 
 	// # vertices, # faces, # edges
-	is >> nVertices >> nFaces >> nEdges;
+	const char*	body = parseOFFHeader(mf.data, mf.size, nVertices, nFaces, nEdges);
+	if (body == NULL) { unmapFile(mf); return false; }
 	cout << "# vertices = " << nVertices << endl;
 	cout << "# faces = " << nFaces << endl;
 
-	// Vertices
+	// Vertices and faces with the parallel scanner: vec3 is 3 packed floats
 	vertex = new vec3[nVertices];
-
-	for (int i = 0; i < nVertices; i++)
-		is >> vertex[i].x >> vertex[i].y >> vertex[i].z;
+	vector<int>	corner(3 * size_t(nFaces));	// Only support triangles
+	bool	parsed = parseOFFBody(body, mf.data + mf.size, nVertices, nFaces, (float*)vertex, corner.data());
+	unmapFile(mf);
+	if (!parsed) { nVertices = nFaces = 0; return false; }
 
 	// Vertex normals
 	vnormal = new vec3[nVertices];
@@ -206,11 +219,11 @@ readMesh(const char* filename)
 	face[1] = new int[nFaces];
 	face[2] = new int[nFaces];
 
-	int n;
 	for (int i = 0; i < nFaces; i++)
 	{
-		is >> n >> face[0][i] >> face[1][i] >> face[2][i];
-		if (n != 3) cout << "# vertices of the	" << i << "- th faces = " << n << endl;
+		face[0][i] = corner[3 * i];
+		face[1][i] = corner[3 * i + 1];
+		face[2][i] = corner[3 * i + 2];
 
 		// Normal vector of the face
 		vec3	v1 = vertex[face[1][i]] - vertex[face[0][i]];
@@ -243,10 +256,29 @@ deleteMesh()
 	if (face[2]) { delete[] face[2]; face[2] = NULL; }
 }
 
+// Upload the mesh to the VBOs: split vertices with the face normals for flat shading
+void
+uploadMesh()
+{
+	vector<GLuint>	index(3 * nFaces);
+	for (int i = 0; i < nFaces; i++)
+		for (int j = 0; j < 3; j++)
+			index[3 * i + j] = face[j][i];
+
+	uploadFlatMeshVBO(value_ptr(vertex[0]), nFaces, index.data(), value_ptr(fnormal[0]), flatVBO);
+	uploadMeshVBO(nVertices, value_ptr(vertex[0]), value_ptr(vnormal[0]), nFaces, index.data(), smoothVBO);
+}
+
 // Draw a flat mesh by specifying its face normal vectors
 void
 drawFlatMesh()
 {
+	if (retained)
+	{
+		drawMeshVBO(flatVBO);
+		return;
+	}
+
 	// Geometry
 	glBegin(GL_TRIANGLES);
 	for (int i = 0; i < nFaces; i++)
@@ -262,6 +294,12 @@ drawFlatMesh()
 void
 drawSmoothMesh()
 {
+	if (retained)
+	{
+		drawMeshVBO(smoothVBO);
+		return;
+	}
+
 	// Geometry
 	glBegin(GL_TRIANGLES);
 	for (int i = 0; i < nFaces; i++)
@@ -355,6 +393,15 @@ keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
 			reshape(window, windowW, windowH);
 			break;
 
+			// Retained VBO/immediate mode
+		case GLFW_KEY_R:
+			retained = !retained;
+			cout << (retained ? "Retained VBO" : "Immediate mode") << endl;
+			break;
+
+			// Frame rates of both
+		case GLFW_KEY_B:	benchmarkDrawMesh(window);	break;
+
 			// Example selection
 		case GLFW_KEY_1:	selection = 1;	break;
 		case GLFW_KEY_2:	selection = 2;	break;
@@ -383,4 +430,37 @@ keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
 		case GLFW_KEY_RIGHT:	cout << "right turn" << endl;
 		}
 	}
-}
\ No newline at end of file
+}
+
+// Frame rates of the immediate mode and the retained VBOs drawing the same frames
+void
+benchmarkDrawMesh(GLFWwindow* window, int nFrames)
+{
+	bool	current = retained;
+	double	fps[2];
+
+	glfwSwapInterval(0);	// Without waiting for the vertical sync
+	for (int k = 0; k < 2; k++)
+	{
+		retained = (k == 1);
+
+		render(window);		// Warm up
+		glFinish();
+
+		double	t0 = glfwGetTime();
+		for (int i = 0; i < nFrames; i++)
+		{
+			render(window);
+			glfwSwapBuffers(window);
+		}
+		glFinish();
+		fps[k] = nFrames / (glfwGetTime() - t0);
+	}
+	glfwSwapInterval(vsync);
+	retained = current;
+
+	cout << "Benchmark: " << nFaces << " triangles, " << nFrames << " frames" << endl;
+	cout << "  immediate : " << fps[0] << " fps" << endl;
+	cout << "  retained  : " << fps[1] << " fps" << endl;
+	cout << "  speedup   : " << fps[1] / fps[0] << "x" << endl;
+}
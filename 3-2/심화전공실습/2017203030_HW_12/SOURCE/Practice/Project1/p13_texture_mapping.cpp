@@ -1,5 +1,6 @@
 #include <GL/glew.h>				// OpenGL Extension Wrangler Library
 #include "glSetup.h"
+#include "textureStream.h"
 
 #include <glm/glm.hpp>				// OpenGL Mathematics
 #include <glm/gtc/type_ptr.hpp>		// glm: :value_ptr()
@@ -67,6 +68,9 @@ float floorSize = 400;
 // OpenGL texture unit
 GLuint texID[4];
 
+// Raw textures read and uploaded in the background
+TextureStreamer	textureStreamer;
+
 // Texture parameters
 bool	texture = true;	// Texture on/off
 float textureNumRepeats = 1;
@@ -137,9 +141,15 @@ main(int argc, char* argv[])
 			elapsed = 0;	// Reset the elapsed time
 		}
 
+		// Upload the texture levels arrived, at most 1 ms per frame
+		updateTextureStreamer(textureStreamer, 0.001);
+
 		render(window);	// Draw one frame
 		glfwSwapBuffers(window);	// Swap buffers 141
 	}
+	// Finalization
+	deleteTextureStreamer(textureStreamer);
+
 	// Terminate the glfw system
 	glfwDestroyWindow(window);
 	glfwTerminate();
@@ -196,37 +206,15 @@ loadDemonHeadTexture()
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
 
+// Streamed to the bound texture in the background, a single channel as gray
 bool
 loadRawTexture(const char* filename, int w, int h, int n)
 {
-	// Open the raw texture file
-	ifstream	is(filename, ios::binary);
-	if (is.fail())
-	{
-		cout << "Can't open	" << filename << endl;
-		return false;
-	}
-
-	// Allocate memory
-	GLubyte* raw = new GLubyte[w * h * n];
-
-	// Read all the texels
-	is.read((char*)raw, w * h * n);
-	if (!is)	cout << "Error: only " << is.gcount() << "bytes could be read!" << endl;
-
 	//Only 3 and 1
-	if (n == 3)
-	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, raw);
-	}
-	else if (n == 1)
-	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, w, h, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, raw);
-	}
+	if (n != 3 && n != 1) return false;	// Not supporting 2 channels
 
-	else {
-		// Not supporting 2 channels
-	}
+	GLint	texture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
 
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -234,8 +222,14 @@ loadRawTexture(const char* filename, int w, int h, int n)
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	// Deallocate memory
-	delete[]	raw;
+	TextureStreamRequest	request;
+	request.texture = texture;
+	request.filename = filename;
+	request.w = w;
+	request.h = h;
+	request.n = n;
+	request.internalFormat = GL_RGB8;
+	streamTexture(textureStreamer, request);
 
 	return true;
 }
@@ -324,7 +318,9 @@ init()
 	glBindTexture(GL_TEXTURE_2D, texID[1]);
 	loadDemonHeadTexture();
 
-	// Raw texture
+	// Raw texture read by the workers, with its mipmaps
+	createTextureStreamer(textureStreamer);
+
 	glBindTexture(GL_TEXTURE_2D, texID[2]);
 	loadRawTexture("m02_marble.raw", 512, 512, 3);
 
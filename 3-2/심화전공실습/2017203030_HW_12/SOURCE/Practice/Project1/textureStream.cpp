@@ -0,0 +1,424 @@
+#include "textureStream.h"
+
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+// Ring of the pixel unpack buffers
+static const int	NUM_BUFFERS = 4;
+static const size_t	BUFFER_SIZE = 1 << 20;
+
+// Bytes copied at once, small enough to check the time budget often
+static const size_t	STRIP_SIZE = 256 << 10;
+
+static double
+now()
+{
+	return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Read the raw file, expand it to RGBA and build the mipmap chain by averaging 2 x 2 texels
+static void
+decodeTexture(TextureStreamImage* img)
+{
+	const TextureStreamRequest&	r = img->request;
+
+	ifstream	is(r.filename.c_str(), ios::binary);
+	if (is.fail()) return;
+
+	int		nTexels = r.w * r.h;
+	vector<GLubyte>	raw(nTexels * r.n, 0);
+	is.read((char*)&raw[0], raw.size());
+	img->nRead = size_t(is.gcount());
+
+	img->levels.push_back(vector<GLubyte>(4 * nTexels));
+	img->lw.push_back(r.w);
+	img->lh.push_back(r.h);
+
+	GLubyte*	p = &img->levels[0][0];
+	for (int i = 0; i < nTexels; i++, p += 4)
+	{
+		if (r.n >= 3)
+		{
+			p[0] = raw[r.n * i + 0];
+			p[1] = raw[r.n * i + 1];
+			p[2] = raw[r.n * i + 2];
+			p[3] = (r.n == 4) ? raw[4 * i + 3] : 255;
+		}
+		else if (r.alphaOnly)
+		{
+			p[0] = r.color[0];
+			p[1] = r.color[1];
+			p[2] = r.color[2];
+			p[3] = raw[i];
+		}
+		else
+		{
+			p[0] = p[1] = p[2] = raw[i];
+			p[3] = 255;
+		}
+	}
+
+	// Down to 1 x 1, clamping at the odd edges
+	while (img->lw.back() > 1 || img->lh.back() > 1)
+	{
+		int	w = img->lw.back(), h = img->lh.back();
+		int	nw = w > 1 ? w / 2 : 1, nh = h > 1 ? h / 2 : 1;
+
+		vector<GLubyte>	next(4 * nw * nh);
+		const vector<GLubyte>&	prev = img->levels.back();
+		for (int y = 0; y < nh; y++)
+		{
+			int	y0 = 2 * y, y1 = (2 * y + 1 < h) ? 2 * y + 1 : h - 1;
+			for (int x = 0; x < nw; x++)
+			{
+				int	x0 = 2 * x, x1 = (2 * x + 1 < w) ? 2 * x + 1 : w - 1;
+				for (int c = 0; c < 4; c++)
+				{
+					int	sum = prev[4 * (y0 * w + x0) + c] + prev[4 * (y0 * w + x1) + c]
+						+ prev[4 * (y1 * w + x0) + c] + prev[4 * (y1 * w + x1) + c];
+					next[4 * (y * nw + x) + c] = GLubyte((sum + 2) / 4);
+				}
+			}
+		}
+
+		img->levels.push_back(vector<GLubyte>());
+		img->levels.back().swap(next);
+		img->lw.push_back(nw);
+		img->lh.push_back(nh);
+	}
+
+	img->ok = true;
+}
+
+static void
+worker(TextureStreamer* ts)
+{
+	for (;;)
+	{
+		TextureStreamRequest	request;
+		{
+			unique_lock<mutex>	lock(ts->mutex);
+			ts->wakeUp.wait(lock, [ts] { return ts->quit || !ts->requests.empty(); });
+			if (ts->quit) return;
+
+			request = ts->requests.front();
+			ts->requests.pop_front();
+		}
+
+		TextureStreamImage*	img = new TextureStreamImage;
+		img->request = request;
+		decodeTexture(img);
+
+		lock_guard<mutex>	lock(ts->mutex);
+		ts->decoded.push_back(img);
+	}
+}
+
+void
+createTextureStreamer(TextureStreamer& ts, int nWorkers)
+{
+	// Fences for the buffers, and mapping them for all the frames if possible
+	ts.mode = STREAM_DIRECT;
+	if ((GLEW_VERSION_3_2 || GLEW_ARB_sync) && (GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range))
+		ts.mode = (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) ? STREAM_PERSISTENT : STREAM_MAPPED;
+
+	if (ts.mode != STREAM_DIRECT)
+	{
+		GLbitfield	flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		ts.buffers.resize(NUM_BUFFERS);
+		for (int i = 0; i < NUM_BUFFERS; i++)
+		{
+			TextureStreamBuffer&	b = ts.buffers[i];
+			glGenBuffers(1, &b.pbo);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b.pbo);
+			if (ts.mode == STREAM_PERSISTENT)
+			{
+				glBufferStorage(GL_PIXEL_UNPACK_BUFFER, BUFFER_SIZE, NULL, flags);
+				b.ptr = (GLubyte*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, BUFFER_SIZE, flags);
+				if (b.ptr == NULL)
+				{
+					cerr << "ERROR: Fail in mapping the texture streaming buffer persistently" << endl;
+					ts.mode = STREAM_MAPPED;
+				}
+			}
+			else glBufferData(GL_PIXEL_UNPACK_BUFFER, BUFFER_SIZE, NULL, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		// All or none of the buffers persistently mapped
+		if (ts.mode == STREAM_MAPPED)
+			for (int i = 0; i < NUM_BUFFERS; i++)
+				if (ts.buffers[i].ptr)
+				{
+					glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ts.buffers[i].pbo);
+					glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+					ts.buffers[i].ptr = NULL;
+				}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	ts.current = 0;
+
+	if (nWorkers <= 0)
+	{
+		nWorkers = int(thread::hardware_concurrency()) - 1;
+		if (nWorkers < 1) nWorkers = 1;
+		if (nWorkers > 4) nWorkers = 4;
+	}
+
+	ts.quit = false;
+	for (int i = 0; i < nWorkers; i++)
+		ts.workers.push_back(thread(worker, &ts));
+
+	const char*	modeName[] = { "direct", "mapped", "persistently mapped" };
+	cerr << "Status: Texture streaming with " << nWorkers << " workers and "
+		<< modeName[ts.mode] << " buffers" << endl;
+}
+
+void
+deleteTextureStreamer(TextureStreamer& ts)
+{
+	{
+		lock_guard<mutex>	lock(ts.mutex);
+		ts.quit = true;
+	}
+	ts.wakeUp.notify_all();
+	for (size_t i = 0; i < ts.workers.size(); i++) ts.workers[i].join();
+	ts.workers.clear();
+
+	ts.requests.clear();
+	for (size_t i = 0; i < ts.decoded.size(); i++) delete ts.decoded[i];
+	ts.decoded.clear();
+	for (size_t i = 0; i < ts.uploads.size(); i++) delete ts.uploads[i];
+	ts.uploads.clear();
+	ts.nPending = 0;
+
+	for (size_t i = 0; i < ts.buffers.size(); i++)
+	{
+		TextureStreamBuffer&	b = ts.buffers[i];
+		if (b.fence) glDeleteSync(b.fence);
+		if (b.ptr)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b.pbo);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+		glDeleteBuffers(1, &b.pbo);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	ts.buffers.clear();
+}
+
+void
+streamTexture(TextureStreamer& ts, const TextureStreamRequest& request)
+{
+	if (request.n != 1 && request.n != 3 && request.n != 4)
+	{
+		cout << "Texture images with " << request.n << " channels are not supported!" << endl;
+		return;
+	}
+
+	if (ts.nPending == 0) ts.startTime = now();
+	ts.nPending++;
+
+	// Decode here if no worker is running
+	if (ts.workers.empty())
+	{
+		TextureStreamImage*	img = new TextureStreamImage;
+		img->request = request;
+		decodeTexture(img);
+		ts.uploads.push_back(img);
+		return;
+	}
+
+	{
+		lock_guard<mutex>	lock(ts.mutex);
+		ts.requests.push_back(request);
+	}
+	ts.wakeUp.notify_one();
+}
+
+// Close the current buffer with a fence and move to the next one
+static void
+fenceBuffer(TextureStreamer& ts)
+{
+	TextureStreamBuffer&	b = ts.buffers[ts.current];
+	if (b.used == 0 || b.fence) return;
+
+	b.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	ts.current = (ts.current + 1) % int(ts.buffers.size());
+}
+
+// The current buffer if the GPU is done with it, without waiting
+static bool
+acquireBuffer(TextureStreamer& ts)
+{
+	if (ts.mode == STREAM_DIRECT) return true;
+
+	TextureStreamBuffer&	b = ts.buffers[ts.current];
+	if (b.fence)
+	{
+		if (glClientWaitSync(b.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) return false;
+
+		glDeleteSync(b.fence);
+		b.fence = 0;
+		b.used = 0;
+	}
+	return true;
+}
+
+// Upload the next rows of the current level of the bound texture
+static void
+uploadStrip(TextureStreamer& ts, TextureStreamImage* img)
+{
+	int		l = img->level;
+	int		w = img->lw[l], h = img->lh[l];
+	size_t	rowSize = 4 * size_t(w);
+
+	// The rows left in the strip and the buffer, at least one
+	size_t	space = STRIP_SIZE;
+	if (ts.mode != STREAM_DIRECT && BUFFER_SIZE - ts.buffers[ts.current].used < space)
+		space = BUFFER_SIZE - ts.buffers[ts.current].used;
+
+	int	rows = int(space / rowSize);
+	if (rows == 0)
+	{
+		// A row larger than the whole buffer goes directly
+		if (ts.mode != STREAM_DIRECT && ts.buffers[ts.current].used > 0)
+		{
+			fenceBuffer(ts);
+			return;
+		}
+		rows = 1;
+	}
+	if (rows > h - img->row) rows = h - img->row;
+
+	size_t			size = rows * rowSize;
+	const GLubyte*	src = &img->levels[l][img->row * rowSize];
+
+	if (ts.mode == STREAM_DIRECT || size > BUFFER_SIZE)
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, l, 0, img->row, w, rows, GL_RGBA, GL_UNSIGNED_BYTE, src);
+	}
+	else
+	{
+		TextureStreamBuffer&	b = ts.buffers[ts.current];
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b.pbo);
+
+		GLubyte*	dst = b.ptr;
+		if (dst) dst += b.used;
+		else dst = (GLubyte*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, b.used, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+		if (dst)
+		{
+			memcpy(dst, src, size);
+			if (!b.ptr) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glTexSubImage2D(GL_TEXTURE_2D, l, 0, img->row, w, rows, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)b.used);
+			b.used += size;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		if (!dst)
+		{
+			cerr << "ERROR: Fail in mapping the texture streaming buffer" << endl;
+			glTexSubImage2D(GL_TEXTURE_2D, l, 0, img->row, w, rows, GL_RGBA, GL_UNSIGNED_BYTE, src);
+		}
+	}
+
+	img->row += rows;
+	ts.bytesUploaded += size;
+}
+
+static void
+finishImage(TextureStreamer& ts)
+{
+	delete ts.uploads.front();
+	ts.uploads.pop_front();
+
+	ts.nTextures++;
+	if (--ts.nPending == 0)
+		cerr << "Status: " << ts.nTextures << " textures streamed in " << (now() - ts.startTime) * 1000.0
+			<< " ms, " << ts.bytesUploaded / 1024 << " KB, the longest update "
+			<< ts.maxUpdateTime * 1000.0 << " ms" << endl;
+}
+
+void
+updateTextureStreamer(TextureStreamer& ts, double budget)
+{
+	double	start = now();
+
+	// Images decoded since the last frame
+	{
+		lock_guard<mutex>	lock(ts.mutex);
+		while (!ts.decoded.empty())
+		{
+			ts.uploads.push_back(ts.decoded.front());
+			ts.decoded.pop_front();
+		}
+	}
+	if (ts.uploads.empty()) return;
+
+	GLint	previous = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+
+	while (!ts.uploads.empty() && now() - start < budget)
+	{
+		TextureStreamImage*	img = ts.uploads.front();
+		const TextureStreamRequest&	r = img->request;
+		if (!img->ok)
+		{
+			cout << "Can't open " << r.filename << endl;
+			finishImage(ts);
+			continue;
+		}
+
+		if (!acquireBuffer(ts)) break;
+
+		glBindTexture(GL_TEXTURE_2D, r.texture);
+
+		// Start from the coarsest level, the only one in the range of the texture
+		if (img->level < 0)
+		{
+			if (img->nRead < size_t(r.w) * r.h * r.n)
+				cout << "Error: only " << img->nRead << "bytes could be read!" << endl;
+
+			img->level = int(img->levels.size()) - 1;
+			img->row = 0;
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, img->level);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, img->level);
+		}
+
+		// Storage of the level right before its first strip
+		if (img->row == 0)
+			glTexImage2D(GL_TEXTURE_2D, img->level, r.internalFormat, img->lw[img->level], img->lh[img->level],
+				0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+		uploadStrip(ts, img);
+
+		// Down to the completed level
+		if (img->row == img->lh[img->level])
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, img->level);
+			img->level--;
+			img->row = 0;
+			if (img->level < 0) finishImage(ts);
+		}
+	}
+
+	// The next frame starts with the next buffer
+	if (ts.mode != STREAM_DIRECT) fenceBuffer(ts);
+
+	glBindTexture(GL_TEXTURE_2D, previous);
+
+	double	elapsed = now() - start;
+	if (elapsed > ts.maxUpdateTime) ts.maxUpdateTime = elapsed;
+}
+
+bool
+textureStreamerIdle(const TextureStreamer& ts)
+{
+	return ts.nPending == 0;
+}
@@ -0,0 +1,124 @@
+#include "depthSort.h"
+
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>	// OpenMP for parallel computing
+#endif
+
+// Fewer pairs are sorted by a single thread.
+static const int	PARALLEL_THRESHOLD = 16384;
+static const int	MAX_THREADS = 16;
+
+// Key increasing as the depth decreases: the bits of a float flipped to sort as unsigned
+static inline uint32_t
+backToFrontKey(float depth)
+{
+	uint32_t	bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	bits = (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+	return ~bits;
+}
+
+// Insertion sort giving up after the given number of moves, still leaving a permutation
+static bool
+insertionSort(std::vector<uint64_t>& pairs, size_t maxMoves)
+{
+	size_t	n = pairs.size();
+	size_t	moves = 0;
+	for (size_t i = 1; i < n; i++)
+	{
+		uint64_t	x = pairs[i];
+		size_t		j = i;
+		while (j > 0 && pairs[j - 1] > x)
+		{
+			pairs[j] = pairs[j - 1];
+			j--;
+		}
+		pairs[j] = x;
+
+		moves += i - j;
+		if (moves > maxMoves) return false;
+	}
+	return true;
+}
+
+// Stable LSD radix sort on the upper 32 bits. Each thread histograms its own chunk, and
+// scatters it from the offsets of its digits after the chunks of the preceding threads.
+static void
+radixSort(std::vector<uint64_t>& pairs, std::vector<uint64_t>& pairsTmp)
+{
+	int	n = int(pairs.size());
+	pairsTmp.resize(n);
+
+	int	nThreads = 1;
+#ifdef _OPENMP
+	if (n >= PARALLEL_THRESHOLD) nThreads = omp_get_max_threads();
+	if (nThreads > MAX_THREADS) nThreads = MAX_THREADS;
+#endif
+
+	// Key bits that differ among the pairs
+	uint64_t	varying = 0;
+	for (int i = 1; i < n; i++) varying |= pairs[i] ^ pairs[0];
+
+	int	count[MAX_THREADS][256];
+	for (int shift = 32; shift < 64; shift += 8)
+	{
+		if (((varying >> shift) & 0xff) == 0) continue;
+
+		int	chunk = (n + nThreads - 1) / nThreads;
+
+#pragma omp parallel for num_threads(nThreads) if (nThreads > 1)
+		for (int t = 0; t < nThreads; t++)
+		{
+			memset(count[t], 0, sizeof(count[t]));
+			int	end = (t + 1) * chunk < n ? (t + 1) * chunk : n;
+			for (int i = t * chunk; i < end; i++) count[t][(pairs[i] >> shift) & 0xff]++;
+		}
+
+		// Exclusive prefix sum in the order of the digits, then the threads
+		int	sum = 0;
+		for (int b = 0; b < 256; b++)
+			for (int t = 0; t < nThreads; t++) { int c = count[t][b]; count[t][b] = sum; sum += c; }
+
+#pragma omp parallel for num_threads(nThreads) if (nThreads > 1)
+		for (int t = 0; t < nThreads; t++)
+		{
+			int	end = (t + 1) * chunk < n ? (t + 1) * chunk : n;
+			for (int i = t * chunk; i < end; i++)
+				pairsTmp[count[t][(pairs[i] >> shift) & 0xff]++] = pairs[i];
+		}
+
+		pairs.swap(pairsTmp);
+	}
+}
+
+void
+sortBackToFront(DepthSorter& ds, const float* depth, int n)
+{
+	// Start from the order of the last frame if it is for the same primitives
+	if (int(ds.order.size()) != n)
+	{
+		ds.order.resize(n);
+		for (int i = 0; i < n; i++) ds.order[i] = i;
+	}
+
+	ds.pairs.resize(n);
+#pragma omp parallel for if (n >= PARALLEL_THRESHOLD)
+	for (int i = 0; i < n; i++)
+	{
+		int	k = ds.order[i];
+		ds.pairs[i] = (uint64_t(backToFrontKey(depth[k])) << 32) | uint32_t(k);
+	}
+
+	// Nearly sorted if it needs less than a move per pair on average
+	ds.incremental = insertionSort(ds.pairs, size_t(n));
+	if (ds.incremental)	ds.nIncremental++;
+	else
+	{
+		radixSort(ds.pairs, ds.pairsTmp);
+		ds.nRadix++;
+	}
+
+	for (int i = 0; i < n; i++) ds.order[i] = int(ds.pairs[i] & 0xffffffff);
+}
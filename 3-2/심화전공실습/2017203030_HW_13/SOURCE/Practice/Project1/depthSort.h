@@ -0,0 +1,27 @@
+#ifndef _DEPTH_SORT_H_
+#define _DEPTH_SORT_H_
+
+#include <stdint.h>
+#include <vector>
+
+// Back-to-front order of primitives kept from frame to frame.
+// The depths become sortable 32-bit keys packed with the indices into 64-bit pairs.
+// Under small camera or object motion the previous order is nearly sorted and an
+// insertion sort with a bounded number of moves finishes it. Otherwise a parallel
+// LSD radix sort by 8 bits sorts the pairs, skipping the bytes shared by all the keys.
+struct DepthSorter
+{
+	std::vector<uint64_t>	pairs, pairsTmp;	// (key << 32) | index
+	std::vector<int>		order;				// Indices from the farthest
+
+	bool	incremental;	// The last sort took the fast path
+	int		nIncremental;	// # sorts by each path
+	int		nRadix;
+
+	DepthSorter() { incremental = false; nIncremental = 0; nRadix = 0; }
+};
+
+// Sort the n primitives by their depths from the eye, the largest first
+void	sortBackToFront(DepthSorter& ds, const float* depth, int n);
+
+#endif	// _DEPTH_SORT_H_
@@ -0,0 +1,127 @@
+#include "meshArena.h"
+#include "offReader.h"
+
+#include <glm/glm.hpp>	// OpenGL Mathematics
+using namespace glm;
+
+#include <stdlib.h>
+#ifdef _WIN32
+#include <malloc.h>		// _aligned_malloc
+#endif
+
+#include <iostream>
+using namespace std;
+
+static const size_t	arenaAlignment = 64;
+
+// Round up to the alignment
+static inline size_t
+alignUp(size_t n)
+{
+	return (n + arenaAlignment - 1) & ~(arenaAlignment - 1);
+}
+
+bool
+allocArenaMesh(int nVertices, int nFaces, ArenaMesh& mesh, bool withTexture)
+{
+	freeArenaMesh(mesh);
+
+	size_t	vertexBytes = alignUp(3 * size_t(nVertices) * sizeof(float));
+	size_t	faceNormalBytes = alignUp(3 * size_t(nFaces) * sizeof(float));
+	size_t	textureBytes = withTexture ? alignUp(2 * size_t(nVertices) * sizeof(float)) : 0;
+	size_t	faceBytes = alignUp(3 * size_t(nFaces) * sizeof(int));
+
+	size_t	size = 2 * vertexBytes + faceNormalBytes + textureBytes + faceBytes;
+	if (size == 0) size = arenaAlignment;
+
+#ifdef _WIN32
+	void*	arena = _aligned_malloc(size, arenaAlignment);
+#else
+	void*	arena = NULL;
+	if (posix_memalign(&arena, arenaAlignment, size) != 0) arena = NULL;
+#endif
+	if (arena == NULL)
+	{
+		cerr << "ERROR: Fail in allocating " << size << " bytes for the mesh" << endl;
+		return false;
+	}
+
+	char*	p = (char*)arena;
+	mesh.arena = arena;
+	mesh.arenaSize = size;
+	mesh.nVertices = nVertices;
+	mesh.nFaces = nFaces;
+
+	mesh.vertex = (float*)p;		p += vertexBytes;
+	mesh.normal = (float*)p;		p += vertexBytes;
+	mesh.faceNormal = (float*)p;	p += faceNormalBytes;
+	mesh.texture = withTexture ? (float*)p : NULL;	p += textureBytes;
+	mesh.face = (int*)p;
+
+	return true;
+}
+
+void
+freeArenaMesh(ArenaMesh& mesh)
+{
+	if (mesh.arena)
+	{
+#ifdef _WIN32
+		_aligned_free(mesh.arena);
+#else
+		free(mesh.arena);
+#endif
+	}
+
+	mesh = ArenaMesh();
+}
+
+int
+readArenaMesh(const char* filename, ArenaMesh& mesh)
+{
+	MappedFile	mf;
+	if (!mapFile(filename, mf)) return 0;
+
+	int nVertices = 0, nFaces = 0, nEdges = 0;
+	const char*	p = parseOFFHeader(mf.data, mf.size, nVertices, nFaces, nEdges);
+	if (p == NULL || !allocArenaMesh(nVertices, nFaces, mesh))
+	{
+		unmapFile(mf);
+		return 0;
+	}
+
+	cout << "# vertices = " << nVertices << endl;
+	cout << "# faces = " << nFaces << endl;
+
+	bool	ok = parseOFFBody(p, mf.data + mf.size, nVertices, nFaces, mesh.vertex, mesh.face);
+	unmapFile(mf);
+	if (!ok)
+	{
+		freeArenaMesh(mesh);
+		return 0;
+	}
+
+	// Face normals added to the vertex normals of their corners
+	vec3*	vertex = mesh.vertexAs<vec3>();
+	vec3*	normal = mesh.normalAs<vec3>();
+	vec3*	faceNormal = mesh.faceNormalAs<vec3>();
+
+	for (int i = 0; i < nVertices; i++)
+		normal[i] = vec3(0, 0, 0);
+
+	for (int i = 0; i < nFaces; i++)
+	{
+		const int*	f = mesh.face + 3 * i;
+		vec3	v = normalize(cross(vertex[f[1]] - vertex[f[0]], vertex[f[2]] - vertex[f[0]]));
+
+		faceNormal[i] = v;
+		normal[f[0]] += v;
+		normal[f[1]] += v;
+		normal[f[2]] += v;
+	}
+
+	for (int i = 0; i < nVertices; i++)
+		normal[i] = normalize(normal[i]);
+
+	return nEdges;
+}
@@ -0,0 +1,44 @@
+#ifndef _MESH_ARENA_H_
+#define _MESH_ARENA_H_
+
+#include <stddef.h>
+
+// Mesh in one 64-byte aligned allocation: one array per attribute, each starting
+// on a cache line, so the parser, the normal kernels and the VBO upload stream
+// through contiguous memory and the whole mesh is freed at once.
+//
+// The arrays are packed xyz per vertex, i.e. the layout of glm::vec3, and are viewed
+// as arrays of vec3 without a copy.
+struct ArenaMesh
+{
+	void*	arena;			// The allocation
+	size_t	arenaSize;		// # bytes
+
+	int		nVertices;
+	int		nFaces;
+
+	float*	vertex;			// 3 x nVertices
+	float*	normal;			// 3 x nVertices
+	float*	faceNormal;		// 3 x nFaces
+	float*	texture;		// 2 x nVertices, NULL if not allocated
+	int*	face;			// 3 x nFaces
+
+	ArenaMesh() { arena = NULL; arenaSize = 0; nVertices = 0; nFaces = 0; vertex = NULL; normal = NULL; faceNormal = NULL; texture = NULL; face = NULL; }
+
+	// AoS views as an array of 3-float vectors, e.g. glm::vec3
+	template <class Vec3> Vec3*	vertexAs() const { static_assert(sizeof(Vec3) == 3 * sizeof(float), "Not a packed 3-float vector"); return (Vec3*)vertex; }
+	template <class Vec3> Vec3*	normalAs() const { static_assert(sizeof(Vec3) == 3 * sizeof(float), "Not a packed 3-float vector"); return (Vec3*)normal; }
+	template <class Vec3> Vec3*	faceNormalAs() const { static_assert(sizeof(Vec3) == 3 * sizeof(float), "Not a packed 3-float vector"); return (Vec3*)faceNormal; }
+};
+
+// Carve the arrays out of a single aligned allocation. Returns false when out of memory.
+bool	allocArenaMesh(int nVertices, int nFaces, ArenaMesh& mesh, bool withTexture = false);
+
+// One free for the whole mesh
+void	freeArenaMesh(ArenaMesh& mesh);
+
+// Parse the OFF file straight into the arena and compute the face and vertex normals,
+// i.e. readMesh() without a copy. Returns # edges in the header, or 0 on failure.
+int		readArenaMesh(const char* filename, ArenaMesh& mesh);
+
+#endif	// _MESH_ARENA_H_
@@ -0,0 +1,262 @@
+#include "oit.h"
+
+#include <iostream>
+using namespace std;
+
+// Per-pixel Phong of the fixed-function light 0, writing the weighted color and coverage
+static const char*	accumVertexShader =
+	"#version 120\n"
+	"varying vec3 P;\n"
+	"varying vec3 N;\n"
+	"void main()\n"
+	"{\n"
+	"	P = vec3(gl_ModelViewMatrix * gl_Vertex);\n"
+	"	N = gl_NormalMatrix * gl_Normal;\n"
+	"	gl_Position = ftransform();\n"
+	"}\n";
+
+static const char*	accumFragmentShader =
+	"#version 120\n"
+	"varying vec3 P;\n"
+	"varying vec3 N;\n"
+	"void main()\n"
+	"{\n"
+	"	vec3 n = normalize(N);\n"
+	"	if (!gl_FrontFacing) n = -n;\n"		// Two-sided lighting
+	"	vec4 Lp = gl_LightSource[0].position;\n"
+	"	vec3 l = normalize(Lp.xyz - P * Lp.w);\n"
+	"	vec3 r = reflect(-l, n);\n"
+	"	vec3 v = normalize(-P);\n"
+	"	vec3 color = gl_FrontLightModelProduct.sceneColor.rgb + gl_FrontLightProduct[0].ambient.rgb\n"
+	"		+ gl_FrontLightProduct[0].diffuse.rgb * max(dot(n, l), 0.0)\n"
+	"		+ gl_FrontLightProduct[0].specular.rgb * pow(max(dot(r, v), 0.0), gl_FrontMaterial.shininess);\n"
+	"	float a = gl_FrontMaterial.diffuse.a;\n"
+	"	float w = a * clamp(3000.0 * pow(1.0 - gl_FragCoord.z, 3.0), 0.01, 3000.0);\n"
+	"	gl_FragData[0] = vec4(w * a * color, a);\n"
+	"	gl_FragData[1] = vec4(w * a);\n"
+	"}\n";
+
+static const char*	compositeVertexShader =
+	"#version 120\n"
+	"void main()\n"
+	"{\n"
+	"	gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+	"	gl_Position = gl_Vertex;\n"
+	"}\n";
+
+// Weighted average color with the revealage as the alpha for (1 - a, a) blending
+static const char*	compositeFragmentShader =
+	"#version 120\n"
+	"uniform sampler2D accumTex;\n"
+	"uniform sampler2D weightTex;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 accum = texture2D(accumTex, gl_TexCoord[0].st);\n"
+	"	if (accum.a >= 1.0) discard;\n"	// Nothing transparent
+	"	float weight = texture2D(weightTex, gl_TexCoord[0].st).r;\n"
+	"	gl_FragColor = vec4(accum.rgb / max(weight, 1e-5), accum.a);\n"
+	"}\n";
+
+static GLuint
+compileShader(GLenum type, const char* source)
+{
+	GLuint	shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint	compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled)
+	{
+		char	log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		cerr << "ERROR: Fail in compiling the OIT shader" << endl << log << endl;
+	}
+	return shader;
+}
+
+static GLuint
+createProgram(const char* vertexSource, const char* fragmentSource)
+{
+	GLuint	vs = compileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint	fs = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+
+	GLuint	program = glCreateProgram();
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glLinkProgram(program);
+
+	// The program keeps the shaders alive.
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+
+	GLint	linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		char	log[1024];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		cerr << "ERROR: Fail in linking the OIT program" << endl << log << endl;
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+static void
+createTarget(GLuint& tex, int w, int h)
+{
+	if (!tex) glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F_ARB, w, h, 0, GL_RGBA, GL_FLOAT, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// (Re)allocate the buffers of the given size
+static bool
+resizeOIT(WeightedOIT& oit, int w, int h)
+{
+	createTarget(oit.accumTex, w, h);
+	createTarget(oit.weightTex, w, h);
+
+	// The current target is not necessarily the window.
+	GLint	drawFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+
+	if (!oit.depthRb) glGenRenderbuffers(1, &oit.depthRb);
+	glBindRenderbuffer(GL_RENDERBUFFER, oit.depthRb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	if (!oit.fbo) glGenFramebuffers(1, &oit.fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, oit.fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, oit.accumTex, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, oit.weightTex, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, oit.depthRb);
+	bool	complete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, drawFramebuffer);
+
+	oit.w = w;
+	oit.h = h;
+
+	if (!complete) cerr << "ERROR: Fail in resizeOIT(" << w << ", " << h << ")" << endl;
+	return complete;
+}
+
+bool
+createOIT(WeightedOIT& oit)
+{
+	// Framebuffer objects, float textures and multiple render targets
+	oit.supported = GLEW_VERSION_3_0 || (GLEW_VERSION_2_0 && GLEW_ARB_framebuffer_object && GLEW_ARB_texture_float);
+	if (!oit.supported)
+	{
+		cerr << "Status: No float render targets, weighted blended OIT not available" << endl;
+		return false;
+	}
+
+	oit.accumProgram = createProgram(accumVertexShader, accumFragmentShader);
+	oit.compositeProgram = createProgram(compositeVertexShader, compositeFragmentShader);
+
+	oit.supported = oit.accumProgram && oit.compositeProgram && resizeOIT(oit, windowW, windowH);
+	if (!oit.supported) deleteOIT(oit);
+	return oit.supported;
+}
+
+void
+deleteOIT(WeightedOIT& oit)
+{
+	if (oit.fbo)				glDeleteFramebuffers(1, &oit.fbo);
+	if (oit.depthRb)			glDeleteRenderbuffers(1, &oit.depthRb);
+	if (oit.accumTex)			glDeleteTextures(1, &oit.accumTex);
+	if (oit.weightTex)			glDeleteTextures(1, &oit.weightTex);
+	if (oit.accumProgram)		glDeleteProgram(oit.accumProgram);
+	if (oit.compositeProgram)	glDeleteProgram(oit.compositeProgram);
+
+	oit = WeightedOIT();
+}
+
+void
+beginOIT(WeightedOIT& oit)
+{
+	// Follow the size of the window
+	if (oit.w != windowW || oit.h != windowH) resizeOIT(oit, windowW, windowH);
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &oit.drawFramebuffer);
+	glGetIntegerv(GL_DRAW_BUFFER, &oit.drawBuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, oit.fbo);
+
+	// Accumulation to zero with the revealage one, and the weight to zero
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glClearColor(0, 0, 0, 1);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glDrawBuffer(GL_COLOR_ATTACHMENT1);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glDepthMask(GL_TRUE);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	// Depth only for the opaque objects
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+}
+
+void
+beginOITAccumulation(WeightedOIT& oit)
+{
+	GLenum	buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, buffers);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	// Tested against the opaque depth but not written, so the order does not matter
+	glDepthMask(GL_FALSE);
+
+	// The colors and weights add up and the revealage multiplies by (1 - a).
+	glEnable(GL_BLEND);
+	glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+
+	glUseProgram(oit.accumProgram);
+}
+
+void
+endOIT(WeightedOIT& oit)
+{
+	glUseProgram(0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, oit.drawFramebuffer);
+	glDrawBuffer(oit.drawBuffer);
+
+	// Full-screen quad over the opaque image
+	glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+	glUseProgram(oit.compositeProgram);
+	glUniform1i(glGetUniformLocation(oit.compositeProgram, "accumTex"), 0);
+	glUniform1i(glGetUniformLocation(oit.compositeProgram, "weightTex"), 1);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, oit.weightTex);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, oit.accumTex);
+
+	glBegin(GL_QUADS);
+	glTexCoord2f(0, 0); glVertex2f(-1, -1);
+	glTexCoord2f(1, 0); glVertex2f(1, -1);
+	glTexCoord2f(1, 1); glVertex2f(1, 1);
+	glTexCoord2f(0, 1); glVertex2f(-1, 1);
+	glEnd();
+
+	glUseProgram(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopAttrib();
+
+	glDepthMask(GL_TRUE);
+}
@@ -0,0 +1,45 @@
+#ifndef _OIT_H_
+#define _OIT_H_
+
+#include "glSetup.h"
+
+// Weighted blended order-independent transparency (McGuire and Bavoil, JCGT 2013).
+// The transparent surfaces are accumulated in any order into two float render targets,
+//	accumulation:	rgb = sum(w * a * color), a = product(1 - a), i.e., the revealage
+//	weight:			r = sum(w * a)
+// with a weight w decreasing with the depth, and composited over the opaque image
+// as the weighted average color covering 1 - revealage of the pixel.
+// Lighting follows the fixed-function light 0 and the material, two-sided.
+struct WeightedOIT
+{
+	bool	supported;
+
+	GLuint	fbo;
+	GLuint	accumTex;		// GL_RGBA16F
+	GLuint	weightTex;		// GL_RGBA16F, only red used
+	GLuint	depthRb;		// Depth of the opaque objects redrawn into the buffer
+	int		w, h;
+
+	GLuint	accumProgram;
+	GLuint	compositeProgram;
+
+	// Target of the frame restored by endOIT(), e.g. the framebuffer object of the headless mode
+	GLint	drawFramebuffer;
+	GLint	drawBuffer;
+
+	WeightedOIT() { supported = false; fbo = accumTex = weightTex = depthRb = 0; w = h = 0; accumProgram = compositeProgram = 0;
+		drawFramebuffer = 0; drawBuffer = GL_BACK; }
+};
+
+bool	createOIT(WeightedOIT& oit);
+void	deleteOIT(WeightedOIT& oit);
+
+// Bind and clear the buffers of the window size. Draw the opaque objects depth-only,
+// then the transparent ones with the accumulation program between beginOIT() and endOIT().
+void	beginOIT(WeightedOIT& oit);
+void	beginOITAccumulation(WeightedOIT& oit);
+
+// Back to the target bound at beginOIT() and composite the transparent layer over it
+void	endOIT(WeightedOIT& oit);
+
+#endif	// _OIT_H_
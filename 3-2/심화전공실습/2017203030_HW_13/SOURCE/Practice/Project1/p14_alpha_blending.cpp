@@ -1,20 +1,30 @@
 #include "glSetup.h"
+#include "renderQueue.h"
+#include "oit.h"
+#include "depthSort.h"
+#include "textureStream.h"
+#include "meshArena.h"
 
 #include <glm/glm.hpp>	// OpenGL Mathematics
 #include <glm/gtc/type_ptr.hpp>	// value_ptr()
 using namespace glm;
 
 #include <iostream>
-#include <fstream>
+#include <vector>
+#include <string.h>
 using namespace std;
 
 void init();
 void quit();
+void createMeshVBO();
+void deleteMeshVBO();
 void render(GLFWwindow* window);
 void keyboard(GLFWwindow* window, int key, int code, int action, int mods);
 
 bool readMesh(const char* filename);
-void deleteMesh();
+
+// Mesh in one arena, freed at once
+ArenaMesh   mesh;
 
 // Camera configuation
 vec3 eye(0, 0, 3);
@@ -49,10 +59,21 @@ int frame = 0;
 // OpenGL texture unit
 GLuint texID[7];
 
+// Raw textures read and uploaded in the background
+TextureStreamer	textureStreamer;
+
+// State-sorted submission of the scene
+RenderQueue	renderQueue;
+bool	useQueue = true;
+
+// Weighted blended OIT of the transparent bunny from the static VBOs
+WeightedOIT	oit;
+bool	useOIT = true;
+
 int
 main(int argc, char* argv[])
 {
-    // vsync should be 0 for precise time stepping.
+    // The scheduler paces the frames instead of vsync.
     vsync = 0;
 
     // Field of view of 35mm lens in degree
@@ -74,33 +95,26 @@ main(int argc, char* argv[])
 
     init();
 
-    // Main loop
-    float previous = (float)glfwGetTime();
-    float elapsed = 0;
+    // Main loop: fixed time steps, sleeping between the frames
+    FrameScheduler	scheduler;
+    initializeScheduler(scheduler, timeStep);
     while (!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();	// Events
+        // Sleep until the next frame, then the events and the time steps due
+        int	steps = waitNextFrame(scheduler);
 
-    // Time passed during a single loop
-        float now = (float)glfwGetTime();
-        float delta = now - previous;
-        previous = now;
+        // Animate a frame per time step
+        if (!pause) frame += steps;
 
-        // Time passed after the previous frame
-        elapsed += delta;
-
-        // Deal with the current frame
-        if (elapsed > timeStep)
-        {
-            // Animate 1 frame
-            if (!pause) frame += 1;
-
-            elapsed = 0;	// Reset the elapsed time
-        }
+        // Upload the texture levels arrived, at most 1 ms per frame
+        updateTextureStreamer(textureStreamer, 0.001);
 
         render(window);	// Draw one frame
-        glfwSwapBuffers(window);	// Swap buffers
+        swapBuffers(window);	// Swap buffers
     }
+    printSchedulerStats(scheduler);
+    finalizeScheduler(scheduler);
+
     // Finalization
     quit();
 
@@ -135,33 +149,30 @@ loadCheckerboardTexture()
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 }
 
+// The file is the alpha of the given color. Streamed to the bound texture in the background.
 bool
-loadAlphaTexture(const char* filename, int w, int h)
+loadAlphaTexture(const char* filename, int w, int h, GLubyte r, GLubyte g, GLubyte b)
 {
-    // Open the raw texture file
-    ifstream	is(filename, ios::binary);
-    if (is.fail())
-    {
-        cout << "Can't open	" << filename << endl;
-        return false;
-    }
-
-    // Allocate memory
-    GLubyte* raw = new GLubyte[w * h];
-
-    // Read all the texels
-    is.read((char*)raw, w * h);
-    if (!is)	cout << "Error: only " << is.gcount() << "bytes could be read!" << endl;
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_ALPHA, GL_UNSIGNED_BYTE, raw);
+    GLint   texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
 
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-    // Deallocate memory
-    delete[]	raw;
+    TextureStreamRequest    request;
+    request.texture = texture;
+    request.filename = filename;
+    request.w = w;
+    request.h = h;
+    request.n = 1;
+    request.internalFormat = GL_RGBA8;
+    request.alphaOnly = true;
+    request.color[0] = r;
+    request.color[1] = g;
+    request.color[2] = b;
+    streamTexture(textureStreamer, request);
 
     return true;
 }
@@ -176,45 +187,34 @@ init()
     glBindTexture(GL_TEXTURE_2D, texID[0]);
     loadCheckerboardTexture();
 
-    // Raw texture
+    // Raw textures colored by the workers instead of glPixelTransfer()
+    createTextureStreamer(textureStreamer);
+
     glBindTexture(GL_TEXTURE_2D, texID[1]);
-    glPixelTransferf(GL_RED_BIAS, 1.0);
-    glPixelTransferf(GL_GREEN_BIAS, 0.0);
-    glPixelTransferf(GL_BLUE_BIAS, 0.0);
-    loadAlphaTexture("m02_logo.raw", 512, 512);
+    loadAlphaTexture("m02_logo.raw", 512, 512, 255, 0, 0);
 
     glBindTexture(GL_TEXTURE_2D, texID[2]);
-    glPixelTransferf(GL_RED_BIAS, 0.0);
-    glPixelTransferf(GL_GREEN_BIAS, 1.0);
-    glPixelTransferf(GL_BLUE_BIAS, 0.0);
-    loadAlphaTexture("m02_logo.raw", 512, 512);
+    loadAlphaTexture("m02_logo.raw", 512, 512, 0, 255, 0);
 
     glBindTexture(GL_TEXTURE_2D, texID[3]);
-    glPixelTransferf(GL_RED_BIAS, 0.0);
-    glPixelTransferf(GL_GREEN_BIAS, 0.0);
-    glPixelTransferf(GL_BLUE_BIAS, 1.0);
-    loadAlphaTexture("m02_logo.raw", 512, 512);
+    loadAlphaTexture("m02_logo.raw", 512, 512, 0, 0, 255);
 
     glBindTexture(GL_TEXTURE_2D, texID[4]);
-    glPixelTransferf(GL_RED_BIAS, 1.0);
-    glPixelTransferf(GL_GREEN_BIAS, 0.0);
-    glPixelTransferf(GL_BLUE_BIAS, 0.0);
-    loadAlphaTexture("m02_grayscale_ornament.raw", 512, 512);
+    loadAlphaTexture("m02_grayscale_ornament.raw", 512, 512, 255, 0, 0);
 
     glBindTexture(GL_TEXTURE_2D, texID[5]);
-    glPixelTransferf(GL_RED_BIAS, 0.0);
-    glPixelTransferf(GL_GREEN_BIAS, 1.0);
-    glPixelTransferf(GL_BLUE_BIAS, 0.0);
-    loadAlphaTexture("m02_grayscale_ornament.raw", 512, 512);
+    loadAlphaTexture("m02_grayscale_ornament.raw", 512, 512, 0, 255, 0);
 
     glBindTexture(GL_TEXTURE_2D, texID[6]);
-    glPixelTransferf(GL_RED_BIAS, 0.0);
-    glPixelTransferf(GL_GREEN_BIAS, 0.0);
-    glPixelTransferf(GL_BLUE_BIAS, 1.0);
-    loadAlphaTexture("m02_grayscale_ornament.raw", 512, 512);
+    loadAlphaTexture("m02_grayscale_ornament.raw", 512, 512, 0, 0, 255);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
     // Prepare mesh
     readMesh("m01_bunny.off");
+    createMeshVBO();
+
+    // Buffers and programs of the order-independent transparency
+    createOIT(oit);
 
     // Keyboard
     cout << endl;
@@ -222,6 +222,9 @@ init()
     cout << "Keyboard input : x for axes on/off" << endl;
     cout << "Keyboard input : c for an opaque cube on/off" << endl;
     cout << "Keyboard input : d for depth mask on/off" << endl;
+    cout << "Keyboard input : r for the state-sorted render queue on/off" << endl;
+    cout << "Keyboard input : s for the state changes of the render queue" << endl;
+    cout << "Keyboard input : o for weighted blended OIT of the bunny on/off" << endl;
     cout << endl;
     cout << "Keyboard: 1 a flat transparent bunny" << endl;
     cout << "Keyboard: 2 a smooth transparent bunny" << endl;
@@ -234,7 +237,10 @@ void
 quit()
 {
     // Delete mesh
-    deleteMesh();
+    freeArenaMesh(mesh);
+    deleteMeshVBO();
+    deleteOIT(oit);
+    deleteTextureStreamer(textureStreamer);
 }
 
 // Material
@@ -256,174 +262,175 @@ setupColoredMaterial(const vec4& color)
     glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, mat_shininess);
 }
 
+// Faces of the unit cube: front, back, left, right, top and bottom
+const GLfloat	cubeNormal[6][3] = {
+    { 0, 0, 1 }, { 0, 0, -1 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }
+};
+const GLfloat	cubeVertex[6][4][3] = {
+    { { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } },
+    { { 1, 0, 0 }, { 0, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 } },
+    { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 0 } },
+    { { 1, 0, 1 }, { 1, 0, 0 }, { 1, 1, 0 }, { 1, 1, 1 } },
+    { { 0, 1, 1 }, { 1, 1, 1 }, { 1, 1, 0 }, { 0, 1, 0 } },
+    { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 0, 1 }, { 0, 0, 1 } }
+};
+const GLfloat	cubeTexcoord[4][2] = { { 0, 1 }, { 1, 1 }, { 1, 0 }, { 0, 0 } };
+
+// The i-th face without binding its texture
+void
+drawCubeFace(int i)
+{
+    glBegin(GL_QUADS);
+    glNormal3fv(cubeNormal[i]);
+    for (int j = 0; j < 4; j++)
+    {
+        glTexCoord2fv(cubeTexcoord[j]);
+        glVertex3fv(cubeVertex[i][j]);
+    }
+    glEnd();
+}
+
 void
 drawTexturedCube()
 {
-    vec3	normal[6];
-    vec3	vertex[6][4];
-    vec2	texcoord[4];
-
-    // Front
-    normal[0] = vec3(0, 0, 1);
-    vertex[0][0] = vec3(0, 0, 1);
-    vertex[0][1] = vec3(1, 0, 1);
-    vertex[0][2] = vec3(1, 1, 1);
-    vertex[0][3] = vec3(0, 1, 1);
-
-    // Back
-    normal[1] = vec3(0, 0, -1);
-    vertex[1][0] = vec3(1, 0, 0);
-    vertex[1][1] = vec3(0, 0, 0);
-    vertex[1][2] = vec3(0, 1, 0);
-    vertex[1][3] = vec3(1, 1, 0);
-
-    // Right
-    normal[3] = vec3(1, 0, 0);
-    vertex[3][0] = vec3(1, 0, 1);
-    vertex[3][1] = vec3(1, 0, 0);
-    vertex[3][2] = vec3(1, 1, 0);
-    vertex[3][3] = vec3(1, 1, 1);
-
-    // Left
-    normal[2] = vec3(-1, 0, 0);
-    vertex[2][0] = vec3(0, 0, 0);
-    vertex[2][1] = vec3(0, 0, 1);
-    vertex[2][2] = vec3(0, 1, 1);
-    vertex[2][3] = vec3(0, 1, 0);
-
-    // Top
-    normal[4] = vec3(0, 1, 0);
-    vertex[4][0] = vec3(0, 1, 1);
-    vertex[4][1] = vec3(1, 1, 1);
-    vertex[4][2] = vec3(1, 1, 0);
-    vertex[4][3] = vec3(0, 1, 0);
-
-    // Bottom
-    normal[5] = vec3(0, -1, 0);
-    vertex[5][0] = vec3(0, 0, 0);
-    vertex[5][1] = vec3(1, 0, 0);
-    vertex[5][2] = vec3(1, 0, 1);
-    vertex[5][3] = vec3(0, 0, 1);
-
-    // Texture coordinate
-    texcoord[0] = vec2(0, 1);
-    texcoord[1] = vec2(1, 1);
-    texcoord[2] = vec2(1, 0);
-    texcoord[3] = vec2(0, 0);
-
-    // Cube
     for (int i = 0; i < 6; i++)
     {
         glBindTexture(GL_TEXTURE_2D, texID[i + 1]);
-
-        glBegin(GL_QUADS);
-        glNormal3fv(value_ptr(normal[i]));
-        for (int j = 0; j < 4; j++)
-        {
-            glTexCoord2fv(value_ptr(texcoord[j]));
-            glVertex3fv(value_ptr(vertex[i][j]));
-        }
-        glEnd();
+        drawCubeFace(i);
     }
 }
 
-// Read a mesh from a given OFF file
+// Read a mesh from a given OFF file into the arena, viewed as arrays of vec3
 int nVertices = 0, nFaces = 0, nEdges = 0;
 vec3* vertex = NULL;
 vec3* vnormal = NULL;		//Vertex normal
 vec3* fnormal = NULL;		//Face normal
-int* face[3] = {NULL, NULL, NULL};
-
-struct DepthSortData
-{
-    int	    i;	    // Face index
-    vec4	center; // Face center for depth sorting
-    float	depth;  // Depth from the eye
-};
+int* face = NULL;		    //3 x nFaces vertex indices
 
-DepthSortData* fdsd = NULL;
+// Depth sorting data
+vector<vec3>    fcenter;            //Face center
+vector<float>   fdepth;             //Depth of the face center from the eye
+DepthSorter     depthSorter;
 
 bool
 readMesh(const char* filename)
 {
-    ifstream	is(filename);
-    if (is.fail()) return false;
+    nEdges = readArenaMesh(filename, mesh);
+    if (mesh.nFaces == 0) return false;
 
-    char	magicNumber[256];
-    is >> magicNumber;
+    nVertices = mesh.nVertices;
+    nFaces = mesh.nFaces;
+    vertex = mesh.vertexAs<vec3>();
+    vnormal = mesh.normalAs<vec3>();
+    fnormal = mesh.faceNormalAs<vec3>();
+    face = mesh.face;
 
-    // # vertices, # faces, # edges
-    is >> nVertices >> nFaces >> nEdges;
-    cout << "# vertices = " << nVertices << endl;
-    cout << "# faces = " << nFaces << endl;
+    // Depth sort data
+    fcenter.resize(nFaces);
+    fdepth.resize(nFaces);
 
-    // Vertices
-    vertex = new vec3[nVertices];
-    for (int i = 0; i < nVertices; i++)
-        is >> vertex[i].x >> vertex[i].y >> vertex[i].z;
+    vec3	center;
+    for (int i = 0; i < nFaces; i++)
+    {
+        center = vertex[face[3 * i]] / 3.0f;
+        center += vertex[face[3 * i + 1]] / 3.0f;
+        center += vertex[face[3 * i + 2]] / 3.0f;
 
-    // Vertex normals
-    vnormal = new vec3[nVertices];
-    for (int i = 0; i < nVertices; i++)
-        vnormal[i] = vec3(0, 0, 0);
+        fcenter[i] = center;
+    }
 
-    // Face normals
-    fnormal = new vec3[nFaces];
+    return true;
+}
 
-    // Faces
-    face[0] = new int[nFaces];
-    face[1] = new int[nFaces];
-    face[2] = new int[nFaces];
+// Static VBOs of the mesh: the flat one repeats the face normal at the corners,
+// the smooth one is indexed. Interleaved position and normal.
+GLuint  flatVBO = 0;
+GLuint  smoothVBO = 0, smoothIBO = 0;
 
-    // Depth sort data
-    fdsd = new DepthSortData[nFaces];
+// Indices of the faces in the depth order, rewritten every frame
+GLuint  sortedIBO = 0;
+vector<GLuint>  sortedIndex;
 
-    int	    n;
-    vec3	center;
+void
+createMeshVBO()
+{
+    GLfloat*    flat = new GLfloat[nFaces * 3 * 6];
     for (int i = 0; i < nFaces; i++)
+        for (int j = 0; j < 3; j++)
+        {
+            GLfloat*    v = flat + (3 * i + j) * 6;
+            memcpy(v, value_ptr(vertex[face[3 * i + j]]), 3 * sizeof(GLfloat));
+            memcpy(v + 3, value_ptr(fnormal[i]), 3 * sizeof(GLfloat));
+        }
+
+    GLfloat*    smooth = new GLfloat[nVertices * 6];
+    for (int i = 0; i < nVertices; i++)
     {
-        is >> n >> face[0][i] >> face[1][i] >> face[2][i];
-        if (n != 3) cout << "# vertices of the " << i << " - th faces = " << n << endl;
+        memcpy(smooth + 6 * i, value_ptr(vertex[i]), 3 * sizeof(GLfloat));
+        memcpy(smooth + 6 * i + 3, value_ptr(vnormal[i]), 3 * sizeof(GLfloat));
+    }
 
-        // Normal vector of the face
-        vec3	v1 = vertex[face[1][i]] - vertex[face[0][i]];
-        vec3	v2 = vertex[face[2][i]] - vertex[face[0][i]];
-        vec3	v = normalize(cross(v1, v2));
+    glGenBuffers(1, &flatVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, flatVBO);
+    glBufferData(GL_ARRAY_BUFFER, nFaces * 3 * 6 * sizeof(GLfloat), flat, GL_STATIC_DRAW);
 
-        fnormal[i] = v;
+    glGenBuffers(1, &smoothVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, smoothVBO);
+    glBufferData(GL_ARRAY_BUFFER, nVertices * 6 * sizeof(GLfloat), smooth, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-        // Add it to the normal vector of each vertex
-        vnormal[face[0][i]] += v;
-        vnormal[face[1][i]] += v;
-        vnormal[face[2][i]] += v;
+    glGenBuffers(1, &smoothIBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, smoothIBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, nFaces * 3 * sizeof(GLuint), face, GL_STATIC_DRAW);	// Straight from the arena
 
-        // Depth sorting data
-        center = vertex[face[0][i]] / 3.0f;
-        center += vertex[face[1][i]] / 3.0f;
-        center += vertex[face[2][i]] / 3.0f;
+    glGenBuffers(1, &sortedIBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sortedIBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, nFaces * 3 * sizeof(GLuint), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    sortedIndex.resize(nFaces * 3);
 
-        fdsd[i].i = i;
-        fdsd[i].center = vec4(center, 1.0f);
-    }
+    delete[] flat;
+    delete[] smooth;
+}
 
-    // Normalization of the normal vectors
-    for (int i = 0; i < nVertices; i++)
-        vnormal[i] = normalize(vnormal[i]);
+void
+deleteMeshVBO()
+{
+    if (flatVBO)    { glDeleteBuffers(1, &flatVBO); flatVBO = 0; }
+    if (smoothVBO)  { glDeleteBuffers(1, &smoothVBO); smoothVBO = 0; }
+    if (smoothIBO)  { glDeleteBuffers(1, &smoothIBO); smoothIBO = 0; }
+    if (sortedIBO)  { glDeleteBuffers(1, &sortedIBO); sortedIBO = 0; }
+}
 
-    return true;
+// Draw the mesh from the given buffers in one call, without indices if ibo is 0
+void
+drawMeshBuffers(GLuint vbo, GLuint ibo)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 6 * sizeof(GLfloat), (const void*)0);
+    glNormalPointer(GL_FLOAT, 6 * sizeof(GLfloat), (const void*)(3 * sizeof(GLfloat)));
+
+    if (ibo)
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+        glDrawElements(GL_TRIANGLES, 3 * nFaces, GL_UNSIGNED_INT, (const void*)0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    else glDrawArrays(GL_TRIANGLES, 0, 3 * nFaces);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-// Delete the vertices and faces of the mesh
+// Draw the mesh from the static VBOs in one call
 void
-deleteMesh()
+drawMeshVBO(bool smooth)
 {
-    if (vertex)	    { delete[] 	 	vertex;	vertex = NULL; }
-    if (vnormal)    { delete[] 	 	vnormal; vnormal = NULL; }
-    if (fnormal)    { delete[]	    fnormal; fnormal = NULL; }
-    if (face[0])    { delete[] 	 	face[0]; face[0] = NULL; }
-    if (face[1])    { delete[]	 	face[1]; face[1] = NULL; }
-    if (face[2])    { delete[]	 	face[2]; face[2] = NULL; }
-    if (fdsd)       { delete[]  	 	fdsd; fdsd = NULL; }
+    if (smooth) drawMeshBuffers(smoothVBO, smoothIBO);
+    else        drawMeshBuffers(flatVBO, 0);
 }
 
 // Draw a flat mesh by specifying its face normal vectors
@@ -436,7 +443,7 @@ drawFlatMesh()
     {
         glNormal3fv(value_ptr(fnormal[i]));
         for (int j = 0; j < 3; j++)
-            glVertex3fv(value_ptr(vertex[face[j][i]]));
+            glVertex3fv(value_ptr(vertex[face[3 * i + j]]));
     }
     glEnd();
 }
@@ -450,86 +457,68 @@ drawSmoothMesh()
     for (int i = 0; i < nFaces; i++)
         for (int j = 0; j < 3; j++)
         {
-            glNormal3fv(value_ptr(vnormal[face[j][i]]));
-            glVertex3fv(value_ptr(vertex[face[j][i]]));
+            glNormal3fv(value_ptr(vnormal[face[3 * i + j]]));
+            glVertex3fv(value_ptr(vertex[face[3 * i + j]]));
         }
     glEnd();
 }
 
-// Decreasing order to draw the farther faces first
-int
-compare(const void* a, const void* b)
-{
-    float depth1 = ((DepthSortData*)a)->depth;
-    float depth2 = ((DepthSortData*)b)->depth;
-
-    if (depth1 > depth2)	return -1;
-    if (depth1 < depth2)	return 1;
-
-    return 0;
-}
-
 void
 sortMeshFace()
 {
-    // Get the current model view matrix
-    GLfloat modelView[16];
-    glGetFloatv(GL_MODELVIEW_MATRIX, modelView);
+    PROFILE_ZONE("sortMeshFace");
 
-    // OpenGL employs the row vector convention
-    // and glm employs the column-major representation.
-    mat4	M = make_mat4(modelView);
+    // Get the current model view matrix
+    GLfloat M[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, M);
 
-    // Depth of every face
+    // Only the z-coordinate of the face center in the eye coordinate system is needed.
+    // The camera faces the negative z-axis in OpenGL.
+#pragma omp parallel for if (nFaces >= 16384)
     for (int i = 0; i < nFaces; i++)
     {
-        // Face center in the eye coordinate system
-        vec4	center_eye = M * fdsd[i].center;
-        // The camera faces the negative z-axis in OpenGL.
-        fdsd[i].depth = -center_eye.z;
+        const vec3& c = fcenter[i];
+        fdepth[i] = -(M[2] * c.x + M[6] * c.y + M[10] * c.z + M[14]);
     }
-    // Depth sorting
-    qsort(fdsd, nFaces, sizeof(DepthSortData), compare);
+
+    // Depth sorting, mostly incremental from the last frame
+    sortBackToFront(depthSorter, &fdepth[0], nFaces);
 }
 
-// Draw a flat mesh with depth sorting
+// Draw the faces in the sorted order from the static VBOs with one glDrawElements()
 void
-drawSortedFlatMesh()
+drawSortedMeshVBO(bool smooth)
 {
     // Sort mesh faces
     sortMeshFace();
 
-    // Geometry
-    glBegin(GL_TRIANGLES);
+    // Corners of the sorted faces, into the vertices of the smooth or the flat VBO
+    const int*  order = &depthSorter.order[0];
     for (int i = 0; i < nFaces; i++)
-    {
-        int iFace = fdsd[i].i;
-
-        glNormal3fv(value_ptr(fnormal[iFace]));
         for (int j = 0; j < 3; j++)
-            glVertex3fv(value_ptr(vertex[face[j][iFace]]));
-    }
-    glEnd();
+            sortedIndex[3 * i + j] = smooth ? face[3 * order[i] + j] : 3 * order[i] + j;
+
+    // Orphan the buffer of the previous frame not to wait for it
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sortedIBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, nFaces * 3 * sizeof(GLuint), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, nFaces * 3 * sizeof(GLuint), &sortedIndex[0]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    drawMeshBuffers(smooth ? smoothVBO : flatVBO, sortedIBO);
 }
 
-// Draw a smooth mesh by specifying its vertex normal vectors
+// Draw a flat mesh with depth sorting
 void
-drawSortedSmoothMesh()
+drawSortedFlatMesh()
 {
-    // Sort mesh faces
-    sortMeshFace();
-
-    // Geometry
-    glBegin(GL_TRIANGLES);
-    for (int i = 0; i < nFaces; i++)
-        for (int j = 0; j < 3; j++)
-        {
-            int iFace = fdsd[i].i;
+    drawSortedMeshVBO(false);
+}
 
-            glNormal3fv(value_ptr(vnormal[face[j][iFace]]));
-            glVertex3fv(value_ptr(vertex[face[j][iFace]]));
-        }
-    glEnd();
+// Draw a smooth mesh with depth sorting
+void
+drawSortedSmoothMesh()
+{
+    drawSortedMeshVBO(true);
 }
 
 // Light
@@ -546,12 +535,10 @@ setupLight(const vec4& p)
     glLightfv(GL_LIGHT0, GL_POSITION, value_ptr(p));
 }
 
-// Textured quad
+// Unit quad on the xy-plane
 void
-drawTexturedQuad()
+drawQuad(int)
 {
-    glBindTexture(GL_TEXTURE_2D, texID[0]);
-
     glBegin(GL_QUADS);
     glNormal3f(0, 0, 1);
 
@@ -563,43 +550,93 @@ drawTexturedQuad()
     glEnd();
 }
 
+// Textured quad
 void
-render(GLFWwindow* window)
+drawTexturedQuad()
 {
-    // Background color
-    glClearColor(bgColor[0], bgColor[1], bgColor[2], bgColor[3]);
+    glBindTexture(GL_TEXTURE_2D, texID[0]);
+    drawQuad(0);
+}
 
-    // Enabling writing into the depth buffer
-    glDepthMask(true);
+// Transparent bunny of the selected example
+void
+drawBunny(int selection)
+{
+    switch (selection)
+    {
+    case 1:	drawFlatMesh();     	    break;
+    case 2:	drawSmoothMesh();	        break;
+    case 3:	drawSortedFlatMesh();   	break;
+    case 4:	drawSortedSmoothMesh();	    break;
+    }
+}
 
-    // Clear color and depth buffers
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// Submit every face of the cube as an item sorted at the center of the face
+void
+submitCube(RenderPass pass, bool textured, int material)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        GLfloat center[3] = { 0, 0, 0 };
+        for (int j = 0; j < 4; j++)
+            for (int k = 0; k < 3; k++)
+                center[k] += cubeVertex[i][j][k] / 4;
 
-    // Modelview matrix
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+        submitDrawItem(renderQueue, pass, 0, textured ? texID[i + 1] : 0, material, drawCubeFace, i, center);
+    }
+}
 
-    gluLookAt(eye[0], eye[1], eye[2], center[0], center[1], center[2], up[0], up[1], up[2]);
+// The same scene as render() through the render queue
+void
+renderQueued()
+{
+    int white = addMaterial(renderQueue, coloredMaterial(0.95f, 0.95f, 0.95f));
+    int green = addMaterial(renderQueue, coloredMaterial(0.5f, 0.95f, 0.5f));
+    int glass = addMaterial(renderQueue, coloredMaterial(0.95f, 0.95f, 0.95f, 0.5f));
 
-    // Axes
-    if (axes)
+    // Textured opaque quad
+    glPushMatrix();
+    glScalef(2.5, 2.5, 1.0);
+    glTranslatef(-0.5, -0.5, -1);
+    submitDrawItem(renderQueue, PASS_OPAQUE, 0, texID[0], white, drawQuad);
+    glPopMatrix();
+
+    // Opaque cube by turning off alpha texturing
+    if (cube)
     {
-        glDisable(GL_LIGHTING);
-        glDisable(GL_TEXTURE_2D);
-        drawAxes(AXIS_LENGTH, AXIS_LINE_WIDTH * dpiScaling);
+        glPushMatrix();
+        glTranslatef(-0.15f, 0.3f, 0.5f);
+        glScalef(0.3f, 0.3f, 0.3f);
+        glRotatef(30, 1, 0, 0);
+        submitCube(PASS_OPAQUE, false, green);
+        glPopMatrix();
     }
-    // Smooth shading
-    glShadeModel(GL_SMOOTH);
 
-    // Lighting
-    //
-    glEnable(GL_LIGHTING);
-    glEnable(GL_LIGHT0);
+    glPushMatrix();
+    float	theta = frame * 4 / period;
+    if (selection <= 4) // Transparent bunny rotating about the y-axis
+    {
+        glRotatef(theta, 0, 1, 0);
+        glTranslatef(0.0f, -0.2f, 0.0f);
+        glScalef(0.7f, 0.7f, 0.7f);
+        submitDrawItem(renderQueue, PASS_TRANSPARENT, 0, 0, glass, drawBunny, selection);
+    }
+    else {       // Alpha-textured cube
+        glRotatef(theta, 1, 1, 0);
+        glTranslatef(-0.3f, -0.3f, -0.3f);
+        glScalef(0.6f, 0.6f, 0.6f);
+        submitCube(PASS_TRANSPARENT, true, white);
+    }
+    glPopMatrix();
 
-    setupLight(light);
+    renderQueue.depthMask = depthMask;
+    flushRenderQueue(renderQueue);
+}
 
-    // Draw opaque object first
-    //
+// Opaque quad and optional cube of the scene
+void
+drawOpaqueObjects()
+{
     glDepthMask(true); // Enabling writing into the depth buffer
 
     // Solid objects do not require two-sided lighting.
@@ -638,6 +675,89 @@ render(GLFWwindow* window)
 
         glPopMatrix();
     }
+}
+
+// Transparent bunny by weighted blended OIT: no sorting and one draw call,
+// so the flat and smooth bunnies with and without depth sorting look alike.
+void
+renderOIT()
+{
+    // Opaque objects into the window, and their depth again into the OIT buffers
+    drawOpaqueObjects();
+
+    beginOIT(oit);
+    drawOpaqueObjects();
+
+    // Transparent bunny in any order
+    beginOITAccumulation(oit);
+
+    glPushMatrix();
+
+    float	theta = frame * 4 / period;
+    glRotatef(theta, 0, 1, 0);
+    glTranslatef(0.0f, -0.2f, 0.0f);
+    glScalef(0.7f, 0.7f, 0.7f);
+
+    setupColoredMaterial(vec4(0.95, 0.95, 0.95, 0.5));
+    drawMeshVBO(selection == 2 || selection == 4);
+
+    glPopMatrix();
+
+    endOIT(oit);
+}
+
+void
+render(GLFWwindow* window)
+{
+    PROFILE_GPU_ZONE("render");
+
+    // Background color
+    glClearColor(bgColor[0], bgColor[1], bgColor[2], bgColor[3]);
+
+    // Enabling writing into the depth buffer
+    glDepthMask(true);
+
+    // Clear color and depth buffers
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Modelview matrix
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    gluLookAt(eye[0], eye[1], eye[2], center[0], center[1], center[2], up[0], up[1], up[2]);
+
+    // Axes
+    if (axes)
+    {
+        glDisable(GL_LIGHTING);
+        glDisable(GL_TEXTURE_2D);
+        drawAxes(AXIS_LENGTH, AXIS_LINE_WIDTH * dpiScaling);
+    }
+    // Smooth shading
+    glShadeModel(GL_SMOOTH);
+
+    // Lighting
+    //
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+
+    setupLight(light);
+
+    if (useOIT && oit.supported && selection <= 4)
+    {
+        renderOIT();
+        return;
+    }
+
+    if (useQueue)
+    {
+        renderQueued();
+        return;
+    }
+
+    // Draw opaque object first
+    //
+    drawOpaqueObjects();
 
     // Draw transparent ones
     //
@@ -722,6 +842,26 @@ keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
             // Depth mask on/off
         case GLFW_KEY_D:    depthMask = !depthMask; break;
 
+            // Render queue on/off and its statistics of the last frame
+        case GLFW_KEY_R:
+            useQueue = !useQueue;
+            cout << "Render queue " << (useQueue ? "on" : "off") << endl;
+            break;
+        case GLFW_KEY_S:
+            cout << "# items = " << renderQueue.stats.nItems
+                << ", # state changes = " << renderQueue.stats.nStateChanges
+                << " instead of " << renderQueue.stats.nInlineChanges
+                << " (" << renderQueue.stats.nInlineChanges - renderQueue.stats.nStateChanges << " saved)" << endl;
+            cout << "# depth sorts = " << depthSorter.nIncremental << " incremental, "
+                << depthSorter.nRadix << " radix" << endl;
+            break;
+
+            // Weighted blended OIT on/off
+        case GLFW_KEY_O:
+            useOIT = !useOIT;
+            cout << "Weighted blended OIT " << (useOIT ? "on" : "off") << endl;
+            break;
+
             // Example selection
         case GLFW_KEY_1:	selection = 1;	break;
         case GLFW_KEY_2:	selection = 2;	break;
@@ -0,0 +1,208 @@
+#include "renderQueue.h"
+
+#include <string.h>
+
+int
+addMaterial(RenderQueue& queue, const Material& material)
+{
+	// Reuse an identical material, so it can be registered every frame
+	for (size_t i = 0; i < queue.materials.size(); i++)
+		if (memcmp(&queue.materials[i], &material, sizeof(Material)) == 0) return int(i);
+
+	queue.materials.push_back(material);
+	return int(queue.materials.size()) - 1;
+}
+
+// Material of setupColoredMaterial(): the alpha applies to all the terms
+Material
+coloredMaterial(float r, float g, float b, float a)
+{
+	Material	m = {
+		{ 0.1f, 0.1f, 0.1f, a },
+		{ r, g, b, a },
+		{ 0.5f, 0.5f, 0.5f, a },
+		100
+	};
+	return m;
+}
+
+// Depth as an unsigned integer in the same order: the bits of a non-negative float
+static inline uint32_t
+depthBits(float depth)
+{
+	if (!(depth > 0)) return 0;
+
+	uint32_t	bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits;
+}
+
+void
+submitDrawItem(RenderQueue& queue, RenderPass pass, GLuint program, GLuint texture, int material,
+	DrawFunc draw, int arg, const GLfloat* center)
+{
+	DrawItem	item;
+	item.pass = pass;
+	item.program = program;
+	item.texture = texture;
+	item.material = material;
+	item.draw = draw;
+	item.arg = arg;
+
+	glGetFloatv(GL_MODELVIEW_MATRIX, item.modelView);
+
+	// The camera faces the negative z-axis.
+	const GLfloat*	M = item.modelView;
+	float	z = M[14];
+	if (center) z += M[2] * center[0] + M[6] * center[1] + M[10] * center[2];
+
+	uint64_t	depth = depthBits(-z);
+	uint64_t	state = (uint64_t(program & 0xff) << 22) | (uint64_t(texture & 0xfff) << 10) | uint64_t(material & 0x3ff);
+
+	if (pass == PASS_OPAQUE)
+		item.key = (uint64_t(PASS_OPAQUE) << 62) | (state << 32) | depth;
+	else
+		item.key = (uint64_t(PASS_TRANSPARENT) << 62) | ((~depth & 0xffffffff) << 30) | state;	// Back to front
+
+	queue.items.push_back(item);
+}
+
+void
+radixSort(std::vector<uint64_t>& keys, std::vector<int>& order, std::vector<uint64_t>& keysTmp,
+	std::vector<int>& orderTmp)
+{
+	int	n = int(keys.size());
+
+	order.resize(n);
+	for (int i = 0; i < n; i++) order[i] = i;
+	if (n < 2) return;
+
+	keysTmp.resize(n);
+	orderTmp.resize(n);
+
+	// Bits that differ among the keys
+	uint64_t	varying = 0;
+	for (int i = 1; i < n; i++) varying |= keys[i] ^ keys[0];
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		if (((varying >> shift) & 0xff) == 0) continue;
+
+		// Histogram and its exclusive prefix sum
+		int	count[256] = { 0 };
+		for (int i = 0; i < n; i++) count[(keys[i] >> shift) & 0xff]++;
+
+		int	sum = 0;
+		for (int b = 0; b < 256; b++) { int c = count[b]; count[b] = sum; sum += c; }
+
+		// Stable scatter
+		for (int i = 0; i < n; i++)
+		{
+			int	j = count[(keys[i] >> shift) & 0xff]++;
+			keysTmp[j] = keys[i];
+			orderTmp[j] = order[i];
+		}
+
+		keys.swap(keysTmp);
+		order.swap(orderTmp);
+	}
+}
+
+// Fixed-function state of a pass
+static void
+setupPass(const RenderQueue& queue, RenderPass pass)
+{
+	if (pass == PASS_OPAQUE)
+	{
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+
+		// Solid objects do not require two-sided lighting.
+		glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_FALSE);
+	}
+	else
+	{
+		glDepthMask(queue.depthMask);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		// Back faces should be shaded in transparent objects.
+		glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+	}
+}
+
+static void
+setupMaterial(const Material& m)
+{
+	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, m.ambient);
+	glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, m.diffuse);
+	glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, m.specular);
+	glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, m.shininess);
+}
+
+// Pass, program, texture and material changes after the previous item, all of them first
+static int
+stateChanges(const DrawItem* prev, const DrawItem& item)
+{
+	if (!prev) return 4;
+
+	return int(item.pass != prev->pass) + int(item.program != prev->program)
+		+ int(item.texture != prev->texture) + int(item.material != prev->material);
+}
+
+void
+flushRenderQueue(RenderQueue& queue)
+{
+	int	n = int(queue.items.size());
+
+	queue.keys.resize(n);
+	for (int i = 0; i < n; i++) queue.keys[i] = queue.items[i].key;
+	radixSort(queue.keys, queue.order, queue.keysTmp, queue.orderTmp);
+
+	RenderQueueStats	stats;
+	stats.nItems = n;
+
+	// The same detector over the order of submission, i.e. drawing without the queue
+	for (int i = 0; i < n; i++)
+		stats.nInlineChanges += stateChanges(i ? &queue.items[i - 1] : NULL, queue.items[i]);
+
+	// Nothing is known about the current state at the beginning.
+	const DrawItem*	prev = NULL;
+
+	glPushMatrix();
+	for (int i = 0; i < n; i++)
+	{
+		const DrawItem&	item = queue.items[queue.order[i]];
+		stats.nStateChanges += stateChanges(prev, item);
+
+		if (!prev || item.pass != prev->pass)
+			setupPass(queue, item.pass);
+
+		if (!prev || item.program != prev->program)
+			glUseProgram(item.program);
+
+		if (!prev || item.texture != prev->texture)
+		{
+			if (item.texture)
+			{
+				glEnable(GL_TEXTURE_2D);
+				glBindTexture(GL_TEXTURE_2D, item.texture);
+			}
+			else	glDisable(GL_TEXTURE_2D);
+		}
+
+		if (!prev || item.material != prev->material)
+			setupMaterial(queue.materials[item.material]);
+
+		glLoadMatrixf(item.modelView);
+		item.draw(item.arg);
+
+		prev = &item;
+	}
+	glPopMatrix();
+
+	glUseProgram(0);
+
+	queue.stats = stats;
+	queue.items.clear();
+}
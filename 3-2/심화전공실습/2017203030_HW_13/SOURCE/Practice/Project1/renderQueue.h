@@ -0,0 +1,93 @@
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+
+#include "glSetup.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// State-sorted render queue: draw items are collected during the frame with a
+// 64-bit sort key, radix-sorted, and submitted with the redundant state changes
+// filtered out.
+//
+// Key layout from the most significant bit:
+//	opaque:			pass (2) | program (8) | texture (12) | material (10) | depth (32)
+//	transparent:	pass (2) | inverted depth (32) | program (8) | texture (12) | material (10)
+// Opaque items are grouped by state and drawn front to back within a group.
+// Transparent items are drawn back to front first, grouped by state only at equal depths.
+
+enum RenderPass
+{
+	PASS_OPAQUE = 0,
+	PASS_TRANSPARENT = 1
+};
+
+struct Material
+{
+	GLfloat	ambient[4];
+	GLfloat	diffuse[4];
+	GLfloat	specular[4];
+	GLfloat	shininess;
+};
+
+// Draw call of an item, e.g. a mesh or a face of a cube selected by the argument
+typedef void (*DrawFunc)(int arg);
+
+struct DrawItem
+{
+	uint64_t	key;
+
+	RenderPass	pass;
+	GLuint		program;	// 0 for the fixed-function pipeline
+	GLuint		texture;	// 0 for no texture
+	int			material;	// Index into the material table
+
+	GLfloat		modelView[16];	// Captured at the submission
+	DrawFunc	draw;
+	int			arg;
+};
+
+struct RenderQueueStats
+{
+	int		nItems;
+	int		nStateChanges;	// Pass, program, texture and material changes submitted
+	int		nInlineChanges;	// Same changes in the order of submission, i.e. without the queue
+
+	RenderQueueStats() { nItems = 0; nStateChanges = 0; nInlineChanges = 0; }
+};
+
+struct RenderQueue
+{
+	std::vector<Material>	materials;
+	std::vector<DrawItem>	items;
+
+	// Work buffers of the radix sort
+	std::vector<uint64_t>	keys, keysTmp;
+	std::vector<int>		order, orderTmp;
+
+	bool	depthMask;			// Depth writes of the transparent pass
+
+	RenderQueueStats	stats;	// Of the last submission
+
+	RenderQueue() { depthMask = false; }
+};
+
+// Register a material once and refer to it by the returned index
+int		addMaterial(RenderQueue& queue, const Material& material);
+Material	coloredMaterial(float r, float g, float b, float a = 1);
+
+// Queue an item with the current modelview matrix. The depth is taken at the center
+// given in the object coordinate system, or at the origin.
+void	submitDrawItem(RenderQueue& queue, RenderPass pass, GLuint program, GLuint texture, int material,
+	DrawFunc draw, int arg = 0, const GLfloat* center = NULL);
+
+// Sort the items, draw them and clear the queue for the next frame
+void	flushRenderQueue(RenderQueue& queue);
+
+// Stable LSD radix sort of the keys by 8 bits, skipping the bytes shared by all the keys.
+// The keys are sorted in place and order receives the permutation.
+void	radixSort(std::vector<uint64_t>& keys, std::vector<int>& order, std::vector<uint64_t>& keysTmp,
+	std::vector<int>& orderTmp);
+
+#endif	// _RENDER_QUEUE_H_
@@ -0,0 +1,108 @@
+#ifndef _TEXTURE_STREAM_H_
+#define _TEXTURE_STREAM_H_
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asynchronous loading of raw texture files.
+// Worker threads read the files, expand the texels to RGBA and build the mipmap chain.
+// The main thread copies the levels, coarsest first, in strips of rows into a ring of
+// pixel unpack buffers and issues glTexSubImage2D() from them, within a time budget per
+// frame. GL_TEXTURE_BASE_LEVEL follows the finest level completed, so a texture is
+// usable, blurry at first, as soon as its coarsest level has arrived.
+//
+// The buffers are persistently mapped if ARB_buffer_storage is available, otherwise
+// mapped unsynchronized for each strip. A fence per buffer keeps the CPU from overwriting
+// a strip that the GPU has not read yet. Without ARB_sync the strips are uploaded
+// directly from the client memory, still spread over the frames.
+enum TextureStreamMode { STREAM_DIRECT, STREAM_MAPPED, STREAM_PERSISTENT };
+
+// A raw file of w x h texels of n channels to be loaded into the texture
+struct TextureStreamRequest
+{
+	GLuint		texture;
+	std::string	filename;
+	int			w, h, n;
+	GLenum		internalFormat;		// GL_RGB8 or GL_RGBA8
+
+	// A single channel file as the alpha of the constant color, otherwise gray replicated to RGB
+	bool		alphaOnly;
+	GLubyte		color[3];
+
+	TextureStreamRequest() { texture = 0; w = h = n = 0; internalFormat = GL_RGBA8; alphaOnly = false; color[0] = color[1] = color[2] = 0; }
+};
+
+// RGBA texels of all the levels, level 0 the finest
+struct TextureStreamImage
+{
+	TextureStreamRequest				request;
+	bool								ok;
+	size_t								nRead;		// Bytes read from the file
+	std::vector<std::vector<GLubyte> >	levels;
+	std::vector<int>					lw, lh;
+
+	// Upload cursor: the level being uploaded from the coarsest, and its next row
+	int		level;
+	int		row;
+
+	TextureStreamImage() { ok = false; nRead = 0; level = -1; row = 0; }
+};
+
+struct TextureStreamBuffer
+{
+	GLuint		pbo;
+	GLubyte*	ptr;	// Persistent mapping
+	GLsync		fence;	// After the last read from the buffer
+	size_t		used;	// Bytes written since the fence signaled
+
+	TextureStreamBuffer() { pbo = 0; ptr = NULL; fence = 0; used = 0; }
+};
+
+struct TextureStreamer
+{
+	TextureStreamMode					mode;
+	std::vector<TextureStreamBuffer>	buffers;
+	int									current;	// Buffer in the ring being written
+
+	// Worker threads and their queues
+	std::vector<std::thread>			workers;
+	std::mutex							mutex;
+	std::condition_variable				wakeUp;
+	std::deque<TextureStreamRequest>	requests;
+	std::deque<TextureStreamImage*>		decoded;
+	bool								quit;
+
+	// Images being uploaded, in the order of arrival
+	std::deque<TextureStreamImage*>		uploads;
+	int									nPending;	// Requested, not yet completely uploaded
+
+	// Statistics
+	double		startTime;
+	double		maxUpdateTime;		// Longest updateTextureStreamer() in seconds
+	size_t		bytesUploaded;
+	int			nTextures;
+
+	TextureStreamer() { mode = STREAM_DIRECT; current = 0; quit = false; nPending = 0;
+		startTime = 0; maxUpdateTime = 0; bytesUploaded = 0; nTextures = 0; }
+};
+
+// Start the workers and create the buffers in the current OpenGL context
+void	createTextureStreamer(TextureStreamer& ts, int nWorkers = 0);	// 0 for the number of cores - 1
+void	deleteTextureStreamer(TextureStreamer& ts);
+
+// Queue a raw file for the texture. The wrapping and filtering parameters are left to the caller.
+void	streamTexture(TextureStreamer& ts, const TextureStreamRequest& request);
+
+// Upload the decoded levels for at most the given time in seconds. Call once per frame.
+void	updateTextureStreamer(TextureStreamer& ts, double budget = 0.001);
+
+// All the requested textures are completely uploaded
+bool	textureStreamerIdle(const TextureStreamer& ts);
+
+#endif	// _TEXTURE_STREAM_H_
@@ -1,8 +1,18 @@
 #include "glSetup.h"
 
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <iostream>
+#include <vector>
 using namespace std;
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>		//timeBeginPeriod() in winmm.lib
+#endif
 bool	perspectiveView = true;
 float	screenScale = 0.5f;		//Portion of the screen when not using full screen
 int		screenW = 0, screenH = 0;	//screenSca1e portion of the screen
@@ -19,6 +29,29 @@ float	fovy = 46.4f;		 		//fovy of 28mm lens in degree
 float	nearDist = 1.0f;
 float	farDist = 20.0f;
 
+bool	profiling = false;			//Frame timing, zones and the overlay
+
+// Profiler on the CPU only, as the OpenGL 2.1 context without GLEW has no timer queries
+static const int		PROFILE_HISTORY = 240;			//Frames in the histogram and the overlay
+static const size_t		PROFILE_MAX_EVENTS = 1 << 20;	//Trace events kept for the export
+
+struct ProfileEvent
+{
+	const char*	name;
+	double		begin, end;		//Seconds of glfwGetTime()
+};
+
+static const char*			traceFile = NULL;		//Chrome trace-event JSON written at the end
+static const char*			windowTitle = "";
+static int					frameIndex = 0;
+static double				frameBegin = 0;
+static double				titleTime = 0;
+static vector<ProfileEvent>	openZones;				//end unused until closed
+static vector<ProfileEvent>	events;
+static float				cpuFrameTimes[PROFILE_HISTORY];	//Ring in ms
+static int					nCpuFrameTimes = 0;
+static char					overlayText[64];		//Percentiles over the graph, refreshed with the title
+
 void
 errorCallback(int error, const char* description)
 {
@@ -52,9 +85,256 @@ reshape(GLFWwindow* window, int w, int h)
 	cerr << " with screeen " << screenW << " x " << screenH << endl;
 }
 
+// Options of the profiler from the command line or the environment
+static void
+parseOptions(int argc, char* argv[])
+{
+	const char*	env = getenv("GL_PROFILE");
+	if (env && env[0] && strcmp(env, "0") != 0) profiling = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char*	arg = argv[i];
+		if (strcmp(arg, "--profile") == 0)				profiling = true;
+		else if (strncmp(arg, "--trace=", 8) == 0)		{ profiling = true; traceFile = arg + 8; }
+	}
+}
+
+// Profiling
+//
+static void
+addEvent(const char* name, double begin, double end)
+{
+	if (events.size() >= PROFILE_MAX_EVENTS) return;
+
+	ProfileEvent	e = { name, begin, end };
+	events.push_back(e);
+}
+
+static float
+percentile(const float* ring, int n, float p)
+{
+	int	count = (n < PROFILE_HISTORY) ? n : PROFILE_HISTORY;
+	if (count == 0) return 0;
+
+	vector<float>	sorted(ring, ring + count);
+	size_t	k = size_t(p * (count - 1) + 0.5f);
+	nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+	return sorted[k];
+}
+
+// A GPU zone is timed on the CPU like the others.
+void
+profileBeginZone(const char* name, bool gpu)
+{
+	if (!profiling) return;
+
+	ProfileEvent	z = { name, glfwGetTime(), 0 };
+	openZones.push_back(z);
+}
+
+void
+profileEndZone()
+{
+	if (!profiling || openZones.empty()) return;
+
+	ProfileEvent	z = openZones.back();
+	openZones.pop_back();
+	addEvent(z.name, z.begin, glfwGetTime());
+}
+
+static void
+beginProfileFrame()
+{
+	// Frame time from the beginning of the previous frame, the swap included
+	double	now = glfwGetTime();
+	if (frameIndex > 0)
+	{
+		cpuFrameTimes[nCpuFrameTimes % PROFILE_HISTORY] = float((now - frameBegin) * 1000.0);
+		nCpuFrameTimes++;
+	}
+	frameBegin = now;
+}
+
+// Seven-segment glyphs, the bits 0 to 6 for the segments a to g:
+// a top, b upper right, c lower right, d bottom, e lower left, f upper left and g middle
+static int
+glyphSegments(char c)
+{
+	switch (c)
+	{
+	case '0': return 0x3F;	case '1': return 0x06;	case '2': return 0x5B;	case '3': return 0x4F;
+	case '4': return 0x66;	case '5': return 0x6D;	case '6': return 0x7D;	case '7': return 0x07;
+	case '8': return 0x7F;	case '9': return 0x6F;	case 'C': return 0x39;	case 'G': return 0x3D;
+	case 'P': return 0x73;	case 'U': return 0x3E;	case '-': return 0x40;
+	default: return 0;
+	}
+}
+
+static void
+clearRect(int x, int y, int w, int h)
+{
+	glScissor(x, y, w, h);
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
+// Digits, '.' and the letters above in strokes of s pixels, 7s high, with scissored clears
+static void
+drawSegmentText(const char* text, int x, int y, int s)
+{
+	int	w = 4 * s;
+	for (const char* c = text; *c; c++)
+	{
+		if (*c == '.')	{ clearRect(x, y, s, s);	x += 2 * s;	continue; }
+		if (*c == ' ')	{ x += 3 * s;	continue; }
+
+		int	g = glyphSegments(*c);
+		if (g & 0x01) clearRect(x, y + 6 * s, w, s);
+		if (g & 0x02) clearRect(x + w - s, y + 3 * s, s, 4 * s);
+		if (g & 0x04) clearRect(x + w - s, y, s, 4 * s);
+		if (g & 0x08) clearRect(x, y, w, s);
+		if (g & 0x10) clearRect(x, y, s, 4 * s);
+		if (g & 0x20) clearRect(x, y + 3 * s, s, 4 * s);
+		if (g & 0x40) clearRect(x, y + 3 * s, w, s);
+		x += w + 2 * s;
+	}
+}
+
+// Bars of the recent frame times from the bottom left with a line at 60 Hz and
+// the p50/p95/p99 above, drawn by scissored clears so that it works
+// in any context with any program bound
+static void
+drawProfileOverlay()
+{
+	GLboolean	scissor = glIsEnabled(GL_SCISSOR_TEST);
+	GLint		box[4];
+	GLfloat		clearColor[4];
+	glGetIntegerv(GL_SCISSOR_BOX, box);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+
+	int		barW = (dpiScaling > 1) ? int(2 * dpiScaling) : 2;
+	int		maxH = (dpiScaling > 1) ? int(100 * dpiScaling) : 100;
+	float	maxMs = 100.0f / 3;		//Top of the graph
+
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(0, 0, PROFILE_HISTORY * barW, maxH);
+	glClearColor(0, 0, 0, 1);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	int	count = (nCpuFrameTimes < PROFILE_HISTORY) ? nCpuFrameTimes : PROFILE_HISTORY;
+	for (int i = 0; i < count; i++)
+	{
+		float	ms = cpuFrameTimes[(nCpuFrameTimes - count + i) % PROFILE_HISTORY];
+		int		h = (ms < maxMs) ? int(ms / maxMs * maxH) : maxH;
+
+		if (ms < 17)		glClearColor(0.2f, 0.8f, 0.2f, 1);
+		else if (ms < 34)	glClearColor(0.9f, 0.8f, 0.1f, 1);
+		else				glClearColor(0.9f, 0.2f, 0.1f, 1);
+
+		glScissor(i * barW, 0, barW - 1, (h > 0) ? h : 1);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	glClearColor(0.6f, 0.6f, 0.6f, 1);
+	glScissor(0, int(1000.0f / 60 / maxMs * maxH), PROFILE_HISTORY * barW, 1);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// Percentiles in ms on a band above the graph
+	int	s = (dpiScaling > 1) ? int(2 * dpiScaling) : 2;
+
+	glClearColor(0, 0, 0, 1);
+	clearRect(0, maxH, PROFILE_HISTORY * barW, 11 * s);
+	glClearColor(0.9f, 0.9f, 0.9f, 1);
+	drawSegmentText(overlayText, s, maxH + 2 * s, s);
+
+	// Restore the state of the demo
+	glScissor(box[0], box[1], box[2], box[3]);
+	if (!scissor) glDisable(GL_SCISSOR_TEST);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+}
+
+static void
+endProfileFrame(GLFWwindow* window)
+{
+	// Zones left open are not carried into the next frame.
+	openZones.clear();
+
+	double	now = glfwGetTime();
+	addEvent("frame", frameBegin, now);
+	frameIndex++;
+
+	drawProfileOverlay();
+
+	// Percentiles in the title twice a second
+	if (now - titleTime > 0.5)
+	{
+		snprintf(overlayText, sizeof(overlayText), "CPU P50 %.2f P95 %.2f P99 %.2f",
+			percentile(cpuFrameTimes, nCpuFrameTimes, 0.50f), percentile(cpuFrameTimes, nCpuFrameTimes, 0.95f),
+			percentile(cpuFrameTimes, nCpuFrameTimes, 0.99f));
+
+		char	title[256];
+		snprintf(title, sizeof(title), "%s | %s ms", windowTitle, overlayText);
+		glfwSetWindowTitle(window, title);
+		titleTime = now;
+	}
+}
+
+// Chrome trace-event JSON for chrome://tracing or Perfetto
+static void
+saveTrace(const char* filename)
+{
+	FILE*	fp = fopen(filename, "w");
+	if (!fp)
+	{
+		cerr << "ERROR: Fail in opening " << filename << endl;
+		return;
+	}
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}}");
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		const ProfileEvent&	e = events[i];
+		fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+			e.name, e.begin * 1e6, (e.end - e.begin) * 1e6);
+	}
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+
+	cerr << "Status: Trace of " << events.size() << " events saved in " << filename << endl;
+}
+
+static void
+finishProfile()
+{
+	cout << "Status: Frame time over " << ((nCpuFrameTimes < PROFILE_HISTORY) ? nCpuFrameTimes : PROFILE_HISTORY)
+		<< " frames p50 " << percentile(cpuFrameTimes, nCpuFrameTimes, 0.50f)
+		<< " p95 " << percentile(cpuFrameTimes, nCpuFrameTimes, 0.95f)
+		<< " p99 " << percentile(cpuFrameTimes, nCpuFrameTimes, 0.99f) << " ms" << endl;
+
+	if (traceFile) saveTrace(traceFile);
+}
+
+void
+swapBuffers(GLFWwindow* window)
+{
+	if (profiling) endProfileFrame(window);
+
+	glfwSwapBuffers(window);
+
+	// The last frame closes the profile.
+	if (profiling)
+	{
+		if (glfwWindowShouldClose(window)) finishProfile();
+		else beginProfileFrame();
+	}
+}
+
 GLFWwindow*
 initializeOpenGL(int argc, char* argv[], GLfloat bgColor[4])
 {
+	parseOptions(argc, argv);
+
 	glfwSetErrorCallback(errorCallback);		////////// 
 	// Init GLFW
 	if (!glfwInit()) exit(EXIT_FAILURE);
@@ -113,6 +393,12 @@ initializeOpenGL(int argc, char* argv[], GLfloat bgColor[4])
 	// Vertical sync ...
 	glfwSwapInterval(vsync);	// 0 for immediate mode (Tearing possible)
 
+	if (profiling)
+	{
+		windowTitle = argv[0];
+		beginProfileFrame();
+	}
+
 	return window;
 }
 
@@ -128,3 +414,92 @@ drawAxes(float l, float w)
 	glColor3f(0, 0, 1);	glVertex3f(0, 0, 0);	glVertex3f(0, 0, 2); 	// z-axis
 	glEnd();
 }
+
+// Frame scheduler
+//
+void
+initializeScheduler(FrameScheduler& fs, double timeStep, double frameInterval)
+{
+	fs = FrameScheduler();
+	fs.timeStep = timeStep;
+	fs.frameInterval = (frameInterval > 0) ? frameInterval : timeStep;
+	fs.maxSteps = (timeStep < 0.1) ? int(0.1 / timeStep) : 1;	//Up to 100ms of updates in a frame
+
+	fs.previous = glfwGetTime();
+	fs.deadline = fs.previous + fs.frameInterval;
+
+#ifdef _WIN32
+	// 1ms sleeps instead of the 15.6ms default
+	if (timeBeginPeriod(1) == TIMERR_NOERROR) fs.timerPeriod = 1;
+#endif
+}
+
+void
+finalizeScheduler(FrameScheduler& fs)
+{
+#ifdef _WIN32
+	if (fs.timerPeriod) timeEndPeriod(fs.timerPeriod);
+#endif
+	fs.timerPeriod = 0;
+}
+
+int
+waitNextFrame(FrameScheduler& fs)
+{
+	// Sleep through most of the remaining time, woken early only by the events,
+	// and spin for the last stretch shorter than the timer granularity
+	const double	spinMargin = 0.002;
+	for (;;)
+	{
+		double	remaining = fs.deadline - glfwGetTime();
+		if (remaining <= 0) break;
+		if (remaining > spinMargin) glfwWaitEventsTimeout(remaining - spinMargin);
+	}
+	glfwPollEvents();
+
+	double	now = glfwGetTime();
+	double	interval = now - fs.previous;
+	fs.previous = now;
+
+	// Achieved rate and jitter
+	if (now - fs.deadline > fs.maxLate) fs.maxLate = now - fs.deadline;
+	fs.nFrames++;
+	fs.sumInterval += interval;
+	fs.sumInterval2 += interval * interval;
+
+	// Next deadline on the same grid, or a full interval from now if already missed
+	fs.deadline += fs.frameInterval;
+	if (fs.deadline <= now) fs.deadline = now + fs.frameInterval;
+
+	// Fixed steps due, dropping the time beyond maxSteps after a long stall
+	fs.accumulator += interval;
+	int	steps = int(fs.accumulator / fs.timeStep);
+	if (steps > fs.maxSteps)
+	{
+		steps = fs.maxSteps;
+		fs.accumulator = steps * fs.timeStep;
+	}
+	fs.accumulator -= steps * fs.timeStep;
+
+	return steps;
+}
+
+float
+interpolationAlpha(const FrameScheduler& fs)
+{
+	return float(fs.accumulator / fs.timeStep);
+}
+
+void
+printSchedulerStats(const FrameScheduler& fs)
+{
+	if (fs.nFrames == 0) return;
+
+	double	mean = fs.sumInterval / fs.nFrames;
+	double	variance = fs.sumInterval2 / fs.nFrames - mean * mean;
+	double	jitter = (variance > 0) ? sqrt(variance) : 0;
+
+	cout << "Status: " << fs.nFrames << " frames at " << 1.0 / mean << " fps"
+		<< " (target " << 1.0 / fs.frameInterval << "), jitter " << jitter * 1000.0 << " ms"
+		<< ", late at most " << fs.maxLate * 1000.0 << " ms" << endl;
+}
@@ -29,4 +29,68 @@ void		setupProjectionMatrix();
 
 void		drawAxes(float l, float w);
 
+void		swapBuffers(GLFWwindow* window);	// glfwSwapBuffers() delimiting the frames of the profiler
+
+// Profiler enabled by --profile, --trace=file.json or GL_PROFILE=1:
+//	PROFILE_ZONE("name")		CPU time of the enclosing scope
+//	PROFILE_GPU_ZONE("name")	the same, as there are no timer queries in this context
+// swapBuffers() delimits the frames and draws the frame-time graph over the bottom left
+// with the p50/p95/p99 on it and in the title. At the end the percentiles are printed
+// and the zones are saved in the Chrome trace-event format. The names must be string literals.
+extern bool		profiling;
+
+void		profileBeginZone(const char* name, bool gpu);
+void		profileEndZone();
+
+struct ProfileScope
+{
+	ProfileScope(const char* name, bool gpu) { profileBeginZone(name, gpu); }
+	~ProfileScope() { profileEndZone(); }
+};
+
+#define PROFILE_CONCAT_(a, b)	a##b
+#define PROFILE_CONCAT(a, b)	PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name)		ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, false)
+#define PROFILE_GPU_ZONE(name)	ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+
+// Fixed-step frame scheduler: the updates advance by exactly timeStep, as many per frame as
+// the elapsed time calls for, and the loop sleeps in glfwWaitEventsTimeout() until shortly
+// before the next frame instead of polling the clock.
+struct FrameScheduler
+{
+	double	timeStep;		// Fixed update interval
+	double	frameInterval;	// Target interval between the frames
+	int		maxSteps;		// Updates in a frame at most
+
+	double	accumulator;	// Time not yet consumed by the updates
+	double	previous;		// Beginning of the previous frame
+	double	deadline;		// Beginning of the next frame
+
+	// Achieved rate and jitter
+	int		nFrames;
+	double	sumInterval, sumInterval2;
+	double	maxLate;		// Wake-up after the deadline at most
+
+	int		timerPeriod;	// ms of timeBeginPeriod() to restore, 0 if not raised
+
+	FrameScheduler()
+	{
+		timeStep = frameInterval = 0; maxSteps = 1;
+		accumulator = previous = deadline = 0;
+		nFrames = 0; sumInterval = sumInterval2 = 0; maxLate = 0;
+		timerPeriod = 0;
+	}
+};
+
+void		initializeScheduler(FrameScheduler& fs, double timeStep, double frameInterval = 0);	// 0 for timeStep
+void		finalizeScheduler(FrameScheduler& fs);	// Restore the timer resolution
+
+// Sleep until the next frame, poll the events and return the number of updates due
+int			waitNextFrame(FrameScheduler& fs);
+
+// Fraction of a step not yet simulated, for drawing between the last two states
+float		interpolationAlpha(const FrameScheduler& fs);
+
+void		printSchedulerStats(const FrameScheduler& fs);
+
 #endif	// __GL_SETUP_H_
\ No newline at end of file
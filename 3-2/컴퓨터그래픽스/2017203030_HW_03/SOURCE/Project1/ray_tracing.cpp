@@ -40,7 +40,7 @@ bool	rayTracingRequired = true;
 // How to draw rendered images texture mapping/direct drawing pixels
 bool	textureMapping = true;
 
-bool	profiling = false;
+bool	printSteps = false;	// Time steps of each frame on the console
 
 // OpenMP
 bool	useOpenMP = true;
@@ -321,6 +321,8 @@ setPixelValue(int i, int j, const vec3& I)
 void
 rayTracing()
 {
+	PROFILE_ZONE("rayTracing");
+
 	// Viewing matrix	
 	{
 		// The camera faces the negative z-axis as in OpenGL.
@@ -527,32 +529,23 @@ main(int argc, char* argv[])
 	init();
 
 	// Main loop
-	float previous = (float)glfwGetTime();
-	float elapsed = 0;
+	FrameScheduler	scheduler;
+	initializeScheduler(scheduler, timeStep);
 	while (!glfwWindowShouldClose(window))
 	{
-		glfwPollEvents();			// Events
-
-		// Time passed during a single loop
-		float now = (float)glfwGetTime();
-		float delta = now - previous;
-		previous = now;
-
-		// Time passed after the previous frame
-		elapsed += delta;
+		// Sleep until the next frame, then the events and the time steps due
+		int	steps = waitNextFrame(scheduler);
 
 		// Time stepping
-		if (elapsed > timeStep)
+		if (steps > 0)
 		{
-			if (profiling) cout << "elapsed = " << elapsed << endl;
+			if (printSteps) cout << "steps = " << steps << endl;
 
 			if (!pause) // Animate if not paused
 			{
-				currTime += elapsed;
+				currTime += steps * timeStep;
 				rayTracingRequired = true; // Request for new ray tracing
 			}
-
-			elapsed = 0;	// Reset the elapsed time
 		}
 
 
@@ -579,6 +572,7 @@ main(int argc, char* argv[])
 			rayTracing();
 			rayTracingRequired = false;
 
+			PROFILE_ZONE("display");
 			if (textureMapping) // Employ texture mapping to display the ray-traced image
 			{
 				// Draw a textured opaque quad to display the ray-traced image
@@ -592,9 +586,11 @@ main(int argc, char* argv[])
 				glDrawPixels(m, n, GL_RGB, GL_UNSIGNED_BYTE, image);
 			}
 
-			glfwSwapBuffers(window);	// Swap buffers
+			swapBuffers(window);	// Swap buffers
 		}
 	}
+	printSchedulerStats(scheduler);
+	finalizeScheduler(scheduler);
 
 	// Finalization
 	quit();
@@ -669,7 +665,7 @@ keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
 			// Direct drawing or texture mapping
 		case GLFW_KEY_T:
 			textureMapping = !textureMapping;
-			profiling = true;
+			printSteps = true;
 			if (textureMapping) cout << "Texture Mapping" << endl;
 			else	cout << "Direct Drawing" << endl;
 			break;
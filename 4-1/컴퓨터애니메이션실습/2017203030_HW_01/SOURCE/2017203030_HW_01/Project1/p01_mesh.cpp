@@ -119,7 +119,7 @@ main(int argc, char* argv[])
 		}
 
 		render(window);				//	Draw one frame
-		glfwSwapBuffers(window);	// Swap buffers
+		swapBuffers(window);		// Swap buffers, or read back the frame in the headless mode
 	}
 
 	//	Terminate the glfw system
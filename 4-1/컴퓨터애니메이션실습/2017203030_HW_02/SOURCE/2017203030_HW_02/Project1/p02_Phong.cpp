@@ -172,7 +172,7 @@ main(int argc, char* argv[])
 		if (phong)	render(window, programPhong, vao, numTris, ModelMatrix);
 		else		render(window, programGouraud, vao, numTris, ModelMatrix);
 
-		glfwSwapBuffers(window);	// Swap buffers
+		swapBuffers(window);		// Swap buffers, or read back the frame in the headless mode
 		glfwPollEvents();			// Events
 	}
 	
@@ -4,6 +4,10 @@
 
 #include "glShader.h"
 
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
 #include <iostream>
 using namespace std;
 
@@ -96,57 +100,321 @@ printProgramInfoLog(GLuint obj)
 	delete[] infoLog;
 }
 
-GLuint
-createShaderFromFile(GLenum shaderType, const char* filename)
+// Issue the compilation without waiting for its result. glGetError() would stall until
+// the driver catches up, so the errors are checked when the compilation is complete.
+static GLuint
+compileShader(GLenum shaderType, const char* shaderSource, const char* filename)
 {
-	//	Create the vertex shader
+	//	Create the shader
 	GLuint  shader = glCreateShader(shaderType);
-	if (isOK("glCreateShader()", __FILE__, __LINE__) == false)	return	0;
-
 	if (shader == 0)
 	{
 		cerr << "ERROR: Fail in creating the shader for " << filename << endl;
 		return 0;
 	}
 
+	// Set the shader source and compile the shader
+	glShaderSource(shader, 1, &shaderSource, NULL);
+	glCompileShader(shader);
+
+	return  shader;
+}
+
+GLuint
+createShaderFromSource(GLenum shaderType, const char* shaderSource, const char* filename)
+{
+	GLuint	shader = compileShader(shaderType, shaderSource, filename);
+	if (isOK("compileShader()", __FILE__, __LINE__) == false) return 0;
+
+	// Print the compile error if exists
+	if (shader) printShaderInfoLog(shader, filename);
+
+	return  shader;
+}
+
+GLuint
+createShaderFromFile(GLenum shaderType, const char* filename)
+{
 	// Read the shader file into a string
 	const char* shaderSource = readShader(filename);
 	if (shaderSource == NULL) return 0;
 
-	// Set the shader source
-	glShaderSource(shader, 1, &shaderSource, NULL);
+	GLuint	shader = createShaderFromSource(shaderType, shaderSource, filename);
 
 	// Delete the string read from the shader file
 	delete[] shaderSource;
 
-	if (isOK("glShaderSource()", __FILE__, __LINE__) == false) return 0;
+	return	shader;
+}
 
-	// Compile the shader
-	glCompileShader(shader);
-	if (isOK("glCompileShader()", __FILE__, __LINE__) == false) return 0;
+// Program binary cache
+//
+bool	programBinaryCache = true;
 
-	// Print the compile error if exists
-	printShaderInfoLog(shader, filename);
+struct ProgramBinaryHeader
+{
+	char		magic[4];	// "PGBN"
+	uint32_t	format;		// Binary format of the driver
+	uint64_t	key;		// Hash of the sources and the driver
+	uint32_t	length;		// # bytes of the binary following the header
+	uint32_t	padding;
+};
 
-	return  shader;
+void
+programCacheFileName(const char* vertexShaderFile, const char* fragmentShaderFile, char* cacheFilename, size_t size)
+{
+	// Next to the vertex shader: "sv02_Phong.glsl" and "sf02_Phong.glsl" -> "sv02_Phong+sf02_Phong.pgb"
+	string	v = vertexShaderFile;
+	string	f = fragmentShaderFile;
+
+	size_t	slash = f.find_last_of("/\\");
+	if (slash != string::npos) f.erase(0, slash + 1);
+	size_t	dot = f.find_last_of('.');
+	if (dot != string::npos) f.erase(dot);
+
+	slash = v.find_last_of("/\\");
+	dot = v.find_last_of('.');
+	if (dot != string::npos && (slash == string::npos || dot > slash)) v.erase(dot);
+
+	snprintf(cacheFilename, size, "%s+%s.pgb", v.c_str(), f.c_str());
+}
+
+// FNV-1a including the null terminator to separate the strings
+static uint64_t
+hashString(uint64_t h, const char* s)
+{
+	if (s == NULL) s = "";
+	do { h ^= (unsigned char)*s; h *= 1099511628211ull; } while (*s++);
+	return h;
+}
+
+// The binary is valid only for the same sources on the same driver.
+static uint64_t
+programCacheKey(const char* vertexSource, const char* fragmentSource)
+{
+	uint64_t	h = 14695981039346656037ull;
+	h = hashString(h, vertexSource);
+	h = hashString(h, fragmentSource);
+	h = hashString(h, (const char*)glGetString(GL_VENDOR));
+	h = hashString(h, (const char*)glGetString(GL_RENDERER));
+	h = hashString(h, (const char*)glGetString(GL_VERSION));
+	return h;
+}
+
+static bool
+programBinarySupported()
+{
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) return false;
+
+	GLint	numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	return numFormats > 0;
+}
+
+// Fails silently without the cache, and with a status when it is stale or rejected by the driver.
+static bool
+loadProgramBinary(const char* filename, uint64_t key, GLuint program)
+{
+	FILE*	fp = fopen(filename, "rb");
+	if (fp == NULL) return false;
+
+	ProgramBinaryHeader	header;
+	bool	ok = fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, "PGBN", 4) == 0
+		&& header.key == key && header.length > 0;
+
+	vector<char>	binary;
+	if (ok)
+	{
+		binary.resize(header.length);
+		ok = fread(binary.data(), header.length, 1, fp) == 1;
+	}
+	fclose(fp);
+
+	if (ok)
+	{
+		glProgramBinary(program, header.format, binary.data(), header.length);
+		isOK("glProgramBinary()", __FILE__, __LINE__, false, false);	// An unknown format is no error here
+
+		GLint	linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		ok = linked == GL_TRUE;
+	}
+
+	if (!ok) cout << "Status: Stale program cache " << filename << endl;
+	return ok;
+}
+
+static void
+saveProgramBinary(const char* filename, uint64_t key, GLuint program)
+{
+	GLint	linked = GL_FALSE;
+	GLint	length = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (linked != GL_TRUE || length <= 0) return;
+
+	vector<char>	binary(length);
+	GLenum	format = 0;
+	glGetProgramBinary(program, length, NULL, &format, binary.data());
+	if (isOK("glGetProgramBinary()", __FILE__, __LINE__, false) == false) return;
+
+	ProgramBinaryHeader	header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "PGBN", 4);
+	header.format = format;
+	header.key = key;
+	header.length = uint32_t(length);
+
+	FILE*	fp = fopen(filename, "wb");
+	bool	ok = fp != NULL;
+	if (ok)
+	{
+		ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(binary.data(), length, 1, fp) == 1;
+		fclose(fp);
+	}
+
+	if (!ok)
+	{
+		cerr << "ERROR: Fail in saveProgramBinary(" << filename << ")" << endl;
+		remove(filename);
+	}
+}
+
+// Asynchronous compilation
+//
+static bool
+completed(GLuint object, bool program)
+{
+	// Without the extension the status queries below simply wait for the driver.
+	if (!GLEW_KHR_parallel_shader_compile) return true;
+
+	GLint	done = GL_FALSE;
+	if (program)	glGetProgramiv(object, GL_COMPLETION_STATUS_KHR, &done);
+	else			glGetShaderiv(object, GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+}
+
+// The compile status of the shader itself, not glGetError() that may hold older errors
+static bool
+compiled(GLuint shader)
+{
+	if (shader == 0) return true;	// Missing source: the link reports it
+
+	GLint	status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	return status == GL_TRUE;
 }
 
-// Create the shaders and the program
 void
-createShaders(const char* vertexShaderFileName, const char* fragmentShaderFileName, GLuint& program, GLuint& vertexShader, GLuint& fragmentShader)
+submitShaders(const char* vertexShaderFileName, const char* fragmentShaderFileName, AsyncProgram& ap)
+{
+	// Let the driver use as many compiler threads as it likes
+	static bool	threads = false;
+	if (!threads && GLEW_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	threads = true;
+
+	ap = AsyncProgram();
+	ap.vertexShaderFile = vertexShaderFileName;
+	ap.fragmentShaderFile = fragmentShaderFileName;
+
+	// Read the sources once for the key of the cache and the compilation
+	char*	vertexSource = readShader(vertexShaderFileName);
+	char*	fragmentSource = readShader(fragmentShaderFileName);
+
+	if (programBinaryCache && vertexSource && fragmentSource && programBinarySupported())
+	{
+		char	cacheFileName[1024];
+		programCacheFileName(vertexShaderFileName, fragmentShaderFileName, cacheFileName, sizeof(cacheFileName));
+
+		ap.key = programCacheKey(vertexSource, fragmentSource);
+		ap.cacheFile = cacheFileName;
+	}
+
+	// Create the program
+	ap.program = glCreateProgram();
+	if (ap.key && loadProgramBinary(ap.cacheFile.c_str(), ap.key, ap.program))
+	{
+		delete[] vertexSource;
+		delete[] fragmentSource;
+
+		ap.status = PROGRAM_READY;
+		return;
+	}
+
+	// Start over from a clean program if the cache has been rejected
+	if (ap.key)
+	{
+		glDeleteProgram(ap.program);
+		ap.program = glCreateProgram();
+	}
+
+	// Issue both compilations before looking at either of them
+	if (vertexSource)	ap.vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, vertexShaderFileName);
+	if (fragmentSource)	ap.fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource, fragmentShaderFileName);
+
+	delete[] vertexSource;
+	delete[] fragmentSource;
+
+	ap.status = PROGRAM_COMPILING;
+}
+
+bool
+pollShaders(AsyncProgram& ap, bool wait)
 {
-	// Create the vertex and fragment shaders
-	vertexShader = createShaderFromFile(GL_VERTEX_SHADER, vertexShaderFileName);
-	fragmentShader = createShaderFromFile(GL_FRAGMENT_SHADER, fragmentShaderFileName);
+	if (ap.status == PROGRAM_COMPILING)
+	{
+		if (!wait && !((!ap.vertexShader || completed(ap.vertexShader, false))
+			&& (!ap.fragmentShader || completed(ap.fragmentShader, false)))) return false;
+
+		// Print the compile errors if exist
+		if (ap.vertexShader)	printShaderInfoLog(ap.vertexShader, ap.vertexShaderFile.c_str());
+		if (ap.fragmentShader)	printShaderInfoLog(ap.fragmentShader, ap.fragmentShaderFile.c_str());
+
+		if (!compiled(ap.vertexShader) || !compiled(ap.fragmentShader))
+		{
+			ap.status = PROGRAM_FAILED;
+			return false;
+		}
 
-	// Create the program with the vertex and fragment shaders
-	program = glCreateProgram();
+		// Link the program with the vertex and fragment shaders
+		if (ap.vertexShader)	glAttachShader(ap.program, ap.vertexShader);
+		if (ap.fragmentShader)	glAttachShader(ap.program, ap.fragmentShader);
 
-	glAttachShader(program, vertexShader);
-	glAttachShader(program, fragmentShader);
+		if (ap.key) glProgramParameteri(ap.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+		glLinkProgram(ap.program);
+		ap.status = PROGRAM_LINKING;
+	}
+
+	if (ap.status == PROGRAM_LINKING)
+	{
+		if (!wait && !completed(ap.program, true)) return false;
+
+		printProgramInfoLog(ap.program);
+
+		GLint	linked = GL_FALSE;
+		glGetProgramiv(ap.program, GL_LINK_STATUS, &linked);
+		ap.status = (linked == GL_TRUE) ? PROGRAM_READY : PROGRAM_FAILED;
+
+		// Cache the binary for the next launch
+		if (ap.status == PROGRAM_READY && ap.key) saveProgramBinary(ap.cacheFile.c_str(), ap.key, ap.program);
+	}
+
+	return ap.status == PROGRAM_READY;
+}
+
+// Create the shaders and the program, or load the program from the binary cache.
+// The shaders are 0 when the program comes from the cache.
+void
+createShaders(const char* vertexShaderFileName, const char* fragmentShaderFileName, GLuint& program, GLuint& vertexShader, GLuint& fragmentShader)
+{
+	AsyncProgram	ap;
+	submitShaders(vertexShaderFileName, fragmentShaderFileName, ap);
+	pollShaders(ap, true);
 
-	glLinkProgram(program);
-	printProgramInfoLog(program);
+	program = ap.program;
+	vertexShader = ap.vertexShader;
+	fragmentShader = ap.fragmentShader;
 }
 
 // Delete the shaders and the program
@@ -7,6 +7,9 @@
 #include <Eigen/Dense>
 using namespace Eigen;
 
+#include <stdint.h>
+#include <string>
+
 // OpenGL Extension Wrangler Library
 
 bool	isOK(const char* message = NULL, const char* file = NULL, int line = -1, bool exitOnError = true, bool report = true);
@@ -16,11 +19,50 @@ void	createShaders(const char* vertexShaderFile, const char* fragmentShaderFile,
 	GLuint& program, GLuint& vertexShader, GLuint& fragmentShader);
 
 char*	readShader(const char* filename);
+GLuint	createShaderFromSource(GLenum shaderType, const char* shaderSource, const char* filename);
 GLuint	createShaderFromFile(GLenum shaderType, const char* filename);
 void	printShaderInfoLog(GLuint obj, const char* shaderFilename);
 void	printProgramInfoLog(GLuint obj);
 void	deleteShaders(GLuint program, GLuint vertexShader, GLuint fragmentShader);
 
+// Program binaries cached next to the vertex shaders and keyed by the sources and the driver:
+// createShaders() loads the binary instead of compiling, and recompiles and rewrites it
+// when it is stale or rejected. On by default if the driver supports program binaries.
+extern bool	programBinaryCache;
+void	programCacheFileName(const char* vertexShaderFile, const char* fragmentShaderFile, char* cacheFilename, size_t size);
+
+// Program compiled and linked in the background: both compilations are issued at once and
+// their completion is polled with GL_KHR_parallel_shader_compile without blocking the frame.
+// Without the extension the first poll waits for the driver.
+enum ProgramStatus
+{
+	PROGRAM_COMPILING,
+	PROGRAM_LINKING,
+	PROGRAM_READY,
+	PROGRAM_FAILED
+};
+
+struct AsyncProgram
+{
+	GLuint	program;
+	GLuint	vertexShader;	// 0 when the program comes from the binary cache
+	GLuint	fragmentShader;
+
+	ProgramStatus	status;
+
+	std::string	vertexShaderFile;	// For the logs
+	std::string	fragmentShaderFile;
+	std::string	cacheFile;
+	uint64_t	key;				// 0 without the binary cache
+
+	AsyncProgram() { program = 0; vertexShader = 0; fragmentShader = 0; status = PROGRAM_FAILED; key = 0; }
+};
+
+void	submitShaders(const char* vertexShaderFile, const char* fragmentShaderFile, AsyncProgram& ap);
+
+// Advance the compilation, true once the program is ready to use
+bool	pollShaders(AsyncProgram& ap, bool wait = false);
+
 // Get the location of a uniform parameter
 int getUniformLocation(GLuint program, const char* name);
 int getUniformLocation(GLuint program, const std::string& name);
@@ -1,5 +1,6 @@
 ﻿#include "glSetup.h"
 #include "glShader.h"
+#include "textureStream.h"
 
 #include <Eigen/Dense>
 using namespace Eigen;
@@ -49,22 +50,60 @@ struct Program
 {
 	GLuint vs;	// Vertex shader
 	GLuint fs;	// Fragment shader
-	GLuint pg;	// Program 54
+	GLuint pg;	// Program 54, 0 until compiled and linked
 	Program() { vs = 0; fs = 0; pg = 0; }
 
+	AsyncProgram	build;	// Compiled in the background
+
 	void
 	create(const char * vertexShaderFileName, const char* fragmentShaderFileName)
 	{
-		createShaders(vertexShaderFileName, fragmentShaderFileName, pg, vs, fs);
+		submitShaders(vertexShaderFileName, fragmentShaderFileName, build);
+	}
+
+	// Take the program once the driver has finished it, or wait for the driver
+	bool
+	ready(bool wait = false)
+	{
+		if (!pg && pollShaders(build, wait))
+		{
+			pg = build.program;
+			vs = build.vertexShader;
+			fs = build.fragmentShader;
+		}
+		return pg != 0;
 	}
 	
-	void destroy() { deleteShaders(pg, vs, fs); }
+	void destroy() { deleteShaders(build.program, build.vertexShader, build.fragmentShader); pg = 0; }
 };
 
 Program pgTexturing;	// Program for simple texturing
 Program pgDoubleVision;	// Program for double vision
 Program pgNormalMapping;	// Program for normal mapping 69
 
+double	shaderSubmitTime = 0;
+bool	shadersReady = false;
+
+// Poll all the programs without waiting, so the frames keep coming while they compile,
+// or wait for them to be complete
+void
+pollPrograms(bool wait = false)
+{
+	if (shadersReady) return;
+
+	PROFILE_ZONE("pollPrograms");
+
+	bool	ready = pgTexturing.ready(wait);
+	ready = pgDoubleVision.ready(wait) && ready;
+	ready = pgNormalMapping.ready(wait) && ready;
+
+	if (ready)
+	{
+		cout << "Status: Shaders ready in " << (glfwGetTime() - shaderSubmitTime) * 1000.0 << " ms" << endl;
+		shadersReady = true;
+	}
+}
+
 
 // Geometry
 struct Geometry
@@ -93,6 +132,9 @@ Geometry	quad;	// VAO and VBO for a single quad
 //Texture
 GLuint  texId[4];
 
+// Raw textures read and uploaded in the background
+TextureStreamer	textureStreamer;
+
 // (1) Simple texturing
 bool	simpleTexturing = false;
 
@@ -157,46 +199,34 @@ loadDemonHeadTexture()
 	isOK("glTexImage2D()", __FILE__, __LINE__);
 }
 
+// Raw texture streamed to the bound texture in the background
+static void
+streamRawTexture(const char* filename, int w, int h, int n, GLenum internalFormat, bool alphaOnly)
+{
+	GLint	texture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+
+	TextureStreamRequest	request;
+	request.texture = texture;
+	request.filename = filename;
+	request.w = w;
+	request.h = h;
+	request.n = n;
+	request.internalFormat = internalFormat;
+	request.alphaOnly = alphaOnly;	// Black
+	streamTexture(textureStreamer, request);
+}
+
 // RGB texture
 bool
 loadRawTexture(const char * filename, int w, int h, int n)
 {
-	// Open the raw texture file
-	ifstream	is(filename, ios::binary);
-	if (is.fail())
-	{
-		cout << "Can't open" << filename << endl;
-		return  false;
-	}
-
-	// Allocate memory
-
-	GLubyte* raw = new GLubyte[w * h * 3];
 	// Only 3 and 1
-	if (n == 1)
-	{
-		// Read all the texels of the single channel
-		GLubyte* rawG = new GLubyte[w * h];
-		is.read((char*)rawG, w * h * n);
-
-		for (int i = 0; i < w * h; i++)
-			raw[3 * i + 0] = raw[3 * i + 1] = raw[3 * i + 2] = rawG[i]; // RGB
-		
-		delete[] rawG;
-	}
-	else if (n == 3)
+	if (n != 3 && n != 1)
 	{
-		// Read all the texels of the rgb channels
-		is.read((char*)raw, w * h * n);
-	}
-	else	{
 		cout << "Texture images with Two channels are not supported!" << endl;
 		return  false;
 	}
-	if (!is)	cout << "Error: only " << is.gcount() << "bytes could be read!" << endl;
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, raw);
-	isOK("glTexImage2D()", __FILE__, __LINE__);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -204,9 +234,9 @@ loadRawTexture(const char * filename, int w, int h, int n)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	// Deallocate memory
-
-	delete[]	raw;
+	// The single channel is replicated to RGB by the workers.
+	streamRawTexture(filename, w, h, n, GL_RGB8, false);
+	isOK("streamRawTexture()", __FILE__, __LINE__);
 
 	return true;
 }
@@ -215,44 +245,14 @@ loadRawTexture(const char * filename, int w, int h, int n)
 bool
 loadAlphaTexture(const char * filename, int w, int h)
 {
-	// Open the raw texture file
-	ifstream	is(filename, ios::binary);
-	if (is.fail())
-	{
-		cout << "Can't open " << filename << endl;
-		return false;
-	}
-
-	// Allocate memory
-	GLubyte* raw = new GLubyte[w * h * 4];
-
-	{
-		GLubyte* rawG = new GLubyte[w * h];
-		
-		//	Read all the texels
-		is.read((char*)rawG, w * h);
-		if (!is)	cout << "Erroe: only " << is.gcount() << "bytes could be read!" << endl;
-
-		for (int i = 0; i < w * h; i++)
-		{
-			raw[4 * i + 0] = 0;			// R
-			raw[4 * i + 1] = 0;			// G
-			raw[4 * i + 2] = 0;			// B
-			raw[4 * i + 3] = rawG[i];			// A
-		}
-		delete[]	rawG;
-	}
-
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, raw);
-	isOK("glTexImage2D()", __FILE__, __LINE__);
 
-	// Deallocate memory
-	delete[]	raw;
+	// The texels are the alpha of the black.
+	streamRawTexture(filename, w, h, 1, GL_RGBA8, true);
+	isOK("streamRawTexture()", __FILE__, __LINE__);
 
 	return true;
 }
@@ -274,7 +274,8 @@ main(int argc, char* argv[])
 	// Depth test
 	glEnable(GL_DEPTH_TEST);
 
-	//	Texture
+	//	Texture read by the workers, with its mipmaps
+	createTextureStreamer(textureStreamer);
 	glGenTextures(4, texId);
 
 	// GL_TEXTURE0 for a color texture
@@ -337,9 +338,13 @@ main(int argc, char* argv[])
 	// Initialization	
 	{
 		// Create shaders, VAO and VBO for simple texturing and	double v1s1on
+		// The programs are loaded from the binaries cached by the previous launch if possible,
+		// otherwise compiled in parallel by the driver while the rest is set up and drawn.
+		shaderSubmitTime = glfwGetTime();
 		pgTexturing.create("sv03_texturing.glsl", "sf03_texturing.glsl");
 		pgDoubleVision.create("sv03_double_vision.glsl", "sf03_double_vision.glsl");
 		pgNormalMapping.create("sv03_texturing.glsl", "sf03_normal.glsl");
+		cout << "Status: Shaders submitted in " << (glfwGetTime() - shaderSubmitTime) * 1000.0 << " ms" << endl;
 
 		// Prepare	a single quad
 		ArrayXXi	face;
@@ -452,13 +457,21 @@ main(int argc, char* argv[])
 			elapsed = 0;	// Reset the elapsed time
 		}
 
+		// Upload the texture levels arrived, at most 1 ms per frame.
+		// All of them at once in the headless mode for the complete frames.
+		do updateTextureStreamer(textureStreamer, 0.001);
+		while (headless && !textureStreamerIdle(textureStreamer));
+
+		// Programs still compiling are skipped in the frame, except in the headless mode
+		pollPrograms(headless);
 		render(window); // Draw one frame
-		glfwSwapBuffers(window);	// Swap buffers
+		swapBuffers(window);		// Swap buffers, or read back the frame in the headless mode
 	}
 		
 	// Finalization
 	{
 		// Texture
+		deleteTextureStreamer(textureStreamer);
 		glDeleteTextures(5, texId);
 
 		// Delete VBO and shaders
@@ -495,6 +508,8 @@ setUniformMVP(GLuint program, Matrix4f& M, Matrix4f& V, Matrix4f& P)
 void
 render(GLFWwindow* window)
 {
+	PROFILE_GPU_ZONE("render");
+
 	// Antialiasing
 	if (aaEnabled)  glEnable(GL_MULTISAMPLE);
 	else	glDisable(GL_MULTISAMPLE);
@@ -510,7 +525,7 @@ render(GLFWwindow* window)
 	Vector3f	l = (ViewMatrix * light).head<3>(); // Vector4f to Vector3f
 
 	// Draw the quad
-	if (simpleTexturing && !normalMapping)
+	if (simpleTexturing && !normalMapping && pgTexturing.pg)
 	{
 		// Model matrix
 		Affine3f	T; T = Translation3f(0.0f, 0.0f, 0.0f) * Scaling(0.7f, 0.7f, 0.7f);
@@ -537,7 +552,7 @@ render(GLFWwindow* window)
 	}
 
 	// Draw the triangle
-	if (doubleVision)
+	if (doubleVision && pgDoubleVision.pg)
 	{
 		// Model matrix
 		Affine3f	T; T = Translation3f(0.0f, 0.0f, 0.1f);
@@ -567,7 +582,7 @@ render(GLFWwindow* window)
 		drawVBO(tri.vao, tri.numTris);
 	}
 
-	if (normalMapping)
+	if (normalMapping && pgNormalMapping.pg)
 	{
 		// Model matrix
 		Affine3f	T; T = Translation3f(0.0f, 0.0f, 0.0f) * Scaling(0.7f, 0.7f, 0.7f);
@@ -598,7 +613,7 @@ render(GLFWwindow* window)
 	}
 
 	// Draw the textured quad
-	if (alphaTexturing)
+	if (alphaTexturing && pgTexturing.pg)
 	{
 		// Model matrix
 		Affine3f	T; T = Translation3f(0.0f, 0.0f, 0.2f)
@@ -189,7 +189,7 @@ main(int argc, char* argv[])
 		// Draw one frame			
 		render(window);
 
-		glfwSwapBuffers(window);	// Swap buffers			
+		swapBuffers(window);		// Swap buffers, or read back the frame in the headless mode			
 		glfwPollEvents();	// Events			
 	}
 
@@ -0,0 +1,96 @@
+#include "assetLoader.h"
+
+#include <chrono>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <iostream>
+using namespace std;
+
+void
+limitWorkerThreads()
+{
+#ifdef _OPENMP
+	int	nThreads = omp_get_num_procs() - 1;
+	omp_set_num_threads(nThreads > 1 ? nThreads : 1);
+#endif
+}
+
+// Worker: no GL calls here
+static bool
+parseMeshAsset(MeshAsset* asset, uint32_t cacheFlags, PrepareMeshFunc prepare)
+{
+	limitWorkerThreads();
+
+	if (openMeshCache(asset->filename, asset->cache))
+	{
+		if (asset->cache.header->flags == cacheFlags) return true;
+		closeMeshCache(asset->cache);
+	}
+
+	asset->nEdges = readArenaMesh(asset->filename, asset->mesh);
+	if (asset->mesh.nFaces == 0)
+	{
+		cerr << "ERROR: Fail in loading " << asset->filename << endl;
+		freeArenaMesh(asset->mesh);
+		return false;
+	}
+
+	if (prepare) prepare(asset->mesh);
+
+	// Write the cache for the next launch
+	const ArenaMesh&	mesh = asset->mesh;
+	writeMeshCache(asset->filename, mesh.vertexMap(), mesh.normalMap(), mesh.faceMap(), asset->nEdges, cacheFlags);
+
+	return true;
+}
+
+void
+loadMeshAsync(const char* filename, MeshAsset& asset, uint32_t cacheFlags, PrepareMeshFunc prepare)
+{
+	asset.filename = filename;
+	asset.state = ASSET_LOADING;
+	asset.worker = std::async(std::launch::async, parseMeshAsset, &asset, cacheFlags, prepare);
+}
+
+bool
+pollMeshAsset(MeshAsset& asset)
+{
+	if (asset.state == ASSET_LOADING && asset.worker.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		asset.state = asset.worker.get() ? ASSET_PARSED : ASSET_FAILED;
+
+	return asset.state == ASSET_PARSED;
+}
+
+void
+getMeshAssetArrays(const MeshAsset& asset, int& numTris, const GLuint*& index, int& numVertices,
+	const GLfloat*& vertex, const GLfloat*& normal)
+{
+	if (asset.cache.header)
+	{
+		numTris = asset.cache.header->nFaces;
+		numVertices = asset.cache.header->nVertices;
+		index = asset.cache.index;
+		vertex = asset.cache.position;
+		normal = asset.cache.normal;
+	}
+	else
+	{
+		numTris = asset.mesh.nFaces;
+		numVertices = asset.mesh.nVertices;
+		index = (const GLuint*)asset.mesh.face;
+		vertex = asset.mesh.vertex;
+		normal = asset.mesh.normal;
+	}
+}
+
+void
+releaseMeshAsset(MeshAsset& asset)
+{
+	closeMeshCache(asset.cache);
+	freeArenaMesh(asset.mesh);
+
+	if (asset.state == ASSET_PARSED) asset.state = ASSET_READY;
+}
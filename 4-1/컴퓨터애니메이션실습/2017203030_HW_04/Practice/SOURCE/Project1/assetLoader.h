@@ -0,0 +1,63 @@
+#ifndef _ASSET_LOADER_H_
+#define _ASSET_LOADER_H_
+
+#include "meshArena.h"
+#include "meshCache.h"
+
+#include <GL/glew.h>
+
+#include <future>
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+// Background loading: the files are parsed on worker threads with futures,
+// and the main thread uploads the parsed data to GL when it is ready.
+// A mesh is parsed, welded, prepared and given its normals in a single ArenaMesh,
+// which is written to the cache and uploaded as is, then freed at once.
+
+enum AssetState
+{
+	ASSET_EMPTY,
+	ASSET_LOADING,	// Worker running
+	ASSET_PARSED,	// Host data ready for the upload
+	ASSET_READY,	// Uploaded and released
+	ASSET_FAILED
+};
+
+// Preparation on the worker before the upload and the cache, e.g. optimizeMesh()
+typedef void	(*PrepareMeshFunc)(ArenaMesh& mesh);
+
+struct MeshAsset
+{
+	const char*			filename;
+	AssetState			state;
+	std::future<bool>	worker;
+
+	// Either the mapped cache or the parsed mesh
+	MeshCache	cache;
+	ArenaMesh	mesh;
+	int			nEdges;
+
+	MeshAsset() { filename = NULL; state = ASSET_EMPTY; nEdges = 0; }
+};
+
+// The parallel loops of the parsing, welding, normals and simplification in a worker
+// use one core less than the machine, leaving it to the render thread. Call first in a worker.
+void	limitWorkerThreads();
+
+// Start loading on a worker: the cache with the same flags if up to date,
+// or readArenaMesh() and the preparation followed by writing the cache.
+void	loadMeshAsync(const char* filename, MeshAsset& asset, uint32_t cacheFlags = 0, PrepareMeshFunc prepare = NULL);
+
+// Non-blocking check of the worker. Returns true when the asset is parsed.
+bool	pollMeshAsset(MeshAsset& asset);
+
+// Arrays of the parsed asset for the upload
+void	getMeshAssetArrays(const MeshAsset& asset, int& numTris, const GLuint*& index, int& numVertices,
+	const GLfloat*& vertex, const GLfloat*& normal);
+
+// Release the host data after the upload
+void	releaseMeshAsset(MeshAsset& asset);
+
+#endif	// _ASSET_LOADER_H_
@@ -4,6 +4,12 @@
 
 #include "glShader.h"
 
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
 #include <iostream>
 using namespace std;
 
@@ -33,8 +39,8 @@ isOK(const char* message, const char* file, int line, bool exitOnError, bool rep
 	return true;
 }
 
-char*
-readShader(const char* filename)
+static char*
+readFile(const char* filename)
 {
 	if (filename == NULL)
 	{
@@ -65,6 +71,51 @@ readShader(const char* filename)
 	return content;
 }
 
+// Read a shader splicing the lines #include "file" with the file next to it, one level deep.
+// #line after a snippet keeps the line numbers of the error messages for the rest of the shader.
+char*
+readShader(const char* filename)
+{
+	char*	content = readFile(filename);
+	if (content == NULL || strstr(content, "#include") == NULL) return content;
+
+	string	directory = filename;
+	size_t	slash = directory.find_last_of("/\\");
+	directory.erase(slash == string::npos ? 0 : slash + 1);
+
+	string	source;
+	int		line = 1;
+	for (const char* p = content; *p; line++)
+	{
+		const char*	end = strchr(p, '\n');
+		string		text(p, end ? size_t(end - p) : strlen(p));
+		p = end ? end + 1 : p + text.size();
+
+		char	includeName[256];
+		if (sscanf(text.c_str(), " #include \"%255[^\"]\"", includeName) != 1)
+		{
+			source += text + "\n";
+			continue;
+		}
+
+		char*	snippet = readFile((directory + includeName).c_str());
+		if (snippet == NULL)
+		{
+			cerr << "ERROR: Fail in including " << includeName << " in " << filename << endl;
+			delete[] content;
+			return NULL;
+		}
+		source += string(snippet) + "\n#line " + to_string(line + 1) + "\n";
+		delete[] snippet;
+	}
+	delete[] content;
+
+	char*	spliced = new char[source.size() + 1];
+	memcpy(spliced, source.c_str(), source.size() + 1);
+
+	return spliced;
+}
+
 void
 printShaderInfoLog(GLuint obj, const char* shaderFilename)
 {
@@ -97,9 +148,9 @@ printProgramInfoLog(GLuint obj)
 }
 
 GLuint
-createShaderFromFile(GLenum shaderType, const char* filename)
+createShaderFromSource(GLenum shaderType, const char* shaderSource, const char* filename)
 {
-	//	Create the vertex shader
+	//	Create the shader
 	GLuint  shader = glCreateShader(shaderType);
 	if (isOK("glCreateShader()", __FILE__, __LINE__) == false)	return	0;
 
@@ -109,16 +160,8 @@ createShaderFromFile(GLenum shaderType, const char* filename)
 		return 0;
 	}
 
-	// Read the shader file into a string
-	const char* shaderSource = readShader(filename);
-	if (shaderSource == NULL) return 0;
-
 	// Set the shader source
 	glShaderSource(shader, 1, &shaderSource, NULL);
-
-	// Delete the string read from the shader file
-	delete[] shaderSource;
-
 	if (isOK("glShaderSource()", __FILE__, __LINE__) == false) return 0;
 
 	// Compile the shader
@@ -131,22 +174,209 @@ createShaderFromFile(GLenum shaderType, const char* filename)
 	return  shader;
 }
 
-// Create the shaders and the program
+GLuint
+createShaderFromFile(GLenum shaderType, const char* filename)
+{
+	// Read the shader file into a string
+	const char* shaderSource = readShader(filename);
+	if (shaderSource == NULL) return 0;
+
+	GLuint	shader = createShaderFromSource(shaderType, shaderSource, filename);
+
+	// Delete the string read from the shader file
+	delete[] shaderSource;
+
+	return	shader;
+}
+
+// Program binary cache
+//
+bool	programBinaryCache = true;
+
+struct ProgramBinaryHeader
+{
+	char		magic[4];	// "PGBN"
+	uint32_t	format;		// Binary format of the driver
+	uint64_t	key;		// Hash of the sources and the driver
+	uint32_t	length;		// # bytes of the binary following the header
+	uint32_t	padding;
+};
+
+void
+programCacheFileName(const char* vertexShaderFile, const char* fragmentShaderFile, char* cacheFilename, size_t size)
+{
+	// Next to the vertex shader: "sv02_Phong.glsl" and "sf02_Phong.glsl" -> "sv02_Phong+sf02_Phong.pgb"
+	string	v = vertexShaderFile;
+	string	f = fragmentShaderFile;
+
+	size_t	slash = f.find_last_of("/\\");
+	if (slash != string::npos) f.erase(0, slash + 1);
+	size_t	dot = f.find_last_of('.');
+	if (dot != string::npos) f.erase(dot);
+
+	slash = v.find_last_of("/\\");
+	dot = v.find_last_of('.');
+	if (dot != string::npos && (slash == string::npos || dot > slash)) v.erase(dot);
+
+	snprintf(cacheFilename, size, "%s+%s.pgb", v.c_str(), f.c_str());
+}
+
+// FNV-1a including the null terminator to separate the strings
+static uint64_t
+hashString(uint64_t h, const char* s)
+{
+	if (s == NULL) s = "";
+	do { h ^= (unsigned char)*s; h *= 1099511628211ull; } while (*s++);
+	return h;
+}
+
+// The binary is valid only for the same sources on the same driver.
+static uint64_t
+programCacheKey(const char* vertexSource, const char* fragmentSource)
+{
+	uint64_t	h = 14695981039346656037ull;
+	h = hashString(h, vertexSource);
+	h = hashString(h, fragmentSource);
+	h = hashString(h, (const char*)glGetString(GL_VENDOR));
+	h = hashString(h, (const char*)glGetString(GL_RENDERER));
+	h = hashString(h, (const char*)glGetString(GL_VERSION));
+	return h;
+}
+
+static bool
+programBinarySupported()
+{
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) return false;
+
+	GLint	numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	return numFormats > 0;
+}
+
+// Fails silently without the cache, and with a status when it is stale or rejected by the driver.
+static bool
+loadProgramBinary(const char* filename, uint64_t key, GLuint program)
+{
+	FILE*	fp = fopen(filename, "rb");
+	if (fp == NULL) return false;
+
+	ProgramBinaryHeader	header;
+	bool	ok = fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, "PGBN", 4) == 0
+		&& header.key == key && header.length > 0;
+
+	vector<char>	binary;
+	if (ok)
+	{
+		binary.resize(header.length);
+		ok = fread(binary.data(), header.length, 1, fp) == 1;
+	}
+	fclose(fp);
+
+	if (ok)
+	{
+		glProgramBinary(program, header.format, binary.data(), header.length);
+		isOK("glProgramBinary()", __FILE__, __LINE__, false, false);	// An unknown format is no error here
+
+		GLint	linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		ok = linked == GL_TRUE;
+	}
+
+	if (!ok) cout << "Status: Stale program cache " << filename << endl;
+	return ok;
+}
+
+static void
+saveProgramBinary(const char* filename, uint64_t key, GLuint program)
+{
+	GLint	linked = GL_FALSE;
+	GLint	length = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (linked != GL_TRUE || length <= 0) return;
+
+	vector<char>	binary(length);
+	GLenum	format = 0;
+	glGetProgramBinary(program, length, NULL, &format, binary.data());
+	if (isOK("glGetProgramBinary()", __FILE__, __LINE__, false) == false) return;
+
+	ProgramBinaryHeader	header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "PGBN", 4);
+	header.format = format;
+	header.key = key;
+	header.length = uint32_t(length);
+
+	FILE*	fp = fopen(filename, "wb");
+	bool	ok = fp != NULL;
+	if (ok)
+	{
+		ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(binary.data(), length, 1, fp) == 1;
+		fclose(fp);
+	}
+
+	if (!ok)
+	{
+		cerr << "ERROR: Fail in saveProgramBinary(" << filename << ")" << endl;
+		remove(filename);
+	}
+}
+
+// Create the shaders and the program, or load the program from the binary cache.
+// The shaders are 0 when the program comes from the cache.
 void
 createShaders(const char* vertexShaderFileName, const char* fragmentShaderFileName, GLuint& program, GLuint& vertexShader, GLuint& fragmentShader)
 {
-	// Create the vertex and fragment shaders
-	vertexShader = createShaderFromFile(GL_VERTEX_SHADER, vertexShaderFileName);
-	fragmentShader = createShaderFromFile(GL_FRAGMENT_SHADER, fragmentShaderFileName);
+	vertexShader = 0;
+	fragmentShader = 0;
+
+	// Read the sources once for the key of the cache and the compilation
+	char*	vertexSource = readShader(vertexShaderFileName);
+	char*	fragmentSource = readShader(fragmentShaderFileName);
+
+	bool		cached = programBinaryCache && vertexSource && fragmentSource && programBinarySupported();
+	uint64_t	key = 0;
+	char		cacheFileName[1024];
+	if (cached)
+	{
+		key = programCacheKey(vertexSource, fragmentSource);
+		programCacheFileName(vertexShaderFileName, fragmentShaderFileName, cacheFileName, sizeof(cacheFileName));
+	}
 
-	// Create the program with the vertex and fragment shaders
+	// Create the program
 	program = glCreateProgram();
+	if (cached && loadProgramBinary(cacheFileName, key, program))
+	{
+		delete[] vertexSource;
+		delete[] fragmentSource;
+		return;
+	}
+
+	// Start over from a clean program if the cache has been rejected
+	if (cached)
+	{
+		glDeleteProgram(program);
+		program = glCreateProgram();
+	}
+
+	// Create the vertex and fragment shaders
+	if (vertexSource)	vertexShader = createShaderFromSource(GL_VERTEX_SHADER, vertexSource, vertexShaderFileName);
+	if (fragmentSource)	fragmentShader = createShaderFromSource(GL_FRAGMENT_SHADER, fragmentSource, fragmentShaderFileName);
 
-	glAttachShader(program, vertexShader);
-	glAttachShader(program, fragmentShader);
+	delete[] vertexSource;
+	delete[] fragmentSource;
+
+	// Link the program with the vertex and fragment shaders
+	if (vertexShader)	glAttachShader(program, vertexShader);
+	if (fragmentShader)	glAttachShader(program, fragmentShader);
+
+	if (cached) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
 	glLinkProgram(program);
 	printProgramInfoLog(program);
+
+	// Cache the binary for the next launch
+	if (cached) saveProgramBinary(cacheFileName, key, program);
 }
 
 // Delete the shaders and the program
@@ -284,6 +514,114 @@ setUniformMatrix4fv(GLuint program, const char* name, const float* value)
 	return location;
 }
 
+// Uniform parameters through the handles: the errors are checked once per frame by the caller.
+void
+setUniform(const Uniform<int>& u, int i)
+{
+	if (u.location >= 0) glProgramUniform1i(u.program, u.location, i);
+}
+
+void
+setUniform(const Uniform<float>& u, float f)
+{
+	if (u.location >= 0) glProgramUniform1f(u.program, u.location, f);
+}
+
+void
+setUniform(const Uniform<Vector2f>& u, const Vector2f& v)
+{
+	if (u.location >= 0) glProgramUniform2fv(u.program, u.location, 1, v.data());
+}
+
+void
+setUniform(const Uniform<Vector3f>& u, const Vector3f& v)
+{
+	if (u.location >= 0) glProgramUniform3fv(u.program, u.location, 1, v.data());
+}
+
+void
+setUniform(const Uniform<Vector4f>& u, const Vector4f& v)
+{
+	if (u.location >= 0) glProgramUniform4fv(u.program, u.location, 1, v.data());
+}
+
+void
+setUniform(const Uniform<Matrix3f>& u, const Matrix3f& m)
+{
+	if (u.location >= 0) glProgramUniformMatrix3fv(u.program, u.location, 1, GL_FALSE, m.data());
+}
+
+void
+setUniform(const Uniform<Matrix4f>& u, const Matrix4f& m)
+{
+	if (u.location >= 0) glProgramUniformMatrix4fv(u.program, u.location, 1, GL_FALSE, m.data());
+}
+
+// Uniform buffers
+void
+createUniformBuffer(UniformBuffer& ub, GLuint binding, int blockSize)
+{
+	GLint	alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	glGenBuffers(1, &ub.id);
+	ub.binding = binding;
+	ub.blockSize = blockSize;
+	ub.stride = (blockSize + alignment - 1) / alignment * alignment;
+	ub.capacity = 0;
+
+	isOK("createUniformBuffer()", __FILE__, __LINE__);
+}
+
+void*
+uniformBlock(UniformBuffer& ub, int i)
+{
+	size_t	end = size_t(i + 1) * ub.stride;
+	if (ub.staging.size() < end) ub.staging.resize(end);
+
+	return &ub.staging[size_t(i) * ub.stride];
+}
+
+void
+uploadUniformBuffer(UniformBuffer& ub, int count)
+{
+	if (count <= 0) return;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, ub.id);
+
+	// Grow geometrically, and orphan the old storage to avoid waiting for the previous frame
+	if (count > ub.capacity)
+		ub.capacity = (count > 2 * ub.capacity) ? count : 2 * ub.capacity;
+	glBufferData(GL_UNIFORM_BUFFER, size_t(ub.capacity) * ub.stride, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size_t(count) * ub.stride, ub.staging.data());
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void
+bindUniformBlock(const UniformBuffer& ub, int i)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, ub.binding, ub.id, GLintptr(i) * ub.stride, ub.blockSize);
+}
+
+void
+deleteUniformBuffer(UniformBuffer& ub)
+{
+	if (ub.id) glDeleteBuffers(1, &ub.id);
+
+	ub = UniformBuffer();
+}
+
+bool
+setUniformBlockBinding(GLuint program, const char* blockName, GLuint binding)
+{
+	GLuint	index = glGetUniformBlockIndex(program, blockName);
+	if (index == GL_INVALID_INDEX) return false;
+
+	glUniformBlockBinding(program, index, binding);
+	return isOK("setUniformBlockBinding()", __FILE__, __LINE__, false);
+}
+
 void
 createVBO(GLuint& vao, GLuint& indexId, GLuint& vertexId, GLuint& normalId)
 {
@@ -322,9 +660,15 @@ createVBO(GLuint& vao, GLuint& idxId, GLuint& vtxId, GLuint& normalId, GLuint& c
 int
 uploadMesh2VBO(ArrayXXi& face, MatrixXf& vertex, MatrixXf& normal, GLuint vao, GLuint indexId, GLuint vertexId, GLuint normalId)
 {
-	int numTris = face.cols();
-	int numVertices = vertex.cols();
+	return uploadMesh2VBO(int(face.cols()), (const GLuint*)face.data(), int(vertex.cols()), vertex.data(), normal.data(),
+		vao, indexId, vertexId, normalId);
+}
 
+// Activate the VBO and then upload the raw arrays to GPU
+int
+uploadMesh2VBO(int numTris, const GLuint* index, int numVertices, const GLfloat* vertex, const GLfloat* normal,
+	GLuint vao, GLuint indexId, GLuint vertexId, GLuint normalId)
+{
 	// Activate the VBO and begin the specification of the vertex array
 	glBindVertexArray(vao);
 
@@ -332,15 +676,15 @@ uploadMesh2VBO(ArrayXXi& face, MatrixXf& vertex, MatrixXf& normal, GLuint vao, G
 	//
 	// Index : indices
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexId); //	Vertex array indices
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numTris*3*sizeof(GLuint), face.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numTris*3*sizeof(GLuint), index, GL_STATIC_DRAW);
 	
 	// Vertex positions
 	glBindBuffer(GL_ARRAY_BUFFER, vertexId);	//	Vertex position attributes
-	glBufferData(GL_ARRAY_BUFFER, numVertices * 3 * sizeof(GLfloat), vertex.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, numVertices * 3 * sizeof(GLfloat), vertex, GL_STATIC_DRAW);
 
 	// Normal vectors
 	glBindBuffer(GL_ARRAY_BUFFER, normalId);	//	Vertex normal attributes
-	glBufferData(GL_ARRAY_BUFFER, numVertices * 3 * sizeof(GLfloat), normal.data(),
+	glBufferData(GL_ARRAY_BUFFER, numVertices * 3 * sizeof(GLfloat), normal,
 	GL_STATIC_DRAW);
 
 	// Layout of the vertex array
@@ -420,6 +764,201 @@ uploadMesh2VBO(ArrayXXi & face, MatrixXf& vertex, MatrixXf& normal, MatrixXf& te
 	return numTris;
 }
 
+// IEEE 754 half float rounded to the nearest
+static GLushort
+floatToHalf(float f)
+{
+	uint32_t	x;
+	memcpy(&x, &f, sizeof(x));
+
+	uint32_t	sign = (x >> 16) & 0x8000;
+	int			exponent = int((x >> 23) & 0xff) - 127 + 15;
+	uint32_t	mantissa = x & 0x7fffff;
+
+	if (((x >> 23) & 0xff) == 0xff)	return GLushort(sign | 0x7c00 | (mantissa ? 0x200 : 0));	// Inf, NaN
+	if (exponent >= 31)					return GLushort(sign | 0x7c00);	// Overflow
+	if (exponent <= 0)		// Subnormal or zero
+	{
+		if (exponent < -10) return GLushort(sign);
+
+		mantissa |= 0x800000;
+		return GLushort(sign | ((mantissa >> (14 - exponent)) + ((mantissa >> (13 - exponent)) & 1)));
+	}
+
+	// The carry of the rounding goes into the exponent correctly.
+	return GLushort(sign | ((uint32_t(exponent) << 10) + (mantissa >> 13) + ((mantissa >> 12) & 1)));
+}
+
+// Octahedral encoding of the unit vector into [-1, 1]^2
+static void
+encodeOctahedral(const GLfloat* n, GLshort e[2])
+{
+	float	l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+	float	x = (l1 > 0) ? n[0] / l1 : 0;
+	float	y = (l1 > 0) ? n[1] / l1 : 0;
+
+	// Fold the lower hemisphere
+	if (n[2] < 0)
+	{
+		float	fx = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+		float	fy = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+		x = fx;	y = fy;
+	}
+
+	e[0] = GLshort(floorf(x * 32767.0f + 0.5f));
+	e[1] = GLshort(floorf(y * 32767.0f + 0.5f));
+}
+
+// Activate the VBO and then upload the compressed mesh data to GPU
+int
+uploadQuantizedMesh2VBO(int numTris, const GLuint* index, int numVertices, const GLfloat* vertex, const GLfloat* normal,
+	const GLfloat* texture, GLuint vao, GLuint indexId, GLuint vertexId, GLuint normalId, GLuint coordId,
+	Vector3f& positionOffset, Vector3f& positionScale)
+{
+	// Bounding box for the quantization of the positions
+	Map<const Matrix<float, 3, Dynamic> >	V(vertex, 3, numVertices);
+	positionOffset = numVertices ? Vector3f(V.rowwise().minCoeff()) : Vector3f::Zero();
+	positionScale = numVertices ? Vector3f(V.rowwise().maxCoeff() - positionOffset) : Vector3f::Zero();
+
+	Vector3f	s;
+	for (int k = 0; k < 3; k++)
+		s[k] = (positionScale[k] > 0) ? 65535.0f / positionScale[k] : 0;
+
+	std::vector<GLushort>	position(3 * size_t(numVertices));
+	std::vector<GLshort>	octNormal(2 * size_t(numVertices));
+	std::vector<GLushort>	coord(texture ? 2 * size_t(numVertices) : 0);
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < numVertices; i++)
+	{
+		for (int k = 0; k < 3; k++)
+			position[3 * i + k] = GLushort(floorf((vertex[3 * i + k] - positionOffset[k]) * s[k] + 0.5f));
+
+		encodeOctahedral(normal + 3 * i, &octNormal[2 * i]);
+
+		if (texture)
+		{
+			coord[2 * i + 0] = floatToHalf(texture[2 * i + 0]);
+			coord[2 * i + 1] = floatToHalf(texture[2 * i + 1]);
+		}
+	}
+
+	// Activate the VBO and begin the specification of the vertex array
+	glBindVertexArray(vao);
+
+	// Index : indices
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexId);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numTris * 3 * sizeof(GLuint), index, GL_STATIC_DRAW);
+
+	// Vertex positions: normalized to [0, 1], tightly packed in 6 bytes
+	glBindBuffer(GL_ARRAY_BUFFER, vertexId);
+	glBufferData(GL_ARRAY_BUFFER, position.size() * sizeof(GLushort), position.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 0, NULL);
+
+	// Normal vectors: normalized to [-1, 1]
+	glBindBuffer(GL_ARRAY_BUFFER, normalId);
+	glBufferData(GL_ARRAY_BUFFER, octNormal.size() * sizeof(GLshort), octNormal.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, 0, NULL);
+
+	// Texture coords
+	if (texture)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, coordId);
+		glBufferData(GL_ARRAY_BUFFER, coord.size() * sizeof(GLushort), coord.data(), GL_STATIC_DRAW);
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, 0, NULL);
+	}
+
+	// Deactivate the VBO because the specification has been completed
+	glBindVertexArray(0);
+
+	// Check the status
+	isOK("uploadQuantizedMesh2VBO()", __FILE__, __LINE__);
+
+	return numTris;
+}
+
+int
+uploadQuantizedMesh2VBO(ArrayXXi& face, MatrixXf& vertex, MatrixXf& normal, GLuint vao, GLuint indexId, GLuint vertexId, GLuint normalId,
+	Vector3f& positionOffset, Vector3f& positionScale)
+{
+	return uploadQuantizedMesh2VBO(int(face.cols()), (const GLuint*)face.data(), int(vertex.cols()), vertex.data(), normal.data(), NULL,
+		vao, indexId, vertexId, normalId, 0, positionOffset, positionScale);
+}
+
+// Activate the VBO and then upload the interleaved mesh data to GPU
+int
+uploadInterleavedMesh2VBO(int numTris, const GLuint* index, int numVertices, const GLfloat* vertex, const GLfloat* normal,
+	const GLfloat* texture, GLuint vao, GLuint indexId, GLuint vertexId)
+{
+	// Position, normal and texture coordinates in floats
+	int	stride = texture ? 8 : 6;
+
+	// Interleave in one parallel pass
+	std::vector<GLfloat>	interleaved(size_t(stride) * numVertices);
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < numVertices; i++)
+	{
+		GLfloat*	v = &interleaved[size_t(stride) * i];
+
+		v[0] = vertex[3 * i + 0];	v[1] = vertex[3 * i + 1];	v[2] = vertex[3 * i + 2];
+		v[3] = normal[3 * i + 0];	v[4] = normal[3 * i + 1];	v[5] = normal[3 * i + 2];
+		if (texture) { v[6] = texture[2 * i + 0];	v[7] = texture[2 * i + 1]; }
+	}
+
+	// Activate the VBO and begin the specification of the vertex array
+	glBindVertexArray(vao);
+
+	// Index : indices
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexId);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numTris * 3 * sizeof(GLuint), index, GL_STATIC_DRAW);
+
+	// Vertex attributes
+	glBindBuffer(GL_ARRAY_BUFFER, vertexId);
+	glBufferData(GL_ARRAY_BUFFER, interleaved.size() * sizeof(GLfloat), interleaved.data(), GL_STATIC_DRAW);
+
+	// Layout of the vertex array
+	GLsizei	bytes = stride * sizeof(GLfloat);
+	int		nAttributes = texture ? 3 : 2;
+	if (GLEW_ARB_vertex_attrib_binding)
+	{
+		// The formats are separate from the buffer bound to the binding point 0.
+		glBindVertexBuffer(0, vertexId, 0, bytes);
+		for (int k = 0; k < nAttributes; k++)
+		{
+			glEnableVertexAttribArray(k);
+			glVertexAttribFormat(k, k < 2 ? 3 : 2, GL_FLOAT, GL_FALSE, 3 * k * sizeof(GLfloat));
+			glVertexAttribBinding(k, 0);
+		}
+	}
+	else
+	{
+		for (int k = 0; k < nAttributes; k++)
+		{
+			glEnableVertexAttribArray(k);
+			glVertexAttribPointer(k, k < 2 ? 3 : 2, GL_FLOAT, GL_FALSE, bytes, (const GLvoid*)(3 * k * sizeof(GLfloat)));
+		}
+	}
+
+	// Deactivate the VBO because the specification has been completed
+	glBindVertexArray(0);
+
+	// Check the status
+	isOK("uploadInterleavedMesh2VBO()", __FILE__, __LINE__);
+
+	return numTris;
+}
+
+int
+uploadInterleavedMesh2VBO(ArrayXXi& face, MatrixXf& vertex, MatrixXf& normal, GLuint vao, GLuint indexId, GLuint vertexId)
+{
+	return uploadInterleavedMesh2VBO(int(face.cols()), (const GLuint*)face.data(), int(vertex.cols()), vertex.data(), normal.data(), NULL,
+		vao, indexId, vertexId);
+}
+
 void
 drawVBO(GLuint vao, int numTris)
 {
@@ -7,6 +7,8 @@
 #include <Eigen/Dense>
 using namespace Eigen;
 
+#include <vector>
+
 // OpenGL Extension Wrangler Library
 
 bool	isOK(const char* message = NULL, const char* file = NULL, int line = -1, bool exitOnError = true, bool report = true);
@@ -15,12 +17,19 @@ bool	isOK(const char* message = NULL, const char* file = NULL, int line = -1, bo
 void	createShaders(const char* vertexShaderFile, const char* fragmentShaderFile,
 	GLuint& program, GLuint& vertexShader, GLuint& fragmentShader);
 
-char*	readShader(const char* filename);
+char*	readShader(const char* filename);	// With #include "file" spliced in
+GLuint	createShaderFromSource(GLenum shaderType, const char* shaderSource, const char* filename);
 GLuint	createShaderFromFile(GLenum shaderType, const char* filename);
 void	printShaderInfoLog(GLuint obj, const char* shaderFilename);
 void	printProgramInfoLog(GLuint obj);
 void	deleteShaders(GLuint program, GLuint vertexShader, GLuint fragmentShader);
 
+// Program binaries cached next to the vertex shaders and keyed by the sources and the driver:
+// createShaders() loads the binary instead of compiling, and recompiles and rewrites it
+// when it is stale or rejected. On by default if the driver supports program binaries.
+extern bool	programBinaryCache;
+void	programCacheFileName(const char* vertexShaderFile, const char* fragmentShaderFile, char* cacheFilename, size_t size);
+
 // Get the location of a uniform parameter
 int getUniformLocation(GLuint program, const char* name);
 int getUniformLocation(GLuint program, const std::string& name);
@@ -36,13 +45,79 @@ int setUniform(GLuint program, const std::string& name, const Matrix4f& m);
 int setUniformMatrix3fv(GLuint program, const char* name, const float* value);
 int setUniformMatrix4fv(GLuint program, const char* name, const float* value);
 
+// Typed handle of a uniform parameter resolved once after linking,
+// so that setting it hashes no string and queries no error state.
+template<class T>
+struct Uniform
+{
+	GLuint	program;
+	GLint	location;	// -1 if the parameter is not active in the program
+
+	Uniform() { program = 0; location = -1; }
+	Uniform(GLuint program, const char* name) { this->program = program; location = getUniformLocation(program, name); }
+};
+
+void	setUniform(const Uniform<int>& u, int i);
+void	setUniform(const Uniform<float>& u, float f);
+void	setUniform(const Uniform<Vector2f>& u, const Vector2f& v);
+void	setUniform(const Uniform<Vector3f>& u, const Vector3f& v);
+void	setUniform(const Uniform<Vector4f>& u, const Vector4f& v);
+void	setUniform(const Uniform<Matrix3f>& u, const Matrix3f& m);
+void	setUniform(const Uniform<Matrix4f>& u, const Matrix4f& m);
+
+// Array of uniform blocks of one type in the std140 layout, each padded to
+// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT so that any of them can be bound by glBindBufferRange().
+// The blocks of a frame are filled on the CPU and uploaded by one glBufferSubData().
+struct UniformBuffer
+{
+	GLuint	id;
+	GLuint	binding;	// Binding point of the block
+	int		blockSize;	// Size of the block in the std140 layout
+	int		stride;		// blockSize rounded up to the offset alignment
+	int		capacity;	// # blocks allocated in the buffer
+
+	std::vector<unsigned char>	staging;	// Blocks of the frame
+
+	UniformBuffer() { id = 0; binding = 0; blockSize = 0; stride = 0; capacity = 0; }
+};
+
+void	createUniformBuffer(UniformBuffer& ub, GLuint binding, int blockSize);
+void*	uniformBlock(UniformBuffer& ub, int i);		// The i-th block in the staging memory
+void	uploadUniformBuffer(UniformBuffer& ub, int count);
+void	bindUniformBlock(const UniformBuffer& ub, int i);
+void	deleteUniformBuffer(UniformBuffer& ub);
+
+// Connect the named block of the program to the binding point, false if it is not active
+bool	setUniformBlockBinding(GLuint program, const char* blockName, GLuint binding);
+
 void	createVBO(GLuint& vao, GLuint& indexId, GLuint& vertexId, GLuint& normalId);
 void	createVBO(GLuint& vao, GLuint& indexId, GLuint& vertexId, GLuint& normalId, GLuint& coordId);
 
 int		uploadMesh2VBO(ArrayXXi& face, MatrixXf& vertex, MatrixXf& normal, GLuint vao, GLuint indexId, GLuint vertexId, GLuint normalId);
 
+// Upload from raw arrays, e.g. straight from a mapped mesh cache
+int		uploadMesh2VBO(int numTris, const GLuint* index, int numVertices, const GLfloat* vertex, const GLfloat* normal,
+	GLuint vao, GLuint indexId, GLuint vertexId, GLuint normalId);
+
 int		uploadMesh2VBO(ArrayXXi& face, MatrixXf& vertex, MatrixXf& normal, MatrixXf& texture, GLuint vao, GLuint indexId, GLuint vertexId, GLuint normalId, GLuint texId);
 
+// Compressed vertex format, 10 bytes per vertex instead of 24:
+// positions as 3 x 16-bit unorm against the bounding box without padding, normals as
+// 2 x 16-bit snorm octahedral and texture coordinates (optional, coordId) as 2 x half float.
+// The vertex shaders dequantize with PositionOffset, PositionScale and OctahedralNormal.
+int		uploadQuantizedMesh2VBO(int numTris, const GLuint* index, int numVertices, const GLfloat* vertex, const GLfloat* normal,
+	const GLfloat* texture, GLuint vao, GLuint indexId, GLuint vertexId, GLuint normalId, GLuint coordId,
+	Vector3f& positionOffset, Vector3f& positionScale);
+int		uploadQuantizedMesh2VBO(ArrayXXi& face, MatrixXf& vertex, MatrixXf& normal, GLuint vao, GLuint indexId, GLuint vertexId, GLuint normalId,
+	Vector3f& positionOffset, Vector3f& positionScale);
+
+// Interleaved layout: the position, normal and texture coordinates (optional) of a vertex
+// packed in the single buffer vertexId with a stride, so a vertex fetch touches one cache line.
+// The VAO uses the binding point 0 with glVertexAttribFormat() if ARB_vertex_attrib_binding is available.
+int		uploadInterleavedMesh2VBO(int numTris, const GLuint* index, int numVertices, const GLfloat* vertex, const GLfloat* normal,
+	const GLfloat* texture, GLuint vao, GLuint indexId, GLuint vertexId);
+int		uploadInterleavedMesh2VBO(ArrayXXi& face, MatrixXf& vertex, MatrixXf& normal, GLuint vao, GLuint indexId, GLuint vertexId);
+
 void drawVBO(GLuint vao, int numTriangles);
 void deleteVBO(GLuint& vao, GLuint& indexId, GLuint& vertexId, GLuint& normalId);
 void deleteVBO(GLuint& vao, GLuint& indexId, GLuint& vertexId, GLuint& normalId, GLuint& coordId);
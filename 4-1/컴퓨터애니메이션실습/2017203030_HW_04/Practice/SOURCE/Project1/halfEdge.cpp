@@ -0,0 +1,81 @@
+#include "halfEdge.h"
+
+void
+buildHalfEdgeMesh(const ArrayXXi& face, int nVertices, HalfEdgeMesh& mesh)
+{
+	int nFaces = int(face.cols());
+	int nHalfEdges = 3 * nFaces;
+
+	mesh.face = face;
+	mesh.twin.setConstant(nHalfEdges, -1);
+
+	const int*	V = mesh.face.data();
+
+	// Counting sort of the half-edges by their smaller vertex
+	VectorXi	offset = VectorXi::Zero(nVertices + 1);
+	for (int h = 0; h < nHalfEdges; h++)
+	{
+		int a = V[h], b = V[HalfEdgeMesh::next(h)];
+		offset((a < b ? a : b) + 1)++;
+	}
+
+	for (int i = 0; i < nVertices; i++)
+		offset(i + 1) += offset(i);
+
+	VectorXi	bucket(nHalfEdges);
+	VectorXi	fill = offset.head(nVertices);
+	for (int h = 0; h < nHalfEdges; h++)
+	{
+		int a = V[h], b = V[HalfEdgeMesh::next(h)];
+		bucket(fill(a < b ? a : b)++) = h;
+	}
+
+	// Pair within each bucket: the buckets are disjoint, so no synchronization is needed.
+	int nBoundaryEdges = 0, nNonManifoldEdges = 0, nEdges = 0;
+
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+ : nBoundaryEdges, nNonManifoldEdges, nEdges)
+	for (int v = 0; v < nVertices; v++)
+	{
+		int*	begin = bucket.data() + offset(v);
+		int		n = offset(v + 1) - offset(v);
+
+		// Insertion sort by the larger vertex: the buckets are as small as the valence.
+		for (int i = 1; i < n; i++)
+		{
+			int h = begin[i];
+			int key = V[h] + V[HalfEdgeMesh::next(h)] - v;
+			int j = i - 1;
+			for (; j >= 0 && V[begin[j]] + V[HalfEdgeMesh::next(begin[j])] - v > key; j--)
+				begin[j + 1] = begin[j];
+			begin[j + 1] = h;
+		}
+
+		// Runs of the same edge
+		for (int i = 0; i < n; )
+		{
+			int key = V[begin[i]] + V[HalfEdgeMesh::next(begin[i])] - v;
+			int j = i + 1;
+			while (j < n && V[begin[j]] + V[HalfEdgeMesh::next(begin[j])] - v == key) j++;
+
+			nEdges++;
+			if (j - i == 1) nBoundaryEdges++;
+			else if (j - i == 2 && V[begin[i]] != V[begin[i + 1]])	// Opposite orientation
+			{
+				mesh.twin(begin[i]) = begin[i + 1];
+				mesh.twin(begin[i + 1]) = begin[i];
+			}
+			else nNonManifoldEdges++;
+
+			i = j;
+		}
+	}
+
+	mesh.nEdges = nEdges;
+	mesh.nBoundaryEdges = nBoundaryEdges;
+	mesh.nNonManifoldEdges = nNonManifoldEdges;
+
+	// Outgoing half-edges, preferring the boundary ones for isBoundaryVertex()
+	mesh.vertexHalfEdge.setConstant(nVertices, -1);
+	for (int h = 0; h < nHalfEdges; h++)
+		if (mesh.vertexHalfEdge(V[h]) < 0 || mesh.twin(h) < 0) mesh.vertexHalfEdge(V[h]) = h;
+}
@@ -0,0 +1,35 @@
+#ifndef _HALF_EDGE_H_
+#define _HALF_EDGE_H_
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+// Compact half-edge structure of a triangle mesh in the corner-table layout.
+// The half-edge h = 3 * f + k of the face f goes from face(k, f) to face((k + 1) % 3, f),
+// so next, prev and the face of a half-edge are implicit and only the twins are stored.
+struct HalfEdgeMesh
+{
+	ArrayXXi	face;				// 3 x nFaces, face.data()[h] is the origin of h
+	VectorXi	twin;				// Opposite half-edge, -1 on the boundary
+	VectorXi	vertexHalfEdge;		// One outgoing half-edge per vertex, a boundary one if any
+
+	int		nEdges;					// # undirected edges
+	int		nBoundaryEdges;
+	int		nNonManifoldEdges;		// Left unpaired as boundary edges
+
+	static int	next(int h)	{ return h - h % 3 + (h + 1) % 3; }
+	static int	prev(int h)	{ return h - h % 3 + (h + 2) % 3; }
+	static int	faceOf(int h)	{ return h / 3; }
+
+	int		from(int h) const	{ return face.data()[h]; }
+	int		to(int h) const		{ return face.data()[next(h)]; }
+
+	bool	isBoundaryEdge(int h) const		{ return twin(h) < 0; }
+	bool	isBoundaryVertex(int v) const	{ return vertexHalfEdge(v) >= 0 && twin(vertexHalfEdge(v)) < 0; }
+};
+
+// O(n) construction: half-edges are bucketed by their smaller vertex with a counting
+// sort and paired within each bucket in parallel, without any hashing.
+void	buildHalfEdgeMesh(const ArrayXXi& face, int nVertices, HalfEdgeMesh& mesh);
+
+#endif	// _HALF_EDGE_H_
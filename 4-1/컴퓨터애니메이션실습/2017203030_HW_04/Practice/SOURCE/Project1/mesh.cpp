@@ -1,3 +1,8 @@
+#include "mesh.h"
+#include "offReader.h"
+#include "vertexNormal.h"
+#include "weld.h"
+
 #include <fstream>
 
 #include <Eigen/Dense>
@@ -10,66 +15,55 @@ using namespace std;
 int
 readMesh(const char * filename, MatrixXf& vertex, MatrixXf& normal, ArrayXXi& face)
 {
-	ifstream	is(filename);
-	if (is.fail()) return 0;
+	int nEdges = 0;
+	if (!readOFF(filename, vertex, face, nEdges)) return 0;
 
-	char	magicNumber[256];
-	is >> magicNumber;
+	// Merge the coincident vertices and remove the degenerate and duplicate faces
+	weldMesh(vertex, face);
 
-	// # vertices, # faces, # edges
-	int nVertices = 0, nFaces = 0, nEdges = 0;
-	is >> nVertices >> nFaces >> nEdges;
-	cout << "# vertices = " << nVertices << endl;
-	cout << "# faces = " << nFaces << endl;
+	// Normals from the face normals
+	MatrixXf	faceNormal;
+	VertexFaceAdjacency	adj;
 
-	// Vertices
-	vertex.resize(3, nVertices);
-	for (int i = 0; i < nVertices; i++)
-		is >> vertex(0, i) >> vertex(1, i) >> vertex(2, i);
-	
-	// Normals
-	normal.resize(3, nVertices);
-	normal.setZero();
+	computeFaceNormals(vertex, face, faceNormal);
+	buildVertexFaceAdjacency(face, int(vertex.cols()), adj);
+	computeVertexNormals(vertex, face, adj, faceNormal, normal);
 
-	// Faces
-	face.resize(3, nFaces); // Only support triangles
+	return nEdges;
+}
 
-	int n;
-	for (int i = 0; i < nFaces; i++)
-	{
-		is >> n >> face(0, i) >> face(1, i) >> face(2, i);
-		if (n != 3) cout << "# verticesof the " << i << " - th faces - " << n << endl;
+// Vertex, vertex normal, face normal, vertex indices for faces
+int
+readMesh(const char* filename, MatrixXf& vertex, ArrayXXi& face, MatrixXf& faceNormal, MatrixXf& normal)
+{
+	int nEdges = 0;
+	if (!readOFF(filename, vertex, face, nEdges)) return 0;
 
-		// Normal vector of the face	
-		Vector3f	vl = vertex.col(face(1, i)) - vertex.col(face(0, i));
-		Vector3f	v2 = vertex.col(face(2, i)) - vertex.col(face(0, i));
-		Vector3f	v = vl.cross(v2).normalized();
+	// Merge the coincident vertices and remove the degenerate and duplicate faces
+	weldMesh(vertex, face);
 
-		// Add it to the normal vector of each vertex	
-		normal.col(face(0, i)) += v;
-		normal.col(face(1, i)) += v;
-		normal.col(face(2, i)) += v;
-	}
+	// Face normals and vertex normals from them
+	VertexFaceAdjacency	adj;
 
-	// Normalization of the normal vectors	
-	for (int i = 0; i < nVertices; i++)
-		normal.col(i).normalize();
+	computeFaceNormals(vertex, face, faceNormal);
+	buildVertexFaceAdjacency(face, int(vertex.cols()), adj);
+	computeVertexNormals(vertex, face, adj, faceNormal, normal);
 
 	return nEdges;
 }
 
-// Vertex, vertex normal, face normal, vertex indices for faces
-int
-readMesh(const char* filename, MatrixXf& vertex, ArrayXXi& face, MatrixXf& faceNormal, MatrixXf& normal)
+// Reference parser with ifstream: locale-aware and slow, kept for benchmarking readOFF()
+bool
+readOFFStream(const char* filename, MatrixXf& vertex, ArrayXXi& face, int& nEdges)
 {
 	ifstream	is(filename);
-	if (is.fail()) return 0;
+	if (is.fail()) return false;
 
 	char	magicNumber[256];
 	is >> magicNumber;
 
 	// # vertices, # faces, # edges
-	int nVertices = 0, nFaces = 0, nEdges = 0;
+	int nVertices = 0, nFaces = 0;
 	is >> nVertices >> nFaces >> nEdges;
 	cout << "# vertices = " << nVertices << endl;
 	cout << "# faces = " << nFaces << endl;
@@ -79,37 +73,15 @@ readMesh(const char* filename, MatrixXf& vertex, ArrayXXi& face, MatrixXf& faceN
 	for (int i = 0; i < nVertices; i++)
 		is >> vertex(0, i) >> vertex(1, i) >> vertex(2, i);
 
-	// Normals
-	normal.resize(3, nVertices);
-	normal.setZero();
-
 	// Faces
-	face.resize(3, nFaces);			// Only support triangles
-	faceNormal.resize(3, nFaces);
+	face.resize(3, nFaces); // Only support triangles
 
 	int n;
 	for (int i = 0; i < nFaces; i++)
 	{
 		is >> n >> face(0, i) >> face(1, i) >> face(2, i);
-		if (n != 3) cout << "# vertices of the " << i << " - th faces = " << n << endl;
-
-		// Normal vector of the face
-		Vector3f	v1 = vertex.col(face(1, i)) - vertex.col(face(0, i));
-		Vector3f	v2 = vertex.col(face(2, i)) - vertex.col(face(0, i));
-		Vector3f	v = v1.cross(v2).normalized();
-
-		// Set the face normal vector
-		faceNormal.col(i) = v;
-
-		// Add it to the normal vector of each vertex
-		normal.col(face(0, i)) += v;
-		normal.col(face(1, i)) += v;
-		normal.col(face(2, i)) += v;
+		if (n != 3) cout << "# verticesof the " << i << " - th faces - " << n << endl;
 	}
 
-	// Normalization od the normal vector
-	for (int i = 0; i < nVertices; i++)
-		normal.col(i).normalize();
-
-	return nEdges;
+	return !is.fail();
 }
@@ -7,4 +7,7 @@ using namespace Eigen;
 int readMesh(const char* fname, MatrixXf& vertex, MatrixXf& normal, ArrayXXi& face);
 int readMesh(const char* fname, MatrixXf& vertex, ArrayXXi& face, MatrixXf& faceNormal, MatrixXf& normal);
 
+// Reference ifstream parser for benchmarking readOFF(): no welding and no normals
+bool readOFFStream(const char* fname, MatrixXf& vertex, ArrayXXi& face, int& nEdges);
+
 #endif	// _MESH_H_
\ No newline at end of file
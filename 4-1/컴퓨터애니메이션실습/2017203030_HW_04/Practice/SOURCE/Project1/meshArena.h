@@ -0,0 +1,53 @@
+#ifndef _MESH_ARENA_H_
+#define _MESH_ARENA_H_
+
+#include <stddef.h>
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+// Mesh in one 64-byte aligned allocation: one array per attribute, each starting
+// on a cache line, so the parser, the normal kernels and the VBO upload stream
+// through contiguous memory and the whole mesh is freed at once.
+//
+// The arrays are packed xyz per vertex, i.e. the layout of glm::vec3 and Vector3f,
+// and are also viewed as 3 x N Eigen maps for the Eigen kernels without a copy.
+struct ArenaMesh
+{
+	void*	arena;			// The allocation
+	size_t	arenaSize;		// # bytes
+
+	int		nVertices;
+	int		nFaces;
+
+	float*	vertex;			// 3 x nVertices
+	float*	normal;			// 3 x nVertices
+	float*	faceNormal;		// 3 x nFaces
+	float*	texture;		// 2 x nVertices, NULL if not allocated
+	int*	face;			// 3 x nFaces
+
+	ArenaMesh() { arena = NULL; arenaSize = 0; nVertices = 0; nFaces = 0; vertex = NULL; normal = NULL; faceNormal = NULL; texture = NULL; face = NULL; }
+
+	// Eigen views
+	Map<Matrix3Xf, Aligned64>			vertexMap() const { return Map<Matrix3Xf, Aligned64>(vertex, 3, nVertices); }
+	Map<Matrix3Xf, Aligned64>			normalMap() const { return Map<Matrix3Xf, Aligned64>(normal, 3, nVertices); }
+	Map<Matrix3Xf, Aligned64>			faceNormalMap() const { return Map<Matrix3Xf, Aligned64>(faceNormal, 3, nFaces); }
+	Map<Array<int, 3, Dynamic>, Aligned64>	faceMap() const { return Map<Array<int, 3, Dynamic>, Aligned64>(face, 3, nFaces); }
+
+	// AoS views as an array of 3-float vectors, e.g. glm::vec3 or Vector3f
+	template <class Vec3> Vec3*	vertexAs() const { static_assert(sizeof(Vec3) == 3 * sizeof(float), "Not a packed 3-float vector"); return (Vec3*)vertex; }
+	template <class Vec3> Vec3*	normalAs() const { static_assert(sizeof(Vec3) == 3 * sizeof(float), "Not a packed 3-float vector"); return (Vec3*)normal; }
+	template <class Vec3> Vec3*	faceNormalAs() const { static_assert(sizeof(Vec3) == 3 * sizeof(float), "Not a packed 3-float vector"); return (Vec3*)faceNormal; }
+};
+
+// Carve the arrays out of a single aligned allocation. Returns false when out of memory.
+bool	allocArenaMesh(int nVertices, int nFaces, ArenaMesh& mesh, bool withTexture = false);
+
+// One free for the whole mesh
+void	freeArenaMesh(ArenaMesh& mesh);
+
+// Parse the OFF file straight into the arena, weld it in place and compute the face and
+// vertex normals, i.e. readMesh() without a copy. Returns # edges in the header, or 0 on failure.
+int		readArenaMesh(const char* filename, ArenaMesh& mesh);
+
+#endif	// _MESH_ARENA_H_
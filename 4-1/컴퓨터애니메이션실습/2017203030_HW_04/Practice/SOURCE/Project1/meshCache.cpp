@@ -0,0 +1,165 @@
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS	// fopen instead of fopen_s
+#endif
+
+#include "meshCache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <iostream>
+using namespace std;
+
+static const uint32_t	offbVersion = 3;	// 2: optimized order, 3: welded vertices
+
+static_assert(sizeof(OffbHeader) == 128, "OffbHeader must be 128 bytes");
+
+// Size and modification time of a file
+static bool
+fileStatus(const char* filename, uint64_t& size, int64_t& mtime)
+{
+#ifdef _WIN32
+	struct _stat64	st;
+	if (_stat64(filename, &st) != 0) return false;
+#else
+	struct stat		st;
+	if (stat(filename, &st) != 0) return false;
+#endif
+
+	size = uint64_t(st.st_size);
+	mtime = int64_t(st.st_mtime);
+	return true;
+}
+
+static inline uint64_t
+align64(uint64_t offset)
+{
+	return (offset + 63) & ~uint64_t(63);
+}
+
+void
+meshCacheFileName(const char* offFilename, char* cacheFilename, size_t size)
+{
+	snprintf(cacheFilename, size, "%sb", offFilename);
+}
+
+bool
+writeMeshCache(const char* offFilename, const Ref<const MatrixXf>& vertex, const Ref<const MatrixXf>& normal, const Ref<const ArrayXXi>& face, int nEdges,
+	uint32_t flags)
+{
+	OffbHeader	header;
+	memset(&header, 0, sizeof(header));
+
+	if (!fileStatus(offFilename, header.sourceSize, header.sourceMtime)) return false;
+
+	header.version = offbVersion;
+	header.nVertices = int32_t(vertex.cols());
+	header.nFaces = int32_t(face.cols());
+	header.nEdges = nEdges;
+	header.flags = flags;
+
+	if (header.nVertices > 0)
+	{
+		Vector3f	bbMin = vertex.rowwise().minCoeff();
+		Vector3f	bbMax = vertex.rowwise().maxCoeff();
+		for (int k = 0; k < 3; k++) { header.bbMin[k] = bbMin(k); header.bbMax[k] = bbMax(k); }
+	}
+
+	uint64_t	positionBytes = uint64_t(header.nVertices) * 3 * sizeof(float);
+	uint64_t	indexBytes = uint64_t(header.nFaces) * 3 * sizeof(uint32_t);
+
+	header.positionOffset = align64(sizeof(OffbHeader));
+	header.normalOffset = align64(header.positionOffset + positionBytes);
+	header.indexOffset = align64(header.normalOffset + positionBytes);
+
+	char	filename[1024];
+	meshCacheFileName(offFilename, filename, sizeof(filename));
+
+	FILE*	fp = fopen(filename, "wb");
+	if (fp == NULL)
+	{
+		cerr << "ERROR: Fail in writeMeshCache(" << filename << ")" << endl;
+		return false;
+	}
+
+	// The magic number is written last so that a partial file is never accepted.
+	static const char	zeros[64] = { 0 };
+	bool	ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+	ok = ok && fwrite(zeros, 1, size_t(header.positionOffset - sizeof(header)), fp) == header.positionOffset - sizeof(header);
+	ok = ok && fwrite(vertex.data(), 1, size_t(positionBytes), fp) == positionBytes;
+	ok = ok && fwrite(zeros, 1, size_t(header.normalOffset - header.positionOffset - positionBytes), fp)
+		== header.normalOffset - header.positionOffset - positionBytes;
+	ok = ok && fwrite(normal.data(), 1, size_t(positionBytes), fp) == positionBytes;
+	ok = ok && fwrite(zeros, 1, size_t(header.indexOffset - header.normalOffset - positionBytes), fp)
+		== header.indexOffset - header.normalOffset - positionBytes;
+	ok = ok && fwrite(face.data(), 1, size_t(indexBytes), fp) == indexBytes;
+
+	memcpy(header.magic, "OFFB", 4);
+	ok = ok && fseek(fp, 0, SEEK_SET) == 0;
+	ok = ok && fwrite(&header, sizeof(header), 1, fp) == 1;
+	ok = (fclose(fp) == 0) && ok;
+
+	if (!ok)
+	{
+		cerr << "ERROR: Fail in writeMeshCache(" << filename << ")" << endl;
+		remove(filename);
+	}
+
+	return ok;
+}
+
+bool
+openMeshCache(const char* offFilename, MeshCache& cache)
+{
+	uint64_t	sourceSize;
+	int64_t		sourceMtime;
+	if (!fileStatus(offFilename, sourceSize, sourceMtime)) return false;
+
+	char	filename[1024];
+	meshCacheFileName(offFilename, filename, sizeof(filename));
+
+	if (!mapFile(filename, cache.mf)) return false;
+
+	const OffbHeader*	header = (const OffbHeader*)cache.mf.data;
+
+	bool	valid = cache.mf.size >= sizeof(OffbHeader)
+		&& memcmp(header->magic, "OFFB", 4) == 0
+		&& header->version == offbVersion
+		&& header->nVertices >= 0 && header->nFaces >= 0
+		&& header->normalOffset + uint64_t(header->nVertices) * 3 * sizeof(float) <= cache.mf.size
+		&& header->indexOffset + uint64_t(header->nFaces) * 3 * sizeof(uint32_t) <= cache.mf.size;
+
+	// Stale-cache check against the OFF file
+	if (valid && (header->sourceSize != sourceSize || header->sourceMtime != sourceMtime))
+	{
+		cout << "Status: Stale mesh cache " << filename << endl;
+		valid = false;
+	}
+
+	if (!valid)
+	{
+		unmapFile(cache.mf);
+		return false;
+	}
+
+	cache.header = header;
+	cache.position = (const float*)(cache.mf.data + header->positionOffset);
+	cache.normal = (const float*)(cache.mf.data + header->normalOffset);
+	cache.index = (const uint32_t*)(cache.mf.data + header->indexOffset);
+
+	return true;
+}
+
+void
+closeMeshCache(MeshCache& cache)
+{
+	unmapFile(cache.mf);
+
+	cache.header = NULL;
+	cache.position = NULL;
+	cache.normal = NULL;
+	cache.index = NULL;
+}
@@ -0,0 +1,63 @@
+#ifndef _MESH_CACHE_H_
+#define _MESH_CACHE_H_
+
+#include "offReader.h"
+
+#include <stdint.h>
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+// Binary mesh cache (.offb) written next to the OFF file.
+// Every array starts on a 64-byte boundary in the GPU-ready layout:
+// positions and normals as 3 x float, triangle indices as 3 x uint32.
+struct OffbHeader
+{
+	char		magic[4];		// "OFFB"
+	uint32_t	version;
+
+	uint64_t	sourceSize;		// Size of the OFF file for the stale-cache check
+	int64_t		sourceMtime;	// Modification time of the OFF file
+
+	int32_t		nVertices;
+	int32_t		nFaces;
+	int32_t		nEdges;
+	uint32_t	flags;			// OFFB_OPTIMIZED, ...
+
+	float		bbMin[3];		// Bounding box
+	float		bbMax[3];
+
+	uint64_t	positionOffset;	// Byte offsets from the beginning of the file
+	uint64_t	normalOffset;
+	uint64_t	indexOffset;
+
+	uint8_t		padding[40];	// Header is 128 bytes
+};
+
+// Flags of the cache
+#define OFFB_OPTIMIZED	0x1		// Reordered by optimizeMesh()
+
+// Mapped cache: the arrays point into the file mapping.
+struct MeshCache
+{
+	MappedFile			mf;
+	const OffbHeader*	header;
+
+	const float*		position;
+	const float*		normal;
+	const uint32_t*		index;
+
+	MeshCache() { header = NULL; position = NULL; normal = NULL; index = NULL; }
+};
+
+// Name of the cache for the OFF file, i.e. "mesh.off" -> "mesh.offb"
+void	meshCacheFileName(const char* offFilename, char* cacheFilename, size_t size);
+
+bool	writeMeshCache(const char* offFilename, const Ref<const MatrixXf>& vertex, const Ref<const MatrixXf>& normal, const Ref<const ArrayXXi>& face, int nEdges,
+	uint32_t flags = 0);
+
+// Fails when the cache is missing, malformed or older than the OFF file.
+bool	openMeshCache(const char* offFilename, MeshCache& cache);
+void	closeMeshCache(MeshCache& cache);
+
+#endif	// _MESH_CACHE_H_
@@ -0,0 +1,221 @@
+#include "meshOptimize.h"
+#include "vertexNormal.h"
+
+#include <algorithm>
+
+#include <iostream>
+using namespace std;
+
+void
+vertexCacheStatistics(const Ref<const ArrayXXi>& face, int nVertices, int cacheSize, float& acmr, float& atvr)
+{
+	int nFaces = int(face.cols());
+
+	// Time stamp of each vertex when it entered the FIFO cache
+	VectorXi	stamp = VectorXi::Constant(nVertices, -cacheSize - 1);
+	int			misses = 0;
+
+	for (int i = 0; i < 3 * nFaces; i++)
+	{
+		int v = face.data()[i];
+		if (misses - stamp(v) > cacheSize) stamp(v) = misses++;
+	}
+
+	acmr = nFaces ? float(misses) / nFaces : 0;
+	atvr = nVertices ? float(misses) / nVertices : 0;
+}
+
+// Dead-end recovery: the latest live vertex in the dead-end stack, or the next live one in order
+static int
+skipDeadEnd(const VectorXi& live, std::vector<int>& deadEnd, int& cursor, int nVertices)
+{
+	while (!deadEnd.empty())
+	{
+		int d = deadEnd.back();
+		deadEnd.pop_back();
+		if (live(d) > 0) return d;
+	}
+
+	for (; cursor < nVertices; cursor++)
+		if (live(cursor) > 0) return cursor;
+
+	return -1;
+}
+
+void
+tipsify(const Ref<const ArrayXXi>& face, int nVertices, int cacheSize, ArrayXXi& out, std::vector<int>& clusters)
+{
+	int nFaces = int(face.cols());
+
+	VertexFaceAdjacency	adj;
+	buildVertexFaceAdjacency(face, nVertices, adj);
+
+	VectorXi	live(nVertices);	// # live triangles of each vertex
+	for (int v = 0; v < nVertices; v++)
+		live(v) = adj.offset(v + 1) - adj.offset(v);
+
+	VectorXi	cacheTime = VectorXi::Zero(nVertices);
+	std::vector<bool>	emitted(nFaces, false);
+	std::vector<int>	deadEnd;
+	std::vector<int>	candidates;
+
+	out.resize(3, nFaces);
+	clusters.clear();
+
+	int nOut = 0;
+	int time = cacheSize + 1;
+	int cursor = 0;
+	int fanning = skipDeadEnd(live, deadEnd, cursor, nVertices);
+	if (fanning >= 0) clusters.push_back(0);
+
+	while (fanning >= 0)
+	{
+		// Emit all the live triangles around the fanning vertex
+		candidates.clear();
+		for (int j = adj.offset(fanning); j < adj.offset(fanning + 1); j++)
+		{
+			int f = adj.corner(j) / 3;
+			if (emitted[f]) continue;
+
+			for (int k = 0; k < 3; k++)
+			{
+				int v = face(k, f);
+				out(k, nOut) = v;
+
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live(v)--;
+
+				if (time - cacheTime(v) > cacheSize) cacheTime(v) = time++;
+			}
+			emitted[f] = true;
+			nOut++;
+		}
+
+		// Next fanning vertex: the candidate that stays in the cache the longest
+		int next = -1, best = -1;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			int v = candidates[i];
+			if (live(v) <= 0) continue;
+
+			int priority = 0;
+			if (time - cacheTime(v) + 2 * live(v) <= cacheSize) priority = time - cacheTime(v);
+			if (priority > best) { best = priority; next = v; }
+		}
+
+		// Hard boundary of a cluster
+		if (next < 0)
+		{
+			next = skipDeadEnd(live, deadEnd, cursor, nVertices);
+			if (next >= 0 && nOut < nFaces) clusters.push_back(nOut);
+		}
+
+		fanning = next;
+	}
+}
+
+void
+sortClustersForOverdraw(const Ref<const MatrixXf>& vertex, ArrayXXi& face, const std::vector<int>& clusters)
+{
+	int nFaces = int(face.cols());
+	int nClusters = int(clusters.size());
+	if (nClusters < 2) return;
+
+	Vector3f	center = vertex.rowwise().mean();
+
+	// Clusters facing outward are likely to occlude the others.
+	std::vector<float>	key(nClusters);
+	std::vector<int>	order(nClusters);
+
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int c = 0; c < nClusters; c++)
+	{
+		int last = (c + 1 < nClusters) ? clusters[c + 1] : nFaces;
+
+		Vector3f	centroid = Vector3f::Zero();
+		Vector3f	normal = Vector3f::Zero();
+		for (int f = clusters[c]; f < last; f++)
+		{
+			Vector3f	p0 = vertex.col(face(0, f));
+			Vector3f	p1 = vertex.col(face(1, f));
+			Vector3f	p2 = vertex.col(face(2, f));
+
+			centroid += p0 + p1 + p2;
+			normal += (p1 - p0).cross(p2 - p0);	// Area-weighted
+		}
+		centroid /= 3.0f * (last - clusters[c]);
+
+		key[c] = (centroid - center).dot(normal.normalized());
+		order[c] = c;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&key](int a, int b) { return key[a] > key[b]; });
+
+	ArrayXXi	sorted(3, nFaces);
+	int n = 0;
+	for (int i = 0; i < nClusters; i++)
+	{
+		int c = order[i];
+		int last = (c + 1 < nClusters) ? clusters[c + 1] : nFaces;
+		int count = last - clusters[c];
+
+		sorted.middleCols(n, count) = face.middleCols(clusters[c], count);
+		n += count;
+	}
+
+	face.swap(sorted);
+}
+
+void
+remapVertexFetch(Ref<MatrixXf> vertex, Ref<MatrixXf> normal, Ref<ArrayXXi> face)
+{
+	int nVertices = int(vertex.cols());
+
+	VectorXi	remap = VectorXi::Constant(nVertices, -1);
+	int			n = 0;
+
+	for (int i = 0; i < face.size(); i++)
+	{
+		int& v = face.data()[i];
+		if (remap(v) < 0) remap(v) = n++;
+		v = remap(v);
+	}
+
+	// Unreferenced vertices at the end
+	for (int v = 0; v < nVertices; v++)
+		if (remap(v) < 0) remap(v) = n++;
+
+	MatrixXf	newVertex(3, nVertices), newNormal(3, nVertices);
+	for (int v = 0; v < nVertices; v++)
+	{
+		newVertex.col(remap(v)) = vertex.col(v);
+		newNormal.col(remap(v)) = normal.col(v);
+	}
+
+	vertex = newVertex;
+	normal = newNormal;
+}
+
+void
+optimizeMesh(Ref<MatrixXf> vertex, Ref<MatrixXf> normal, Ref<ArrayXXi> face, int cacheSize)
+{
+	int nVertices = int(vertex.cols());
+
+	float	acmr0, atvr0, acmr1, atvr1;
+	vertexCacheStatistics(face, nVertices, cacheSize, acmr0, atvr0);
+
+	ArrayXXi			reordered;
+	std::vector<int>	clusters;
+	tipsify(face, nVertices, cacheSize, reordered, clusters);
+	sortClustersForOverdraw(vertex, reordered, clusters);
+
+	face = reordered;
+	remapVertexFetch(vertex, normal, face);
+
+	vertexCacheStatistics(face, nVertices, cacheSize, acmr1, atvr1);
+
+	cout << "Status: Vertex cache " << cacheSize << ", " << clusters.size() << " clusters" << endl;
+	cout << "  ACMR " << acmr0 << " -> " << acmr1 << endl;
+	cout << "  ATVR " << atvr0 << " -> " << atvr1 << endl;
+}
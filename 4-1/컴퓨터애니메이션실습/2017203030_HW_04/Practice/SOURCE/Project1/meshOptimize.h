@@ -0,0 +1,28 @@
+#ifndef _MESH_OPTIMIZE_H_
+#define _MESH_OPTIMIZE_H_
+
+#include <vector>
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+// Post-transform vertex cache statistics with a FIFO cache of the given size
+// ACMR: average cache miss ratio, i.e. # transformed vertices per triangle (0.5 ~ 3)
+// ATVR: average transformed vertex ratio, i.e. # transformed vertices per vertex (1 ~ 6)
+void	vertexCacheStatistics(const Ref<const ArrayXXi>& face, int nVertices, int cacheSize, float& acmr, float& atvr);
+
+// Tipsify triangle reordering (Sander et al. 2007). The starts of the clusters,
+// i.e. the faces after the hard boundaries, are returned in clusters.
+void	tipsify(const Ref<const ArrayXXi>& face, int nVertices, int cacheSize, ArrayXXi& out, std::vector<int>& clusters);
+
+// Overdraw-aware ordering: the clusters facing outward from the center are drawn first.
+void	sortClustersForOverdraw(const Ref<const MatrixXf>& vertex, ArrayXXi& face, const std::vector<int>& clusters);
+
+// Renumber the vertices in the order of the first reference for the vertex fetch.
+void	remapVertexFetch(Ref<MatrixXf> vertex, Ref<MatrixXf> normal, Ref<ArrayXXi> face);
+
+// All of the above before the upload with the statistics before and after.
+// The sizes do not change, so the Map<> views of an ArenaMesh are reordered in place.
+void	optimizeMesh(Ref<MatrixXf> vertex, Ref<MatrixXf> normal, Ref<ArrayXXi> face, int cacheSize = 16);
+
+#endif	// _MESH_OPTIMIZE_H_
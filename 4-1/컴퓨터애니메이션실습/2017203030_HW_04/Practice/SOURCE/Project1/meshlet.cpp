@@ -0,0 +1,190 @@
+#include "meshlet.h"
+#include "glShader.h"
+#include "vertexNormal.h"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#include <iostream>
+using namespace std;
+
+// Bounding sphere and normal cone of the faces of the meshlet
+static void
+computeMeshletBounds(const MatrixXf& vertex, const ArrayXXi& face, const MatrixXf& faceNormal, Meshlet& m)
+{
+	Vector3f	bbMin = Vector3f::Constant(FLT_MAX), bbMax = Vector3f::Constant(-FLT_MAX);
+	for (int f = m.firstTri; f < m.firstTri + m.numTris; f++)
+		for (int k = 0; k < 3; k++)
+		{
+			bbMin = bbMin.cwiseMin(vertex.col(face(k, f)));
+			bbMax = bbMax.cwiseMax(vertex.col(face(k, f)));
+		}
+
+	m.center = 0.5f * (bbMin + bbMax);
+	m.radius = 0;
+	for (int f = m.firstTri; f < m.firstTri + m.numTris; f++)
+		for (int k = 0; k < 3; k++)
+			m.radius = std::max(m.radius, (vertex.col(face(k, f)) - m.center).norm());
+
+	Vector3f	axis = Vector3f::Zero();
+	for (int f = m.firstTri; f < m.firstTri + m.numTris; f++)
+		axis += faceNormal.col(f);
+	m.coneAxis = axis.normalized();
+
+	float	minDot = 1;
+	for (int f = m.firstTri; f < m.firstTri + m.numTris; f++)
+		minDot = std::min(minDot, m.coneAxis.dot(faceNormal.col(f)));
+
+	// A cone wider than a hemisphere is never back-facing.
+	m.coneCutoff = (minDot <= 0 || axis.squaredNorm() == 0) ? 2.0f : sqrtf(1 - minDot * minDot);
+}
+
+void
+buildMeshlets(const MatrixXf& vertex, ArrayXXi& face, std::vector<Meshlet>& meshlets, int maxVertices, int maxTris)
+{
+	int nVertices = int(vertex.cols());
+	int nFaces = int(face.cols());
+
+	VertexFaceAdjacency	adj;
+	buildVertexFaceAdjacency(face, nVertices, adj);
+
+	MatrixXf	faceNormal;
+	computeFaceNormals(vertex, face, faceNormal);
+
+	std::vector<bool>	emitted(nFaces, false);
+	VectorXi			stamp = VectorXi::Constant(nVertices, -1);	// Meshlet that has the vertex
+	std::vector<int>	local;		// Vertices of the current meshlet
+	ArrayXXi			out(3, nFaces);
+	int					nOut = 0;
+	int					seed = 0;
+
+	meshlets.clear();
+	while (nOut < nFaces)
+	{
+		// Seed: the next face in the order, which is coherent after optimizeMesh()
+		while (emitted[seed]) seed++;
+
+		Meshlet	m;
+		m.firstTri = nOut;
+		m.numTris = 0;
+		m.numVertices = 0;
+
+		int	id = int(meshlets.size());
+		local.clear();
+
+		Vector3f	axis = Vector3f::Zero();	// Sum of the face normals
+
+		for (int f = seed; f >= 0; )
+		{
+			// Add the face
+			for (int k = 0; k < 3; k++)
+			{
+				int v = face(k, f);
+				if (stamp(v) != id) { stamp(v) = id; local.push_back(v); }
+				out(k, nOut) = v;
+			}
+			emitted[f] = true;
+			axis += faceNormal.col(f);
+			nOut++;
+			if (++m.numTris == maxTris) break;
+
+			// Next: an adjacent face adding the fewest new vertices,
+			// and then the closest to the normal cone for the back-face culling
+			f = -1;
+			int		best = 3;
+			float	bestDot = -FLT_MAX;
+			for (size_t i = 0; i < local.size(); i++)
+			{
+				int v = local[i];
+				for (int j = adj.offset(v); j < adj.offset(v + 1); j++)
+				{
+					int g = adj.corner(j) / 3;
+					if (emitted[g]) continue;
+
+					int nNew = (stamp(face(0, g)) != id) + (stamp(face(1, g)) != id) + (stamp(face(2, g)) != id);
+					if (nNew > best || int(local.size()) + nNew > maxVertices) continue;
+
+					float	dot = axis.dot(faceNormal.col(g));
+					if (nNew < best || dot > bestDot) { best = nNew; bestDot = dot; f = g; }
+				}
+			}
+		}
+
+		m.numVertices = int(local.size());
+		meshlets.push_back(m);
+	}
+
+	face = out;
+
+	// Bounds of the meshlets
+	computeFaceNormals(vertex, face, faceNormal);
+
+	int	nMeshlets = int(meshlets.size());
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < nMeshlets; i++)
+		computeMeshletBounds(vertex, face, faceNormal, meshlets[i]);
+
+	cout << "Meshlets: " << nMeshlets << " with " << float(nFaces) / nMeshlets << " triangles on average" << endl;
+}
+
+void
+cullMeshlets(const std::vector<Meshlet>& meshlets, const Matrix4f& MVP, const Vector3f& eye,
+	std::vector<GLsizei>& count, std::vector<const GLvoid*>& offset, MeshletStats& stats)
+{
+	// Frustum planes in the model space (Gribb and Hartmann): row 3 +/- rows 0, 1, 2
+	Vector4f	plane[6];
+	for (int i = 0; i < 3; i++)
+	{
+		plane[2 * i + 0] = MVP.row(3).transpose() + MVP.row(i).transpose();
+		plane[2 * i + 1] = MVP.row(3).transpose() - MVP.row(i).transpose();
+	}
+	for (int i = 0; i < 6; i++)
+		plane[i] /= plane[i].head<3>().norm();
+
+	count.clear();
+	offset.clear();
+
+	for (size_t i = 0; i < meshlets.size(); i++)
+	{
+		const Meshlet&	m = meshlets[i];
+		stats.nMeshlets++;
+
+		// Outside any plane of the frustum
+		bool	outside = false;
+		for (int j = 0; j < 6 && !outside; j++)
+			outside = plane[j].head<3>().dot(m.center) + plane[j](3) < -m.radius;
+		if (outside) { stats.nFrustumCulled++; continue; }
+
+		// Every face in the normal cone faces away from every point of the sphere
+		Vector3f	d = m.center - eye;
+		if (d.dot(m.coneAxis) >= m.coneCutoff * d.norm() + m.radius) { stats.nBackfaceCulled++; continue; }
+
+		// Merge with the previous range if contiguous
+		const GLvoid*	first = (const GLvoid*)(size_t(m.firstTri) * 3 * sizeof(GLuint));
+		if (!count.empty() && (const char*)offset.back() + count.back() * sizeof(GLuint) == (const char*)first)
+			count.back() += 3 * m.numTris;
+		else
+		{
+			count.push_back(3 * m.numTris);
+			offset.push_back(first);
+		}
+
+		stats.nTris += m.numTris;
+	}
+}
+
+void
+drawMeshlets(GLuint vao, const std::vector<GLsizei>& count, const std::vector<const GLvoid*>& offset)
+{
+	if (count.empty()) return;
+
+	glBindVertexArray(vao);
+
+	// Draw the visible ranges in one call
+	glMultiDrawElements(GL_TRIANGLES, count.data(), GL_UNSIGNED_INT, offset.data(), GLsizei(count.size()));
+
+	glBindVertexArray(0);
+
+	isOK("drawMeshlets()", __FILE__, __LINE__);
+}
@@ -0,0 +1,49 @@
+#ifndef _MESHLET_H_
+#define _MESHLET_H_
+
+#include <GL/glew.h>
+
+#include <vector>
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+// A cluster of triangles: a contiguous range in the index buffer
+// with the bounds for the culling
+struct Meshlet
+{
+	int			firstTri;		// First triangle in the index buffer
+	int			numTris;		// <= maxTris
+	int			numVertices;	// # unique vertices <= maxVertices
+
+	Vector3f	center;			// Bounding sphere
+	float		radius;
+
+	Vector3f	coneAxis;		// Normal cone: average normal of the faces
+	float		coneCutoff;		// Sine of the half angle, or > 1 if never back-facing
+};
+
+struct MeshletStats
+{
+	int	nMeshlets;
+	int	nFrustumCulled;
+	int	nBackfaceCulled;
+	int	nTris;					// # triangles drawn
+
+	MeshletStats() { clear(); }
+	void clear() { nMeshlets = 0; nFrustumCulled = 0; nBackfaceCulled = 0; nTris = 0; }
+};
+
+// Grow the meshlets over the adjacent faces and reorder the faces by the meshlets,
+// so the mesh is uploaded as one index buffer.
+void	buildMeshlets(const MatrixXf& vertex, ArrayXXi& face, std::vector<Meshlet>& meshlets,
+	int maxVertices = 64, int maxTris = 124);
+
+// Visible ranges of the meshlets for glMultiDrawElements(). The eye is in the model space
+// and the frustum planes are extracted from the ModelViewProjection matrix.
+void	cullMeshlets(const std::vector<Meshlet>& meshlets, const Matrix4f& MVP, const Vector3f& eye,
+	std::vector<GLsizei>& count, std::vector<const GLvoid*>& offset, MeshletStats& stats);
+
+void	drawMeshlets(GLuint vao, const std::vector<GLsizei>& count, const std::vector<const GLvoid*>& offset);
+
+#endif	// _MESHLET_H_
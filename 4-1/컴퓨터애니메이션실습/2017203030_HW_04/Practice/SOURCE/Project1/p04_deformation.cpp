@@ -1,6 +1,14 @@
+#include "assetLoader.h"
 #include "glSetup.h"
 #include "glShader.h"
 #include "mesh.h"
+#include "meshArena.h"
+#include "meshCache.h"
+#include "meshOptimize.h"
+#include "meshlet.h"
+#include "offReader.h"
+#include "simplify.h"
+#include "streamMesh.h"
 
 #include <Eigen/Dense>
 using namespace Eigen;
@@ -13,6 +21,10 @@ using namespace std;
 #endif
 
 #include <math.h>
+#include <string.h>
+#include <chrono>
+#include <future>
+#include <vector>
 
 void update();
 void render(GLFWwindow* window);
@@ -44,6 +56,28 @@ float	tau = 0;			// twisting in twist deformer and phase in the wave deformer
 bool	CCW = true;			// ccw or cw rotation
 float	frequency = 40.0;	// Spatial frequence in the wave deformer
 
+// Uniform blocks shared by the programs in the std140 layout
+const GLuint	FRAME_BINDING = 0;
+const GLuint	OBJECT_BINDING = 1;
+
+struct FrameBlock
+{
+	GLfloat	ViewMatrix[16];
+	GLfloat	ProjectionMatrix[16];
+	GLfloat	LightPosition[4];	// vec3 padded to a vec4
+};
+
+struct ObjectBlock
+{
+	GLfloat	ModelViewMatrix[16];
+	GLfloat	ModelViewProjectionMatrix[16];
+	GLfloat	NormalMatrix[12];	// mat3 as 3 columns padded to vec4
+};
+
+UniformBuffer	frameUBO;	// Camera and light of the frame
+UniformBuffer	objectUBO;	// Transforms of all the objects drawn in the frame
+int				nObjects = 0;
+
 // Program and shaders
 struct Program
 {
@@ -51,12 +85,52 @@ struct Program
 	GLuint fs;	//	Fragment shader
 	GLuint pg;	//	Program 
 
+	// Uniform parameters resolved after linking
+	Uniform<Vector3f>	Ka, Kd, Ks;
+	Uniform<float>		Shininess;
+	Uniform<float>		twisting;		// Twist deformer
+	Uniform<float>		phase, F;		// Wave deformer
+	Uniform<Vector3f>	PositionOffset, PositionScale;
+	Uniform<int>		OctahedralNormal;
+
 	Program() { vs = 0; fs = 0; pg = 0; }
 
 	void
 	create(const char* vertexShaderFileName, const char* fragmentShaderFileName)
 	{
 		createShaders(vertexShaderFileName, fragmentShaderFileName, pg, vs, fs);
+
+		Ka = Uniform<Vector3f>(pg, "Ka");
+		Kd = Uniform<Vector3f>(pg, "Kd");
+		Ks = Uniform<Vector3f>(pg, "Ks");
+		Shininess = Uniform<float>(pg, "Shininess");
+		twisting = Uniform<float>(pg, "twisting");
+		phase = Uniform<float>(pg, "phase");
+		F = Uniform<float>(pg, "F");
+		PositionOffset = Uniform<Vector3f>(pg, "PositionOffset");
+		PositionScale = Uniform<Vector3f>(pg, "PositionScale");
+		OctahedralNormal = Uniform<int>(pg, "OctahedralNormal");
+
+		setUniformBlockBinding(pg, "Frame", FRAME_BINDING);
+		setUniformBlockBinding(pg, "Object", OBJECT_BINDING);
+	}
+
+	void
+	setMaterial(const Vector3f& ka, const Vector3f& kd, const Vector3f& ks, float shininess) const
+	{
+		setUniform(Ka, ka);
+		setUniform(Kd, kd);
+		setUniform(Ks, ks);
+		setUniform(Shininess, shininess);
+	}
+
+	// Dequantization: the identity for the float format
+	void
+	setQuantization(bool quantized, const Vector3f& offset = Vector3f::Zero(), const Vector3f& scale = Vector3f::Ones()) const
+	{
+		setUniform(PositionOffset, quantized ? offset : Vector3f(Vector3f::Zero()));
+		setUniform(PositionScale, quantized ? scale : Vector3f(Vector3f::Ones()));
+		setUniform(OctahedralNormal, quantized ? 1 : 0);
 	}
 
 	void destroy() { deleteShaders(pg, vs, fs); }
@@ -64,6 +138,42 @@ struct Program
 
 Program pgTwist;	// Program for the twist deformer
 Program pgWave;		//	Program for the wave deformer
+Program pgPhong;	//	Program for the streamed mesh and the LOD instances
+
+// Camera and light of the frame in the frame block
+void
+setFrameBlock(const Vector3f& light)
+{
+	FrameBlock*	b = (FrameBlock*)uniformBlock(frameUBO, 0);
+	Map<Matrix4f>(b->ViewMatrix) = ViewMatrix;
+	Map<Matrix4f>(b->ProjectionMatrix) = ProjectionMatrix;
+
+	// Light position in the eye cooridnate system for the fragment shader
+	Map<Vector3f>(b->LightPosition) = ViewMatrix.block<3, 3>(0, 0) * light + ViewMatrix.block<3, 1>(0, 3);
+	b->LightPosition[3] = 1;
+
+	uploadUniformBuffer(frameUBO, 1);
+	bindUniformBlock(frameUBO, 0);
+}
+
+// Append the transforms of an object to the object blocks of the frame, returning its index
+int
+addObjectBlock(const Matrix4f& M)
+{
+	ObjectBlock*	b = (ObjectBlock*)uniformBlock(objectUBO, nObjects);
+
+	// ModelView matrix
+	Matrix4f	ModelViewMatrix = ViewMatrix * M;
+	Map<Matrix4f>(b->ModelViewMatrix) = ModelViewMatrix;
+
+	// ModelViewProjection matrix in the vertex shader
+	Map<Matrix4f>(b->ModelViewProjectionMatrix) = ProjectionMatrix * ModelViewMatrix;
+
+	// Normal matrix with the columns 16 bytes apart
+	Map<Matrix3f, 0, OuterStride<4> >(b->NormalMatrix) = ModelViewMatrix.block<3, 3>(0, 0).inverse().transpose();
+
+	return nObjects++;
+}
 
 // Geometry
 struct Geometry
@@ -75,13 +185,35 @@ struct Geometry
 
 	int numTris;		//# of triangles
 
+	bool		quantized;		// Compressed vertex format
+	Vector3f	positionOffset;	// Dequantization of the positions
+	Vector3f	positionScale;
+
 	Geometry()
 	{
 		vao = 0;
 		indexId = 0;
 		vertexId = 0;
 		normalId = 0;
+
+		numTris = 0;
+		quantized = false;
+	}
+
+	// Upload in the compressed or float format
+	void
+	upload(int nTris, const GLuint* index, int nVertices, const GLfloat* vertex, const GLfloat* normal, bool quantize)
+	{
+		quantized = quantize;
+		if (quantized)
+			numTris = uploadQuantizedMesh2VBO(nTris, index, nVertices, vertex, normal, NULL,
+				vao, indexId, vertexId, normalId, 0, positionOffset, positionScale);
+		else
+			numTris = uploadMesh2VBO(nTris, index, nVertices, vertex, normal, vao, indexId, vertexId, normalId);
 	}
+
+	// Dequantization uniforms of the program
+	void	setUniforms(const Program& program) const { program.setQuantization(quantized, positionOffset, positionScale); }
 };
 
 Geometry	plane[4]; // VAO and VBO for nxn planar meshes
@@ -95,11 +227,49 @@ const char* planeFileName[4] = {
 
 int level = 3;
 
+// Assets are parsed in the background and uploaded within the time budget of each frame.
+MeshAsset	planeAsset[4];
+Geometry	placeholder;			// Drawn until any plane is ready
+double		uploadBudget = 0.004;	// Seconds per frame for the uploads
+double		loadStart = 0;
+bool		loaded = false;
+
+// Reorder the triangles and vertices for the vertex cache and overdraw before the upload
+bool	optimizeOrder = true;
+
+// 16-bit positions and octahedral normals: 10 bytes per vertex instead of 24
+bool	quantizeVertices = true;
+size_t	vertexBytes = 0;	// Total vertex memory in the GPU
+
+// Out-of-core mesh given in the command line, drawn while it is streamed
+const char*		streamFileName = NULL;
+size_t			streamBudget = 64 << 20;	// Host memory budget of the loader
+StreamingMesh	streaming;
+
+// LOD chain of the mesh given in the command line with -lod
+bool	lodMode = false;
+std::vector<MeshLOD>	lods;
+std::vector<Geometry>	lodGeometry;
+float	lodThreshold = 1.0f;	// Max. screen-space error in pixels
+int		lodGrid = 5;			// lodGrid x lodGrid instances receding from the camera
+int		lodTris = -1;			// # triangles drawn in the last frame
+
+std::future<bool>	lodWorker;		// Simplification in the background
+int					lodReady = 0;	// Levels lodReady ... are uploaded, from the coarsest
+
+// Meshlets of the LOD levels culled on the CPU
+bool	meshletCulling = true;
+std::vector< std::vector<Meshlet> >	lodMeshlets;
+std::vector<GLsizei>		drawCount;		// Visible ranges for glMultiDrawElements()
+std::vector<const GLvoid*>	drawOffset;
+
 // Wireframe view
 bool	wireframe = false;
 
-// Example 0 for the twist deformer and 1 for the wave deformer
+// Example 0 for the twist deformer, 1 for the wave deformer,
+// 2 for the streamed mesh and 3 for the LOD instances
 int		example = 1;
+int		numExamples = 2;
 
 void
 reshapeModernOpenGL(GLFWwindow* window, int w, int h)
@@ -124,9 +294,132 @@ reshapeModernOpenGL(GLFWwindow* window, int w, int h)
 	cerr << " with screeen " << screenW << " x " << screenH << endl;
 }
 
+// Preparation of the planes on the worker threads
+void
+preparePlane(ArenaMesh& mesh)
+{
+	// Optimize the order for the vertex cache, overdraw and vertex fetch, in the arena
+	if (optimizeOrder) optimizeMesh(mesh.vertexMap(), mesh.normalMap(), mesh.faceMap());
+}
+
+// LOD chain and its meshlets on a worker thread
+bool
+buildLODAsset()
+{
+	ArrayXXi face;
+	MatrixXf vertex;
+	MatrixXf normal;
+
+	limitWorkerThreads();	// Beside the render thread
+	readMesh(streamFileName, vertex, normal, face);
+	if (face.cols() == 0) return false;
+
+	buildLODChain(vertex, face, lods);
+
+	lodMeshlets.resize(lods.size());
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		if (optimizeOrder) optimizeMesh(lods[i].vertex, lods[i].normal, lods[i].face);
+		buildMeshlets(lods[i].vertex, lods[i].face, lodMeshlets[i]);
+	}
+
+	return true;
+}
+
+// Two triangles in the unit square standing in for the planes
+void
+createPlaceholder()
+{
+	GLuint	index[6] = { 0, 1, 2, 0, 2, 3 };
+	GLfloat	vertex[12] = { -0.5f, -0.5f, 0, 0.5f, -0.5f, 0, 0.5f, 0.5f, 0, -0.5f, 0.5f, 0 };
+	GLfloat	normal[12] = { 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1 };
+
+	createVBO(placeholder.vao, placeholder.indexId, placeholder.vertexId, placeholder.normalId);
+	placeholder.upload(2, index, 4, vertex, normal, false);
+}
+
+// Upload the assets parsed so far within the time budget
+void
+serviceUploads(double timeBudget)
+{
+	double	deadline = glfwGetTime() + timeBudget;
+
+	for (int i = 0; i < 4 && glfwGetTime() < deadline; i++)
+	{
+		if (!pollMeshAsset(planeAsset[i])) continue;
+
+		int				numTris, numVertices;
+		const GLuint*	index;
+		const GLfloat*	vertex;
+		const GLfloat*	normal;
+		getMeshAssetArrays(planeAsset[i], numTris, index, numVertices, vertex, normal);
+
+		// Create VAO and VBO for a nxn planar mesh
+		createVBO(plane[i].vao, plane[i].indexId, plane[i].vertexId, plane[i].normalId);
+		plane[i].upload(numTris, index, numVertices, vertex, normal, quantizeVertices);
+		vertexBytes += size_t(numVertices) * (quantizeVertices ? 10 : 24);
+
+		releaseMeshAsset(planeAsset[i]);
+	}
+
+	// LOD levels from the coarsest, so the instances are refined progressively
+	if (lodWorker.valid() && lodWorker.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		if (lodWorker.get())
+		{
+			lodGeometry.resize(lods.size());
+			lodReady = int(lods.size());
+		}
+		else numExamples = 2;
+	}
+
+	while (lodReady > 0 && glfwGetTime() < deadline)
+	{
+		int			i = --lodReady;
+		Geometry&	g = lodGeometry[i];
+
+		createVBO(g.vao, g.indexId, g.vertexId, g.normalId);
+		g.upload(int(lods[i].face.cols()), (const GLuint*)lods[i].face.data(), int(lods[i].vertex.cols()),
+			lods[i].vertex.data(), lods[i].normal.data(), quantizeVertices);
+		vertexBytes += size_t(lods[i].vertex.cols()) * (quantizeVertices ? 10 : 24);
+	}
+
+	// Report once everything has arrived
+	if (!loaded)
+	{
+		loaded = !lodWorker.valid() && lodReady == 0;
+		for (int i = 0; i < 4; i++)
+			loaded = loaded && (planeAsset[i].state == ASSET_READY || planeAsset[i].state == ASSET_FAILED);
+
+		if (loaded)
+			cout << "Status: Assets loaded in " << glfwGetTime() - loadStart << " s, " << vertexBytes / 1024
+				<< " KB of vertex data in the " << (quantizeVertices ? "compressed" : "float") << " format" << endl;
+	}
+}
+
+// The plane of the level, or the nearest one uploaded so far, or the placeholder
+const Geometry&
+readyPlane(int level)
+{
+	for (int d = 0; d < 4; d++)
+	{
+		if (level - d >= 0 && plane[level - d].numTris > 0) return plane[level - d];
+		if (level + d < 4 && plane[level + d].numTris > 0) return plane[level + d];
+	}
+
+	return placeholder;
+}
+
 int
 main(int argc, char* argv[])
 {
+	// Usage: p04_deformation [mesh.off [memory budget in MB]]
+	//        p04_deformation -lod mesh.off
+	int	arg = 1;
+	if (argc > arg && strcmp(argv[arg], "-lod") == 0)	{ lodMode = true; arg++; }
+	if (argc > arg)	streamFileName = argv[arg++];
+	if (argc > arg)	streamBudget = size_t(atoi(argv[arg])) << 20;
+
 	// Initialize the OpenGL system: true for modern OpenGL
 	GLFWwindow* window = initializeOpenGL(argc, argv, bgColor, true);
 	if (window == NULL) return -1;
@@ -143,24 +436,38 @@ main(int argc, char* argv[])
 
 	// Initialization
 	{
+		// Parse the planes in the background while the shaders are compiled
+		loadStart = glfwGetTime();
+		for (int i = 0; i < 4; i++)
+			loadMeshAsync(planeFileName[i], planeAsset[i], optimizeOrder ? OFFB_OPTIMIZED : 0, preparePlane);
+
+		// LOD chain of the mesh in memory
+		if (streamFileName && lodMode)
+		{
+			lodWorker = std::async(std::launch::async, buildLODAsset);
+			numExamples = 4;
+			example = 3;
+		}
+
 		// Create shaders for the twist and wave deformers
+		// The programs are loaded from the binaries cached by the previous launch if possible.
+		double	t0 = glfwGetTime();
 		pgTwist.create("sv04_twist.glsl", "sf02_Phong.glsl");
 		pgWave.create("sv04_wave.glsl", "sf02_Phong.glsl");
+		pgPhong.create("sv02_Phong.glsl", "sf02_Phong.glsl");
+		cout << "Status: Shaders created in " << (glfwGetTime() - t0) * 1000.0 << " ms" << endl;
 
-		ArrayXXi face;
-		MatrixXf vertex;
-		MatrixXf normal;
+		// Uniform blocks of the camera and light, and of the objects
+		createUniformBuffer(frameUBO, FRAME_BINDING, sizeof(FrameBlock));
+		createUniformBuffer(objectUBO, OBJECT_BINDING, sizeof(ObjectBlock));
 
-		for (int i = 0; i < 4; i++)
-		{
-			// Create VAO and VBO for a nxn planar mesh
-			createVBO(plane[i].vao, plane[i].indexId, plane[i].vertexId, plane[i].normalId);
+		createPlaceholder();
 
-			// Load the mesh
-			readMesh(planeFileName[i], vertex, normal, face);
-			
-			// Upload the data into the buffers
-			plane[i].numTris = uploadMesh2VBO(face, vertex, normal, plane[i].vao, plane[i].indexId, plane[i].vertexId, plane[i].normalId);
+		// Start streaming the large mesh
+		if (!lodMode && streamFileName && openStreamingMesh(streamFileName, streaming, streamBudget))
+		{
+			numExamples = 3;
+			example = 2;
 		}
 	}
 
@@ -169,11 +476,15 @@ main(int argc, char* argv[])
 	cout << "Keyboard Input : space for play / pause" << endl;
 	cout << "Keyboard Input: q/esc for quit" << endl;
 	cout << endl;
-	cout << "Keyboard Input: t to toggle twist/wave deformers" << endl;
+	cout << "Keyboard Input: t to toggle twist/wave deformers (and the streamed mesh)" << endl;
 	cout << "Keyboard Input: w to toggle the wireframe view" << endl;
 	cout << "Keyboard Input: up/down to increase/decrease the spatial frequency" << endl;
 	cout << "Keyboard Input: r for reversting the direction" << endl;
 	cout << "Keyboard Input: i for initialization" << endl;
+	cout << "Keyboard Input: b to benchmark the mesh reader on the current level" << endl;
+	cout << "Keyboard Input: v to benchmark the separate/interleaved vertex layouts" << endl;
+	cout << "Keyboard Input: left/right to decrease/increase the LOD error threshold" << endl;
+	cout << "Keyboard Input: c to toggle the meshlet culling" << endl;
 	cout << endl;
 	cout << "Keyboard Input: 1 for the 32 x 32 planar mesh" << endl;
 	cout << "Keyboard Input: 2 for the 64 x 64 planar mesh" << endl;
@@ -183,24 +494,48 @@ main(int argc, char* argv[])
 	// Main loop			
 	while (!glfwWindowShouldClose(window))
 	{
+		// Upload the assets parsed in the background
+		serviceUploads(uploadBudget);
+
+		// Stream the large mesh for a part of the frame
+		if (streaming.stage != STREAM_DONE) streamMesh(streaming, 0.008);
+
 		// Update one frame if not paused			
 		if (!pause) update();
 
 		// Draw one frame			
 		render(window);
 
-		glfwSwapBuffers(window);	// Swap buffers			
+		swapBuffers(window);		// Swap buffers, or read back the frame in the headless mode			
 		glfwPollEvents();	// Events			
 	}
 
 	// Finalization			
 	{
+		// Wait for the workers
+		for (int i = 0; i < 4; i++)
+		{
+			if (planeAsset[i].worker.valid()) planeAsset[i].worker.wait();
+			releaseMeshAsset(planeAsset[i]);
+		}
+		if (lodWorker.valid()) lodWorker.wait();
+
 		//	Delete VBO and shaders			
 		for (int i = 0; i < 4; i++)
 			deleteVBO(plane[i].vao, plane[i].indexId, plane[i].vertexId, plane[i].normalId);
+		deleteVBO(placeholder.vao, placeholder.indexId, placeholder.vertexId, placeholder.normalId);
+
+		closeStreamingMesh(streaming);
+
+		for (size_t i = 0; i < lodGeometry.size(); i++)
+			deleteVBO(lodGeometry[i].vao, lodGeometry[i].indexId, lodGeometry[i].vertexId, lodGeometry[i].normalId);
 
 		pgTwist.destroy();
 		pgWave.destroy();
+		pgPhong.destroy();
+
+		deleteUniformBuffer(frameUBO);
+		deleteUniformBuffer(objectUBO);
 	}
 
 	// Terminate the glfw system	
@@ -210,32 +545,112 @@ main(int argc, char* argv[])
 	return 0;
 }
 
+// Compare the mapped parallel reader with the ifstream reader
 void
-update()
+benchmarkReadMesh(const char* filename, int nRepeats = 5)
 {
-	if (CCW)	tau += 1.0f / 60.0f;
-	else		tau -= 1.0f / 60.0f;
+	ArrayXXi face;
+	MatrixXf vertex;
+	MatrixXf normal;
+	int		nEdges;
+
+	// The parsers alone
+	double	t0 = glfwGetTime();
+	for (int i = 0; i < nRepeats; i++)
+		readOFFStream(filename, vertex, face, nEdges);
+	double	tStream = (glfwGetTime() - t0) / nRepeats;
+
+	t0 = glfwGetTime();
+	for (int i = 0; i < nRepeats; i++)
+		readOFF(filename, vertex, face, nEdges);
+	double	tMapped = (glfwGetTime() - t0) / nRepeats;
+
+	// The whole loading with the welding and the normals
+	t0 = glfwGetTime();
+	for (int i = 0; i < nRepeats; i++)
+		readMesh(filename, vertex, normal, face);
+	double	tMesh = (glfwGetTime() - t0) / nRepeats;
+
+	// Including the teardown: one free instead of one per array
+	t0 = glfwGetTime();
+	for (int i = 0; i < nRepeats; i++)
+	{
+		ArenaMesh	mesh;
+		readArenaMesh(filename, mesh);
+		freeArenaMesh(mesh);
+	}
+	double	tArena = (glfwGetTime() - t0) / nRepeats;
+
+	cout << "Benchmark: " << filename << endl;
+	cout << "  parse ifstream : " << tStream * 1000.0 << " ms" << endl;
+	cout << "  parse mapped   : " << tMapped * 1000.0 << " ms (" << tStream / tMapped << "x)" << endl;
+	cout << "  load readMesh  : " << tMesh * 1000.0 << " ms" << endl;
+	cout << "  load arena     : " << tArena * 1000.0 << " ms (" << tMesh / tArena << "x)" << endl;
 }
 
+// Compare the separate and interleaved vertex layouts drawing the mesh with the wave deformer
 void
-setUniformMVP(GLuint program, Matrix4f& M, Matrix4f& V, Matrix4f& P)
+benchmarkVertexLayout(const char* filename, int nDraws = 200)
 {
-	// ModelView matrix
-	Matrix4f	ModelViewMatrix = V * M;
-	setUniform(program, "ModelViewMatrix", ModelViewMatrix);
+	ArrayXXi face;
+	MatrixXf vertex;
+	MatrixXf normal;
+
+	readMesh(filename, vertex, normal, face);
+	if (optimizeOrder) optimizeMesh(vertex, normal, face);
+
+	Geometry	layout[2];	// Separate and interleaved
+	for (int i = 0; i < 2; i++)
+		createVBO(layout[i].vao, layout[i].indexId, layout[i].vertexId, layout[i].normalId);
+
+	layout[0].numTris = uploadMesh2VBO(face, vertex, normal, layout[0].vao, layout[0].indexId, layout[0].vertexId, layout[0].normalId);
+	layout[1].numTris = uploadInterleavedMesh2VBO(face, vertex, normal, layout[1].vao, layout[1].indexId, layout[1].vertexId);
+
+	// Same state as the wave example
+	Affine3f	T;	T = Matrix3f(AngleAxisf(-float(M_PI) / 3.0f, Vector3f::UnitX())) * Scaling(1.5f, 1.5f, 1.5f);
+	Matrix4f	ModelMatrix = T.matrix();
+	setFrameBlock(light2);
+	nObjects = 0;
+	int	object = addObjectBlock(ModelMatrix);
+	uploadUniformBuffer(objectUBO, nObjects);
+	bindUniformBlock(objectUBO, object);
+	pgWave.setQuantization(false);
+	glUseProgram(pgWave.pg);
+
+	double	t[2];
+	for (int i = 0; i < 2; i++)
+	{
+		drawVBO(layout[i].vao, layout[i].numTris);	// Warm up
+		glFinish();
+
+		double	t0 = glfwGetTime();
+		for (int j = 0; j < nDraws; j++)
+			drawVBO(layout[i].vao, layout[i].numTris);
+		glFinish();
+		t[i] = (glfwGetTime() - t0) / nDraws;
+	}
 
-	// Normal matrix
-	Matrix3f	NormalMatrix = ModelViewMatrix.block<3, 3>(0, 0).inverse().transpose();
-	setUniform(program, "NormalMatrix", NormalMatrix);
+	for (int i = 0; i < 2; i++)
+		deleteVBO(layout[i].vao, layout[i].indexId, layout[i].vertexId, layout[i].normalId);
 
-	// ModelViewProjection matrix in the vertex shader
-	Matrix4f	ModelViewProjectionMatrix = P * ModelViewMatrix;
-	setUniform(program, "ModelViewProjectionMatrix", ModelViewProjectionMatrix);
+	cout << "Benchmark: " << filename << ", " << vertex.cols() << " vertices" << endl;
+	cout << "  separate    : " << t[0] * 1000.0 << " ms per draw" << endl;
+	cout << "  interleaved : " << t[1] * 1000.0 << " ms per draw" << endl;
+	cout << "  speedup     : " << t[0] / t[1] << "x" << endl;
+}
+
+void
+update()
+{
+	if (CCW)	tau += 1.0f / 60.0f;
+	else		tau -= 1.0f / 60.0f;
 }
 
 void
 render(GLFWwindow * window)
 {
+	PROFILE_GPU_ZONE("render");
+
 	// Antialiasing
 	if (aaEnabled)  glEnable(GL_MULTISAMPLE);
 	else			glDisable(GL_MULTISAMPLE);
@@ -251,33 +666,36 @@ render(GLFWwindow * window)
 	// Camera configuration
 	ViewMatrix = lookAt<float>(eye, center, up);
 
+	// No object blocks yet in this frame
+	nObjects = 0;
+
 	if (example == 0)
 	{
 		// Modeling matrix
 		Matrix4f	ModelMatrix;
 		ModelMatrix.setIdentity();
 	
-		// Model, view, projection matrices
-		setUniformMVP(pgTwist.pg, ModelMatrix, ViewMatrix, ProjectionMatrix);
-
-		// Light position in the eye cooridnate system for the fragment shader
-		Vector3f	l = ViewMatrix.block<3, 3>(0, 0) * light1 + ViewMatrix.block<3, 1>(0, 3);
-		setUniform(pgTwist.pg, "LightPosition", l);
+		// Camera and light, and the model, view, projection matrices
+		setFrameBlock(light1);
+		int	object = addObjectBlock(ModelMatrix);
+		uploadUniformBuffer(objectUBO, nObjects);
+		bindUniformBlock(objectUBO, object);
 
 		// Draw objects: only the bunny in this case.
 		{
 			// Material is dependent of the object
-			setUniform(pgTwist.pg, "Ka", Vector3f(0.10f, 0.10f, 0.10f));
-			setUniform(pgTwist.pg, "Kd", Vector3f(0.75f, 0.75f, 0.75f));
-			setUniform(pgTwist.pg, "Ks", Vector3f(0.00f, 0.00f, 0.00f));
-			setUniform(pgTwist.pg, "Shininess", 128.0f);
+			pgTwist.setMaterial(Vector3f(0.10f, 0.10f, 0.10f), Vector3f(0.75f, 0.75f, 0.75f), Vector3f(0.00f, 0.00f, 0.00f), 128.0f);
 			
 			// Twisting
-			setUniform(pgTwist.pg, "twisting", tau);
+			setUniform(pgTwist.twisting, tau);
+
+			// Vertex format
+			const Geometry&	g = readyPlane(level);
+			g.setUniforms(pgTwist);
 			
 			// Draw the mesh using the program and the vertex buffer object
 			glUseProgram(pgTwist.pg);
-			drawVBO(plane[level].vao, plane[level].numTris);
+			drawVBO(g.vao, g.numTris);
 		}
 	}
 	else if (example == 1)
@@ -286,33 +704,151 @@ render(GLFWwindow * window)
 		Affine3f	T;	T = Matrix3f(AngleAxisf(-float(M_PI) / 3.0f, Vector3f::UnitX())) * Scaling(1.5f, 1.5f, 1.5f);
 		Matrix4f	ModelMatrix = T.matrix();
 		
-		// Model, view, projection matrices
-		setUniformMVP(pgWave.pg, ModelMatrix, ViewMatrix, ProjectionMatrix);
-		
-		// Light position in the eye cooridnate system for the fragment shader
-		Vector3f	l = ViewMatrix.block<3, 3>(0, 0) * light2 + ViewMatrix.block<3, 1>(0, 3);
-		setUniform(pgWave.pg, "LightPosition", l);
+		// Camera and light, and the model, view, projection matrices
+		setFrameBlock(light2);
+		int	object = addObjectBlock(ModelMatrix);
+		uploadUniformBuffer(objectUBO, nObjects);
+		bindUniformBlock(objectUBO, object);
 
 		// Draw objects: only the bunny in this case.
 		{
 			// Material is dependent of the object
-			setUniform(pgWave.pg, "Ka", Vector3f(0.10f, 0.10f, 0.10f));
-			setUniform(pgWave.pg, "Kd", Vector3f(0.75f, 0.75f, 0.75f));
-			setUniform(pgWave.pg, "Ks", Vector3f(0.10f, 0.10f, 0.10f));
-			setUniform(pgWave.pg, "Shininess", 128.0f);
+			pgWave.setMaterial(Vector3f(0.10f, 0.10f, 0.10f), Vector3f(0.75f, 0.75f, 0.75f), Vector3f(0.10f, 0.10f, 0.10f), 128.0f);
 
 			// Phase
-			setUniform(pgWave.pg, "phase", 4 * tau);
+			setUniform(pgWave.phase, 4 * tau);
 			
 			// Spatial frequency
-			setUniform(pgWave.pg, "F", frequency);
+			setUniform(pgWave.F, frequency);
+
+			// Vertex format
+			const Geometry&	g = readyPlane(level);
+			g.setUniforms(pgWave);
 			
 			// Draw the mesh using the program and the vertex buffer object
 			glUseProgram(pgWave.pg);
-			drawVBO(plane[level].vao, plane[level].numTris);
+			drawVBO(g.vao, g.numTris);
 		}
 	}
 
+	else if (example == 2 && !streaming.pages.empty())
+	{
+		// Modeling matrix: fit the bounding box into the unit cube
+		Vector3f	c = 0.5f * (streaming.bbMin + streaming.bbMax);
+		float		s = 1.0f / (streaming.bbMax - streaming.bbMin).maxCoeff();
+		Affine3f	T;	T = Scaling(s, s, s) * Translation3f(-c);
+		Matrix4f	ModelMatrix = T.matrix();
+
+		// Camera and light, and the model, view, projection matrices
+		setFrameBlock(light1);
+		int	object = addObjectBlock(ModelMatrix);
+		uploadUniformBuffer(objectUBO, nObjects);
+		bindUniformBlock(objectUBO, object);
+
+		// Material
+		pgPhong.setMaterial(Vector3f(0.10f, 0.10f, 0.10f), Vector3f(0.75f, 0.75f, 0.75f), Vector3f(0.10f, 0.10f, 0.10f), 128.0f);
+
+		// Float vertex format
+		pgPhong.setQuantization(false);
+
+		// Draw the pages that have arrived so far
+		glUseProgram(pgPhong.pg);
+		drawStreamingMesh(streaming);
+	}
+
+	else if (example == 3 && lodReady < int(lodGeometry.size()))
+	{
+		// Fit the bounding box of the finest level into the cube of size 0.5
+		const MatrixXf&	V = lods[0].vertex;
+		Vector3f	bbMin = V.rowwise().minCoeff(), bbMax = V.rowwise().maxCoeff();
+		Vector3f	c = 0.5f * (bbMin + bbMax);
+		float		s = 0.5f / (bbMax - bbMin).maxCoeff();
+
+		// Screen-space error per unit of the object space at the unit distance
+		float	fovyR = fovy * float(M_PI) / 180.0f;
+		float	pixelsPerUnit = s * windowH / (2.0f * tanf(fovyR / 2.0f));
+
+		setFrameBlock(light1);
+
+		pgPhong.setMaterial(Vector3f(0.10f, 0.10f, 0.10f), Vector3f(0.75f, 0.75f, 0.75f), Vector3f(0.10f, 0.10f, 0.10f), 128.0f);
+
+		glUseProgram(pgPhong.pg);
+
+		// Instances on a grid receding from the camera: the transforms of all of them
+		// are uploaded at once and each draw binds its own range.
+		std::vector<Matrix4f, aligned_allocator<Matrix4f> >	instanceModel(lodGrid * lodGrid);
+		std::vector<int>		instanceLevel(lodGrid * lodGrid);
+		for (int i = 0; i < lodGrid; i++)
+			for (int j = 0; j < lodGrid; j++)
+			{
+				Vector3f	position(0.6f * (j - 0.5f * (lodGrid - 1)), -0.3f, -1.5f * i);
+				Affine3f	T;	T = Translation3f(position) * Scaling(s, s, s) * Translation3f(-c);
+				instanceModel[nObjects] = T.matrix();
+
+				// Distance along the view direction
+				float	distance = -(ViewMatrix.block<3, 3>(0, 0) * position + ViewMatrix.block<3, 1>(0, 3)).z();
+				if (distance < 0.01f) distance = 0.01f;
+
+				// The coarser levels arrive first.
+				instanceLevel[nObjects] = std::max(selectLOD(lods, distance, pixelsPerUnit, lodThreshold), lodReady);
+
+				addObjectBlock(instanceModel[nObjects]);
+			}
+		uploadUniformBuffer(objectUBO, nObjects);
+
+		int	nTris = 0;
+		MeshletStats	stats;
+		for (int object = 0; object < nObjects; object++)
+		{
+			const Matrix4f&	ModelMatrix = instanceModel[object];
+			int	k = instanceLevel[object];
+
+			bindUniformBlock(objectUBO, object);
+			lodGeometry[k].setUniforms(pgPhong);
+
+			if (meshletCulling)
+			{
+				// Eye in the model space
+				Matrix4f	MV = ViewMatrix * ModelMatrix;
+				Vector3f	e = MV.inverse().block<3, 1>(0, 3);
+
+				cullMeshlets(lodMeshlets[k], ProjectionMatrix * MV, e, drawCount, drawOffset, stats);
+				drawMeshlets(lodGeometry[k].vao, drawCount, drawOffset);
+			}
+			else
+			{
+				drawVBO(lodGeometry[k].vao, lodGeometry[k].numTris);
+				stats.nTris += lodGeometry[k].numTris;
+			}
+			nTris += lodGeometry[k].numTris;
+		}
+
+		if (stats.nTris != lodTris)
+		{
+			lodTris = stats.nTris;
+			cout << "LOD: " << nTris << " triangles, " << float(lods[0].face.cols()) * lodGrid * lodGrid / nTris
+				<< "x fewer than the finest level with " << lodThreshold << " pixel error" << endl;
+
+			if (meshletCulling)
+				cout << "Meshlets: " << stats.nMeshlets << ", " << stats.nFrustumCulled << " out of the frustum, "
+					<< stats.nBackfaceCulled << " back-facing, " << stats.nTris << " triangles drawn" << endl;
+		}
+	}
+
+	else if (example == 3)
+	{
+		// Placeholder until the coarsest level arrives
+		Matrix4f	ModelMatrix = Matrix4f::Identity();
+		setFrameBlock(light1);
+		int	object = addObjectBlock(ModelMatrix);
+		uploadUniformBuffer(objectUBO, nObjects);
+		bindUniformBlock(objectUBO, object);
+		placeholder.setUniforms(pgPhong);
+
+		glUseProgram(pgPhong.pg);
+		drawVBO(placeholder.vao, placeholder.numTris);
+	}
+
 	// Check the status
 	isOK("render()", __FILE__, __LINE__);
 }
@@ -334,17 +870,32 @@ keyboard(GLFWwindow * window, int key, int scancode, int action, int mods)
 		case GLFW_KEY_R:		CCW = !CCW;		break;	// Direction
 		
 		// Examples
-		case GLFW_KEY_T:		example = (example + 1) % 2; break;
+		case GLFW_KEY_T:		example = (example + 1) % numExamples;
+			if (example == 2 && lodMode) example = 3;	// No streamed mesh with -lod
+			break;
 
 		// Level
 		case GLFW_KEY_1:	level = 0;	break;
 		case GLFW_KEY_2:	level = 1;	break;
 		case GLFW_KEY_3:	level = 2;	break;
 		case GLFW_KEY_4:	level = 3;	break;
+
+		// Benchmark of the mesh reader
+		case GLFW_KEY_B:	benchmarkReadMesh(planeFileName[level]);	break;
+
+		// Benchmark of the vertex layouts on the 256 x 256 plane
+		case GLFW_KEY_V:	benchmarkVertexLayout(planeFileName[3]);	break;
 		
 		// Spatial frequency in the wave deformer
 		case GLFW_KEY_UP:	frequency += 1;	break;
 		case GLFW_KEY_DOWN:	frequency -= 1;	break;
+
+		// Screen-space error threshold of the LOD selection
+		case GLFW_KEY_LEFT:		lodThreshold /= 2;	break;
+		case GLFW_KEY_RIGHT:	lodThreshold *= 2;	break;
+
+		// Meshlet culling on/off
+		case GLFW_KEY_C:		meshletCulling = !meshletCulling;	lodTris = -1;	break;
 		
 		// Drawing in wireframe on/off
 		case GLFW_KEY_W:	wireframe = !wireframe; break;
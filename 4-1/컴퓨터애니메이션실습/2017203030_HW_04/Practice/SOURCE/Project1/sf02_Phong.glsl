@@ -1,7 +1,14 @@
 #version 400
 
+// Camera and light of the frame
+layout (std140) uniform Frame
+{
+	mat4	ViewMatrix;
+	mat4	ProjectionMatrix;
+	vec3	LightPosition;	// In the view coordinate system
+};
+
 // Phong reflection model
-uniform vec3	LightPosition;					// In the view coordinate system
 uniform vec3	Kd = vec3(0.95, 0.95, 0.95);	// Diffuse reflectivity
 uniform vec3	Ka = vec3(0.10, 0.10, 0.10);	// Ambient reflectivity
 uniform vec3	Ks = vec3(0.75, 0.75, 0.75);	// Specular reflectivity
@@ -0,0 +1,323 @@
+#include "simplify.h"
+#include "halfEdge.h"
+#include "vertexNormal.h"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#include <iostream>
+using namespace std;
+
+typedef std::vector<Matrix4d, aligned_allocator<Matrix4d> >	QuadricArray;
+
+// Fundamental error quadric of the plane of each face, summed to the vertices with the areas
+static void
+computeVertexQuadrics(const MatrixXf& vertex, const ArrayXXi& face, QuadricArray& Q, std::vector<double>& area)
+{
+	int nVertices = int(vertex.cols());
+	int nFaces = int(face.cols());
+
+	QuadricArray		Kp(nFaces);
+	std::vector<double>	Ka(nFaces);
+
+#pragma omp parallel for schedule(static)
+	for (int f = 0; f < nFaces; f++)
+	{
+		Vector3d	p0 = vertex.col(face(0, f)).cast<double>();
+		Vector3d	p1 = vertex.col(face(1, f)).cast<double>();
+		Vector3d	p2 = vertex.col(face(2, f)).cast<double>();
+
+		Vector3d	n = (p1 - p0).cross(p2 - p0);
+		double		area = 0.5 * n.norm();
+		if (area > 0) n /= 2.0 * area;
+
+		Vector4d	plane(n.x(), n.y(), n.z(), -n.dot(p0));
+		Kp[f] = area * plane * plane.transpose();	// Area-weighted
+		Ka[f] = area;
+	}
+
+	// Gather through the vertex-to-face adjacency
+	VertexFaceAdjacency	adj;
+	buildVertexFaceAdjacency(face, nVertices, adj);
+
+	Q.resize(nVertices);
+	area.resize(nVertices);
+
+#pragma omp parallel for schedule(static)
+	for (int v = 0; v < nVertices; v++)
+	{
+		Q[v].setZero();
+		area[v] = 0;
+		for (int j = adj.offset(v); j < adj.offset(v + 1); j++)
+		{
+			Q[v] += Kp[adj.corner(j) / 3];
+			area[v] += Ka[adj.corner(j) / 3];
+		}
+	}
+}
+
+static inline double
+quadricError(const Matrix4d& Q, const Vector3d& p)
+{
+	Vector4d	h(p.x(), p.y(), p.z(), 1.0);
+	return h.dot(Q * h);
+}
+
+// Would moving the vertex v to p flip or degenerate any of its faces other than those with w?
+static bool
+foldsOver(const MatrixXf& vertex, const ArrayXXi& face, const VertexFaceAdjacency& adj, int v, int w, const Vector3f& p)
+{
+	for (int j = adj.offset(v); j < adj.offset(v + 1); j++)
+	{
+		int f = adj.corner(j) / 3;
+		int k = adj.corner(j) % 3;
+
+		int a = face((k + 1) % 3, f), b = face((k + 2) % 3, f);
+		if (a == w || b == w) continue;	// Removed by the collapse
+
+		Vector3f	pa = vertex.col(a), pb = vertex.col(b);
+		Vector3f	n0 = (pa - vertex.col(v)).cross(pb - vertex.col(v));
+		Vector3f	n1 = (pa - p).cross(pb - p);
+
+		if (n1.dot(n0) < 0.2f * n0.norm() * n1.norm() || n1.squaredNorm() == 0) return true;
+	}
+
+	return false;
+}
+
+// Sorted one-ring of the vertex
+static void
+oneRingVertices(const ArrayXXi& face, const VertexFaceAdjacency& adj, int v, std::vector<int>& ring)
+{
+	ring.clear();
+	for (int j = adj.offset(v); j < adj.offset(v + 1); j++)
+	{
+		int f = adj.corner(j) / 3;
+		int k = adj.corner(j) % 3;
+		ring.push_back(face((k + 1) % 3, f));
+		ring.push_back(face((k + 2) % 3, f));
+	}
+	std::sort(ring.begin(), ring.end());
+	ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+}
+
+// Link condition: an interior edge keeps the mesh manifold only if
+// its end vertices share exactly the two opposite vertices.
+static bool
+isCollapsible(const ArrayXXi& face, const VertexFaceAdjacency& adj, int a, int b, std::vector<int>& ringA, std::vector<int>& ringB)
+{
+	oneRingVertices(face, adj, a, ringA);
+	oneRingVertices(face, adj, b, ringB);
+
+	int nCommon = 0;
+	for (size_t i = 0, j = 0; i < ringA.size() && j < ringB.size(); )
+	{
+		if (ringA[i] < ringB[j]) i++;
+		else if (ringB[j] < ringA[i]) j++;
+		else { nCommon++; i++; j++; }
+	}
+
+	return nCommon == 2;
+}
+
+struct Collapse
+{
+	int		v0, v1;		// Edge: v1 is merged into v0
+	double	cost;
+	Vector3f	p;		// New position of v0
+};
+
+float
+simplifyMesh(MatrixXf& vertex, ArrayXXi& face, int targetFaces)
+{
+	int nVertices = int(vertex.cols());
+
+	// The area-weighted error divided by the summed area is the mean squared distance.
+	QuadricArray		Q;
+	std::vector<double>	area;
+	computeVertexQuadrics(vertex, face, Q, area);
+
+	// Keep the boundary in place
+	HalfEdgeMesh	mesh;
+	buildHalfEdgeMesh(face, nVertices, mesh);
+
+	std::vector<char>	locked(nVertices);
+	for (int v = 0; v < nVertices; v++)
+		locked[v] = mesh.isBoundaryVertex(v);
+
+	double	maxError = 0;	// Squared distance
+
+	while (face.cols() > targetFaces)
+	{
+		int nFaces = int(face.cols());
+
+		VertexFaceAdjacency	adj;
+		buildVertexFaceAdjacency(face, nVertices, adj);
+
+		// Each interior edge once: a half-edge from the smaller vertex
+		std::vector<Collapse>	edges;
+		edges.reserve(3 * nFaces / 2);
+		for (int f = 0; f < nFaces; f++)
+			for (int k = 0; k < 3; k++)
+			{
+				int a = face(k, f), b = face((k + 1) % 3, f);
+				if (a < b && !locked[a] && !locked[b])
+				{
+					Collapse	c = {};
+					c.v0 = a;	c.v1 = b;
+					edges.push_back(c);
+				}
+			}
+
+		int nEdges = int(edges.size());
+
+		// Costs and optimal positions in parallel
+#pragma omp parallel
+		{
+		std::vector<int>	ringA, ringB;
+
+#pragma omp for schedule(dynamic, 1024)
+		for (int i = 0; i < nEdges; i++)
+		{
+			Collapse&	c = edges[i];
+			if (!isCollapsible(face, adj, c.v0, c.v1, ringA, ringB))
+			{
+				c.cost = DBL_MAX;
+				continue;
+			}
+
+			Matrix4d	Qe = Q[c.v0] + Q[c.v1];
+
+			// Minimizer of the quadric, or the best one of the end and middle points
+			Vector3d	p0 = vertex.col(c.v0).cast<double>();
+			Vector3d	p1 = vertex.col(c.v1).cast<double>();
+			Vector3d	p = 0.5 * (p0 + p1);
+
+			Matrix3d	A = Qe.block<3, 3>(0, 0);
+			if (fabs(A.determinant()) > 1e-12)
+			{
+				Vector3d	x = A.ldlt().solve(-Qe.block<3, 1>(0, 3));
+				if ((x - p).norm() < 2.0 * (p1 - p0).norm()) p = x;
+			}
+
+			double	cost = quadricError(Qe, p);
+			if (quadricError(Qe, p0) < cost) { cost = quadricError(Qe, p0); p = p0; }
+			if (quadricError(Qe, p1) < cost) { cost = quadricError(Qe, p1); p = p1; }
+
+			c.p = p.cast<float>();
+			c.cost = cost < 0 ? 0 : cost;
+
+			if (foldsOver(vertex, face, adj, c.v0, c.v1, c.p) || foldsOver(vertex, face, adj, c.v1, c.v0, c.p))
+				c.cost = DBL_MAX;
+		}
+		}
+
+		std::sort(edges.begin(), edges.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		// Independent set of the cheapest collapses: the one-rings do not overlap.
+		std::vector<char>	touched(nVertices, 0);
+		VectorXi	parent = VectorXi::LinSpaced(nVertices, 0, nVertices - 1);
+		int nCollapses = 0;
+		int maxCollapses = (nFaces - targetFaces + 1) / 2;	// A collapse removes two faces.
+
+		for (int i = 0; i < nEdges && nCollapses < maxCollapses; i++)
+		{
+			const Collapse&	c = edges[i];
+			if (c.cost == DBL_MAX) break;
+			if (touched[c.v0] || touched[c.v1]) continue;
+
+			for (int v = c.v0; ; v = c.v1)
+			{
+				for (int j = adj.offset(v); j < adj.offset(v + 1); j++)
+					for (int k = 0; k < 3; k++)
+						touched[face(k, adj.corner(j) / 3)] = 1;
+				if (v == c.v1) break;
+			}
+
+			vertex.col(c.v0) = c.p;
+			if (area[c.v0] + area[c.v1] > 0)
+				maxError = std::max(maxError, c.cost / (area[c.v0] + area[c.v1]));
+			Q[c.v0] += Q[c.v1];
+			area[c.v0] += area[c.v1];
+			parent(c.v1) = c.v0;
+			nCollapses++;
+		}
+
+		if (nCollapses == 0) break;
+
+		// Remove the degenerate faces
+		int n = 0;
+		for (int f = 0; f < nFaces; f++)
+		{
+			int a = parent(face(0, f)), b = parent(face(1, f)), c = parent(face(2, f));
+			if (a == b || b == c || c == a) continue;
+
+			face(0, n) = a;	face(1, n) = b;	face(2, n) = c;
+			n++;
+		}
+		face.conservativeResize(3, n);
+	}
+
+	// Remove the unreferenced vertices keeping the order
+	VectorXi	remap = VectorXi::Constant(nVertices, -1);
+	for (int i = 0; i < face.size(); i++) remap(face.data()[i]) = 0;
+
+	int n = 0;
+	for (int v = 0; v < nVertices; v++)
+		if (remap(v) == 0) remap(v) = n++;
+
+	MatrixXf	compact(3, n);
+	for (int v = 0; v < nVertices; v++)
+		if (remap(v) >= 0) compact.col(remap(v)) = vertex.col(v);
+	vertex.swap(compact);
+
+	for (int i = 0; i < face.size(); i++) face.data()[i] = remap(face.data()[i]);
+
+	return float(sqrt(maxError));
+}
+
+void
+buildLODChain(const MatrixXf& vertex, const ArrayXXi& face, std::vector<MeshLOD>& lods, float ratio, int minFaces)
+{
+	lods.clear();
+
+	MeshLOD	lod;
+	lod.vertex = vertex;
+	lod.face = face;
+	lod.error = 0;
+
+	float	error = 0;
+	while (true)
+	{
+		// Normals of the level
+		MatrixXf	faceNormal;
+		VertexFaceAdjacency	adj;
+		computeFaceNormals(lod.vertex, lod.face, faceNormal);
+		buildVertexFaceAdjacency(lod.face, int(lod.vertex.cols()), adj);
+		computeVertexNormals(lod.vertex, lod.face, adj, faceNormal, lod.normal);
+
+		lods.push_back(lod);
+		cout << "LOD " << lods.size() - 1 << ": " << lod.face.cols() << " faces, error " << lod.error << endl;
+
+		int target = int(lod.face.cols() * ratio);
+		if (target < minFaces) break;
+
+		// Simplify the previous level, adding its error to those of the levels before
+		int	nFaces = int(lod.face.cols());
+		error += simplifyMesh(lod.vertex, lod.face, target);
+		lod.error = error;
+
+		if (lod.face.cols() > nFaces * (1 + ratio) / 2) break;	// Hardly simplified any more
+	}
+}
+
+int
+selectLOD(const std::vector<MeshLOD>& lods, float distance, float pixelsPerUnit, float threshold)
+{
+	int level = 0;
+	for (int i = 1; i < int(lods.size()); i++)
+		if (lods[i].error * pixelsPerUnit <= threshold * distance) level = i;
+
+	return level;
+}
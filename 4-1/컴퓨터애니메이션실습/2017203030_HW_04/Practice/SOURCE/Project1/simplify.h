@@ -0,0 +1,34 @@
+#ifndef _SIMPLIFY_H_
+#define _SIMPLIFY_H_
+
+#include <vector>
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+// A level of detail with its estimated error in the object space
+struct MeshLOD
+{
+	MatrixXf	vertex;
+	MatrixXf	normal;
+	ArrayXXi	face;
+
+	float		error;	// RMS distance to the planes merged by the worst collapse, summed over the levels.
+						// An estimate from the quadrics, not a bound on the distance to the original surface
+};
+
+// Quadric error metric simplification (Garland and Heckbert 1997) in parallel rounds:
+// the costs of all the edges are evaluated in parallel, and then an independent set of
+// the cheapest collapses is applied. The boundary vertices are kept.
+// Returns the RMS distance of the worst collapse to its merged planes in the object space.
+float	simplifyMesh(MatrixXf& vertex, ArrayXXi& face, int targetFaces);
+
+// LOD chain from the mesh: each level has about ratio x faces of the previous one.
+void	buildLODChain(const MatrixXf& vertex, const ArrayXXi& face, std::vector<MeshLOD>& lods,
+	float ratio = 0.5f, int minFaces = 128);
+
+// The coarsest level whose error projected to the screen is below the threshold in pixels.
+// pixelsPerUnit is the projection scale at the unit distance, e.g. windowH / (2 tan(fovy/2)).
+int		selectLOD(const std::vector<MeshLOD>& lods, float distance, float pixelsPerUnit, float threshold = 1.0f);
+
+#endif	// _SIMPLIFY_H_
@@ -0,0 +1,301 @@
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS	// snprintf
+#endif
+
+#include "streamMesh.h"
+#include "glShader.h"
+
+#include <GLFW/glfw3.h>
+
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#include <iostream>
+using namespace std;
+
+// Work buffers per face: face, ids, index (3 ints each) and up to 3 local
+// vertices with a position and a normal (6 floats each)
+static const size_t	bytesPerFace = 3 * sizeof(int) * 3 + 3 * 6 * sizeof(float);
+
+StreamingMesh::StreamingMesh()
+{
+	nVertices = 0;
+	nFaces = 0;
+	nEdges = 0;
+
+	stage = STREAM_DONE;
+	cursor = NULL;
+	record = 0;
+	page = 0;
+
+	facesPerPage = 0;
+	peakBytes = 0;
+
+	bbMin.setZero();
+	bbMax.setZero();
+}
+
+bool
+openStreamingMesh(const char* filename, StreamingMesh& sm, size_t memoryBudget)
+{
+	if (!mapFile(filename, sm.off))
+	{
+		cerr << "ERROR: Fail in openStreamingMesh(" << filename << ")" << endl;
+		return false;
+	}
+
+	sm.cursor = parseOFFHeader(sm.off.data, sm.off.size, sm.nVertices, sm.nFaces, sm.nEdges);
+	if (sm.cursor == NULL || sm.nVertices == 0)
+	{
+		unmapFile(sm.off);
+		return false;
+	}
+
+	cout << "# vertices = " << sm.nVertices << endl;
+	cout << "# faces = " << sm.nFaces << endl;
+
+	// Positions and normals of all vertices in a scratch file paged by the OS
+	char	scratchFilename[1024];
+	snprintf(scratchFilename, sizeof(scratchFilename), "%s.tmp", filename);
+	if (!mapScratchFile(scratchFilename, size_t(sm.nVertices) * 6 * sizeof(float), sm.scratch))
+	{
+		cerr << "ERROR: Fail in creating the scratch file " << scratchFilename << endl;
+		unmapFile(sm.off);
+		return false;
+	}
+
+	sm.facesPerPage = int(std::max<size_t>(memoryBudget / bytesPerFace, 1024));
+	sm.stage = STREAM_VERTICES;
+	sm.record = 0;
+	sm.page = 0;
+	sm.peakBytes = 0;
+	sm.bbMin.setConstant(FLT_MAX);
+	sm.bbMax.setConstant(-FLT_MAX);
+
+	cout << "Status: Streaming " << sm.facesPerPage << " faces per page" << endl;
+
+	return true;
+}
+
+static void
+failStreaming(StreamingMesh& sm, const char* message)
+{
+	cerr << "ERROR: " << message << " in the " << sm.record << "-th record" << endl;
+	sm.stage = STREAM_DONE;
+}
+
+// Sorted unique vertices of the page and the triangle indices local to them
+static void
+buildPageVertices(StreamingMesh& sm, int numTris)
+{
+	sm.ids.assign(sm.face.begin(), sm.face.begin() + 3 * numTris);
+	std::sort(sm.ids.begin(), sm.ids.end());
+	sm.ids.erase(std::unique(sm.ids.begin(), sm.ids.end()), sm.ids.end());
+
+	sm.index.resize(3 * numTris);
+	for (int k = 0; k < 3 * numTris; k++)
+		sm.index[k] = GLuint(std::lower_bound(sm.ids.begin(), sm.ids.end(), sm.face[k]) - sm.ids.begin());
+}
+
+// Normalized normal vectors of the page vertices from the scratch file
+static void
+gatherNormals(StreamingMesh& sm)
+{
+	const float*	N = (const float*)sm.scratch.data + 3 * size_t(sm.nVertices);
+
+	sm.normal.resize(3 * sm.ids.size());
+	for (size_t i = 0; i < sm.ids.size(); i++)
+	{
+		const float*	n = N + 3 * size_t(sm.ids[i]);
+		float	l = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (l > 0) l = 1.0f / l;
+
+		for (int k = 0; k < 3; k++)
+			sm.normal[3 * i + k] = n[k] * l;
+	}
+}
+
+// Read the faces of the page starting at the cursor
+static int
+readPageFaces(StreamingMesh& sm, const char*& p, int numTris)
+{
+	const char*	end = sm.off.data + sm.off.size;
+
+	sm.face.resize(3 * numTris);
+	for (int i = 0; i < numTris; i++)
+	{
+		int*	f = &sm.face[3 * i];
+		int		n;
+
+		p = scanFaceRecord(p, end, f, n);
+		if (p == NULL) return i;
+
+		if (f[0] < 0 || f[0] >= sm.nVertices || f[1] < 0 || f[1] >= sm.nVertices || f[2] < 0 || f[2] >= sm.nVertices)
+			return i;
+	}
+
+	return numTris;
+}
+
+static void
+streamVertices(StreamingMesh& sm)
+{
+	const char*	end = sm.off.data + sm.off.size;
+	float*		P = (float*)sm.scratch.data;
+
+	int	last = std::min(sm.record + sm.facesPerPage, sm.nVertices);
+	for (; sm.record < last; sm.record++)
+	{
+		float*	v = P + 3 * size_t(sm.record);
+
+		sm.cursor = scanVertexRecord(sm.cursor, end, v);
+		if (sm.cursor == NULL) { failStreaming(sm, "Malformed vertex"); return; }
+
+		sm.bbMin = sm.bbMin.cwiseMin(Map<Vector3f>(v));
+		sm.bbMax = sm.bbMax.cwiseMax(Map<Vector3f>(v));
+	}
+
+	if (sm.record == sm.nVertices)
+	{
+		sm.stage = (sm.nFaces > 0) ? STREAM_FACES : STREAM_DONE;
+		sm.record = 0;
+	}
+}
+
+static void
+streamFaces(StreamingMesh& sm)
+{
+	const float*	P = (const float*)sm.scratch.data;
+	float*			N = (float*)sm.scratch.data + 3 * size_t(sm.nVertices);
+
+	MeshPage	page;
+	page.begin = sm.cursor;
+
+	int	numTris = std::min(sm.facesPerPage, sm.nFaces - sm.record);
+	if (readPageFaces(sm, sm.cursor, numTris) != numTris) { failStreaming(sm, "Malformed face"); return; }
+	page.end = sm.cursor;
+
+	// Accumulate the face normals: complete only after the last page
+	for (int i = 0; i < numTris; i++)
+	{
+		const int*	f = &sm.face[3 * i];
+		Map<const Vector3f>	p0(P + 3 * size_t(f[0]));
+		Map<const Vector3f>	p1(P + 3 * size_t(f[1]));
+		Map<const Vector3f>	p2(P + 3 * size_t(f[2]));
+
+		Vector3f	v = (p1 - p0).cross(p2 - p0).normalized();
+		for (int k = 0; k < 3; k++)
+			Map<Vector3f>(N + 3 * size_t(f[k])) += v;
+	}
+
+	// Local vertices of the page with provisional normals
+	buildPageVertices(sm, numTris);
+
+	sm.position.resize(3 * sm.ids.size());
+	for (size_t i = 0; i < sm.ids.size(); i++)
+		for (int k = 0; k < 3; k++)
+			sm.position[3 * i + k] = P[3 * size_t(sm.ids[i]) + k];
+
+	gatherNormals(sm);
+
+	// Upload the page
+	page.numVertices = int(sm.ids.size());
+	createVBO(page.vao, page.indexId, page.vertexId, page.normalId);
+	page.numTris = uploadMesh2VBO(numTris, sm.index.data(), page.numVertices, sm.position.data(), sm.normal.data(),
+		page.vao, page.indexId, page.vertexId, page.normalId);
+	sm.pages.push_back(page);
+
+	size_t	bytes = sm.face.capacity() * sizeof(int) + sm.ids.capacity() * sizeof(int) + sm.index.capacity() * sizeof(GLuint)
+		+ (sm.position.capacity() + sm.normal.capacity()) * sizeof(GLfloat);
+	sm.peakBytes = std::max(sm.peakBytes, bytes);
+
+	sm.record += numTris;
+	if (sm.record == sm.nFaces)
+	{
+		sm.stage = STREAM_NORMALS;
+		sm.page = 0;
+	}
+}
+
+// Second pass: the normals are complete, so re-read each page and update its normal buffer.
+static void
+streamNormals(StreamingMesh& sm)
+{
+	MeshPage&	page = sm.pages[sm.page];
+
+	const char*	p = page.begin;
+	readPageFaces(sm, p, page.numTris);
+	buildPageVertices(sm, page.numTris);
+	gatherNormals(sm);
+
+	glBindBuffer(GL_ARRAY_BUFFER, page.normalId);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sm.normal.size() * sizeof(GLfloat), sm.normal.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	isOK("streamNormals()", __FILE__, __LINE__);
+
+	sm.page++;
+	if (sm.page == int(sm.pages.size()))
+	{
+		sm.stage = STREAM_DONE;
+
+		cout << "Status: Streamed " << sm.pages.size() << " pages, peak host memory "
+			<< sm.peakBytes / 1024 << " KB" << endl;
+
+		// Release the files and the work buffers
+		for (size_t i = 0; i < sm.pages.size(); i++)
+			sm.pages[i].begin = sm.pages[i].end = NULL;
+
+		unmapFile(sm.scratch);
+		unmapFile(sm.off);
+
+		std::vector<int>().swap(sm.face);
+		std::vector<int>().swap(sm.ids);
+		std::vector<GLuint>().swap(sm.index);
+		std::vector<GLfloat>().swap(sm.position);
+		std::vector<GLfloat>().swap(sm.normal);
+	}
+}
+
+bool
+streamMesh(StreamingMesh& sm, double timeBudget)
+{
+	double	deadline = glfwGetTime() + timeBudget;
+
+	while (sm.stage != STREAM_DONE)
+	{
+		switch (sm.stage)
+		{
+		case STREAM_VERTICES:	streamVertices(sm);	break;
+		case STREAM_FACES:		streamFaces(sm);	break;
+		case STREAM_NORMALS:	streamNormals(sm);	break;
+		default:	break;
+		}
+
+		if (glfwGetTime() > deadline) break;
+	}
+
+	return sm.stage == STREAM_DONE;
+}
+
+void
+drawStreamingMesh(const StreamingMesh& sm)
+{
+	for (size_t i = 0; i < sm.pages.size(); i++)
+		drawVBO(sm.pages[i].vao, sm.pages[i].numTris);
+}
+
+void
+closeStreamingMesh(StreamingMesh& sm)
+{
+	for (size_t i = 0; i < sm.pages.size(); i++)
+		deleteVBO(sm.pages[i].vao, sm.pages[i].indexId, sm.pages[i].vertexId, sm.pages[i].normalId);
+	sm.pages.clear();
+
+	unmapFile(sm.scratch);
+	unmapFile(sm.off);
+
+	sm.stage = STREAM_DONE;
+}
@@ -0,0 +1,84 @@
+#ifndef _STREAM_MESH_H_
+#define _STREAM_MESH_H_
+
+#include "offReader.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+// Out-of-core mesh viewer: faces are read in fixed-size chunks and
+// uploaded as self-contained VBO pages, so the mesh is drawn while loading.
+//
+// Vertex positions and accumulated normals live in a scratch file mapping
+// paged by the OS. Host memory of the loader is bounded by the budget.
+
+// A page: a chunk of faces with its own local vertices
+struct MeshPage
+{
+	GLuint vao;			// Vertex array object
+	GLuint indexId;		// Buffer for triangle indices
+	GLuint vertexId;	// Buffer for vertex positions
+	GLuint normalId;	// Buffer for normal vectors
+
+	int numTris;		// # of triangles
+	int numVertices;	// # of local vertices
+
+	const char*	begin;	// Face records of the page in the OFF file
+	const char*	end;
+
+	MeshPage() { vao = 0; indexId = 0; vertexId = 0; normalId = 0; numTris = 0; numVertices = 0; begin = NULL; end = NULL; }
+};
+
+enum StreamStage
+{
+	STREAM_VERTICES,	// Vertex positions into the scratch file
+	STREAM_FACES,		// Face pages with provisional normals
+	STREAM_NORMALS,		// Second pass to finalize the normals of the pages
+	STREAM_DONE
+};
+
+struct StreamingMesh
+{
+	MappedFile	off;		// OFF file
+	MappedFile	scratch;	// Positions and normals of all vertices (6 floats per vertex)
+
+	int nVertices, nFaces, nEdges;
+
+	StreamStage	stage;
+	const char*	cursor;		// Next record in the OFF file
+	int			record;		// Next vertex or face
+	int			page;		// Next page in the normal pass
+
+	int		facesPerPage;	// Derived from the memory budget
+	size_t	peakBytes;		// Peak host memory of the work buffers
+
+	Vector3f	bbMin, bbMax;	// Bounding box, valid after the vertex pass
+
+	std::vector<MeshPage>	pages;
+
+	// Work buffers reused for every page
+	std::vector<int>		face;
+	std::vector<int>		ids;		// Sorted unique global vertex indices of the page
+	std::vector<GLuint>		index;		// Local triangle indices
+	std::vector<GLfloat>	position;
+	std::vector<GLfloat>	normal;
+
+	StreamingMesh();
+};
+
+// Open the OFF file and choose the page size from the host memory budget in bytes.
+bool	openStreamingMesh(const char* filename, StreamingMesh& sm, size_t memoryBudget = 64 << 20);
+
+// Proceed with loading for about timeBudget seconds. Returns true when done.
+bool	streamMesh(StreamingMesh& sm, double timeBudget);
+
+// Draw the pages that have arrived so far
+void	drawStreamingMesh(const StreamingMesh& sm);
+
+void	closeStreamingMesh(StreamingMesh& sm);
+
+#endif	// _STREAM_MESH_H_
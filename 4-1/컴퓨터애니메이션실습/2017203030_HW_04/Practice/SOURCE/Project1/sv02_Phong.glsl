@@ -0,0 +1,32 @@
+#version 400
+
+layout (location = 0) in vec3	VertexPosition;
+layout (location = 1) in vec3	VertexNormal;
+
+out vec3	position;
+out vec3	normal;
+
+// Transformation matrices of the object: GLSL employ column-major matrices.
+layout (std140) uniform Object
+{
+	mat4	ModelViewMatrix;
+	mat4	ModelViewProjectionMatrix;
+	mat3	NormalMatrix;	// Transpose of the inverse of modelViewMatrix
+};
+
+// Dequantization uniforms and decodeOctahedral()
+#include "sv04_quantization.glsl"
+
+void
+main(void)
+{
+	// Dequantization
+	vec3	vertexPosition = PositionOffset + PositionScale * VertexPosition;
+	vec3	vertexNormal = OctahedralNormal ? decodeOctahedral(VertexNormal.xy) : VertexNormal;
+
+	gl_Position = ModelViewProjectionMatrix * vec4(vertexPosition, 1.0);
+
+	// View coordinate system
+	position = vec3(ModelViewMatrix * vec4(vertexPosition, 1.0));
+	normal = normalize(NormalMatrix * vertexNormal);
+}
\ No newline at end of file
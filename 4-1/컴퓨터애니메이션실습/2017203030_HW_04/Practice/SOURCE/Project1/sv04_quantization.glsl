@@ -0,0 +1,13 @@
+// Dequantization of the compressed vertex format: the identity by default.
+// Spliced into the vertex shaders by readShader() at #include "sv04_quantization.glsl".
+uniform vec3	PositionOffset = vec3(0.0);
+uniform vec3	PositionScale = vec3(1.0);
+uniform bool	OctahedralNormal = false;	// VertexNormal.xy in the octahedral encoding
+
+vec3
+decodeOctahedral(vec2 e)
+{
+	vec3	n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
\ No newline at end of file
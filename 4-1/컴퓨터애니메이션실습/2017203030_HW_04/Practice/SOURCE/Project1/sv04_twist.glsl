@@ -6,10 +6,16 @@ layout (location = 1) in vec3	VertexNormal;
 out vec3	position;
 out vec3	normal;
 
-// Transformation matrices: GLSL employ column-major matrices.
-uniform mat4	ModelViewProjectionMatrix;
-uniform mat4	ModelViewMatrix;
-uniform mat3	NormalMatrix;	// Transpose of the inverse of modelViewMatrix
+// Transformation matrices of the object: GLSL employ column-major matrices.
+layout (std140) uniform Object
+{
+	mat4	ModelViewMatrix;
+	mat4	ModelViewProjectionMatrix;
+	mat3	NormalMatrix;	// Transpose of the inverse of modelViewMatrix
+};
+
+// Dequantization uniforms and decodeOctahedral()
+#include "sv04_quantization.glsl"
 
 // Twisting
 uniform float	twisting = 0.0;
@@ -17,20 +23,24 @@ uniform float	twisting = 0.0;
 void
 main(void)
 {
+	// Dequantization
+	vec3	vertexPosition = PositionOffset + PositionScale * VertexPosition;
+	vec3	vertexNormal = OctahedralNormal ? decodeOctahedral(VertexNormal.xy) : VertexNormal;
+
 	// The twisting angle is proportional to the distance from the origin.
-	float	angle = twisting * length(VertexPosition.xy);
+	float	angle = twisting * length(vertexPosition.xy);
 	float	cosLength = cos(angle);
 	float	sinLength = sin(angle);
 
 	// New position due to twisting
-	float	x = cosLength * VertexPosition.x - sinLength * VertexPosition.y;
-	float	y = sinLength * VertexPosition.x + cosLength * VertexPosition.y;
-	vec4	newVertexPosition = vec4(x, y, VertexPosition.z, 1.0);
+	float	x = cosLength * vertexPosition.x - sinLength * vertexPosition.y;
+	float	y = sinLength * vertexPosition.x + cosLength * vertexPosition.y;
+	vec4	newVertexPosition = vec4(x, y, vertexPosition.z, 1.0);
 
 	// New normal due to twisting
-	x = cosLength * VertexNormal.x - sinLength * VertexNormal.y;
-	y = sinLength * VertexNormal.x + cosLength * VertexNormal.y;
-	vec3	newVertexNormal = vec3(x, y, VertexNormal.z);
+	x = cosLength * vertexNormal.x - sinLength * vertexNormal.y;
+	y = sinLength * vertexNormal.x + cosLength * vertexNormal.y;
+	vec3	newVertexNormal = vec3(x, y, vertexNormal.z);
 
 	// Position for the rasterization
 	gl_Position = ModelViewProjectionMatrix * newVertexPosition;
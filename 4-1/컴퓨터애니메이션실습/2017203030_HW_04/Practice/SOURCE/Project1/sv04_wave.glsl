@@ -6,10 +6,16 @@ layout (location = 1) in vec3	VertexNormal;
 out vec3	position;
 out vec3	normal;
 
-// Transformation matrices: GLSL employ column-major matrices.
-uniform mat4	ModelViewProjectionMatrix;
-uniform mat4	ModelViewMatrix;
-uniform mat3	NormalMatrix;	// Transpose of the inverse of modelViewMatrix
+// Transformation matrices of the object: GLSL employ column-major matrices.
+layout (std140) uniform Object
+{
+	mat4	ModelViewMatrix;
+	mat4	ModelViewProjectionMatrix;
+	mat3	NormalMatrix;	// Transpose of the inverse of modelViewMatrix
+};
+
+// Dequantization uniforms and decodeOctahedral()
+#include "sv04_quantization.glsl"
 
 uniform float	A = 0.03;
 uniform float	F = 40.0;
@@ -18,22 +24,26 @@ uniform float	phase = 0.0;
 void
 main(void)
 {
+	// Dequantization
+	vec3	vertexPosition = PositionOffset + PositionScale * VertexPosition;
+	vec3	vertexNormal = OctahedralNormal ? decodeOctahedral(VertexNormal.xy) : VertexNormal;
+
 	// Vertex position
-	float	l = length(VertexPosition.xy);
-	float	z = VertexPosition.z + A * sin(F * l + phase);
-	vec4	newVertexPosition = vec4(VertexPosition.xy, z, 1.0);
+	float	l = length(vertexPosition.xy);
+	float	z = vertexPosition.z + A * sin(F * l + phase);
+	vec4	newVertexPosition = vec4(vertexPosition.xy, z, 1.0);
 
 	// Jacobian of the wave deformation
 	float	eps = 0.0001;
 	mat3	Jt;
 	Jt[0][0] = 1; Jt[0][1] = 0; Jt[0][2] = 0;
 	Jt[1][0] = 0; Jt[1][1] = 1; Jt[1][2] = 0;
-	Jt[2][0] = A * cos(F * l + phase) * F * VertexPosition.x / (l + eps);
-	Jt[2][1] = A * cos(F * l + phase) * F * VertexPosition.y / (l + eps);
+	Jt[2][0] = A * cos(F * l + phase) * F * vertexPosition.x / (l + eps);
+	Jt[2][1] = A * cos(F * l + phase) * F * vertexPosition.y / (l + eps);
 	Jt[2][2] = 1;
 
 	// Inverse transpose of the Jacobian matrix (already transposed)
-	vec3	newVertexNormal = inverse(Jt) * VertexNormal;
+	vec3	newVertexNormal = inverse(Jt) * vertexNormal;
 
 	// Position for the rasterization
 	gl_Position = ModelViewProjectionMatrix * newVertexPosition;
@@ -0,0 +1,91 @@
+#include "vertexNormal.h"
+
+#include <math.h>
+
+void
+buildVertexFaceAdjacency(const Ref<const ArrayXXi>& face, int nVertices, VertexFaceAdjacency& adj)
+{
+	int nFaces = int(face.cols());
+
+	// Count the corners of each vertex
+	adj.offset.setZero(nVertices + 1);
+	for (int i = 0; i < nFaces; i++)
+		for (int k = 0; k < 3; k++)
+			adj.offset(face(k, i) + 1)++;
+
+	// Prefix sum
+	for (int i = 0; i < nVertices; i++)
+		adj.offset(i + 1) += adj.offset(i);
+
+	// Scatter the corners: faces stay in the increasing order for each vertex.
+	VectorXi	next = adj.offset.head(nVertices);
+
+	adj.corner.resize(3 * nFaces);
+	for (int i = 0; i < nFaces; i++)
+		for (int k = 0; k < 3; k++)
+			adj.corner(next(face(k, i))++) = 3 * i + k;
+}
+
+void
+computeFaceNormals(const Ref<const MatrixXf>& vertex, const Ref<const ArrayXXi>& face, Ref<MatrixXf> faceNormal)
+{
+	int nFaces = int(face.cols());
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < nFaces; i++)
+	{
+		Vector3f	v1 = vertex.col(face(1, i)) - vertex.col(face(0, i));
+		Vector3f	v2 = vertex.col(face(2, i)) - vertex.col(face(0, i));
+		faceNormal.col(i) = v1.cross(v2).normalized();
+	}
+}
+
+void
+computeFaceNormals(const Ref<const MatrixXf>& vertex, const Ref<const ArrayXXi>& face, MatrixXf& faceNormal)
+{
+	faceNormal.resize(3, face.cols());
+	computeFaceNormals(vertex, face, Ref<MatrixXf>(faceNormal));
+}
+
+// Interior angle at the k-th corner of the face f
+static inline float
+cornerAngle(const Ref<const MatrixXf>& vertex, const Ref<const ArrayXXi>& face, int f, int k)
+{
+	Vector3f	p = vertex.col(face(k, f));
+	Vector3f	e1 = vertex.col(face((k + 1) % 3, f)) - p;
+	Vector3f	e2 = vertex.col(face((k + 2) % 3, f)) - p;
+
+	return atan2f(e1.cross(e2).norm(), e1.dot(e2));
+}
+
+void
+computeVertexNormals(const Ref<const MatrixXf>& vertex, const Ref<const ArrayXXi>& face, const VertexFaceAdjacency& adj,
+	const Ref<const MatrixXf>& faceNormal, Ref<MatrixXf> normal, bool angleWeighted)
+{
+	int nVertices = int(adj.offset.size()) - 1;
+
+	// Each vertex owns its column, so no synchronization is needed.
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < nVertices; i++)
+	{
+		Vector3f	n = Vector3f::Zero();
+
+		for (int j = adj.offset(i); j < adj.offset(i + 1); j++)
+		{
+			int f = adj.corner(j) / 3;
+
+			if (angleWeighted)	n += cornerAngle(vertex, face, f, adj.corner(j) % 3) * faceNormal.col(f);
+			else				n += faceNormal.col(f);
+		}
+
+		normal.col(i) = n.normalized();
+	}
+}
+
+void
+computeVertexNormals(const Ref<const MatrixXf>& vertex, const Ref<const ArrayXXi>& face, const VertexFaceAdjacency& adj,
+	const Ref<const MatrixXf>& faceNormal, MatrixXf& normal, bool angleWeighted)
+{
+	normal.resize(3, adj.offset.size() - 1);
+	computeVertexNormals(vertex, face, adj, faceNormal, Ref<MatrixXf>(normal), angleWeighted);
+}
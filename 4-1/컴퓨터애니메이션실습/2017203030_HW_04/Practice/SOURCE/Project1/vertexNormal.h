@@ -0,0 +1,34 @@
+#ifndef _VERTEX_NORMAL_H_
+#define _VERTEX_NORMAL_H_
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+// Vertex-to-face adjacency in the compressed sparse row (CSR) format.
+// The corners of the vertex i are corner(offset(i)) ... corner(offset(i+1) - 1),
+// where a corner 3 * f + k is the k-th vertex of the face f.
+struct VertexFaceAdjacency
+{
+	VectorXi	offset;		// nVertices + 1
+	VectorXi	corner;		// 3 * nFaces, in the increasing order of faces
+};
+
+// The inputs are Ref<> so that the matrices and the Map<> views of other storage,
+// e.g. ArenaMesh, are taken without a copy. The Ref<MatrixXf> outputs must be sized.
+
+// Build once per connectivity: O(n) counting sort
+void	buildVertexFaceAdjacency(const Ref<const ArrayXXi>& face, int nVertices, VertexFaceAdjacency& adj);
+
+// Unit normal vectors of the faces, in parallel
+void	computeFaceNormals(const Ref<const MatrixXf>& vertex, const Ref<const ArrayXXi>& face, Ref<MatrixXf> faceNormal);
+void	computeFaceNormals(const Ref<const MatrixXf>& vertex, const Ref<const ArrayXXi>& face, MatrixXf& faceNormal);
+
+// Unit normal vectors of the vertices gathered from the adjacent faces, in parallel and
+// without atomics. The face normals are averaged equally, or weighted by the corner angles.
+// Cheap enough to call every frame on deformed positions.
+void	computeVertexNormals(const Ref<const MatrixXf>& vertex, const Ref<const ArrayXXi>& face, const VertexFaceAdjacency& adj,
+	const Ref<const MatrixXf>& faceNormal, Ref<MatrixXf> normal, bool angleWeighted = false);
+void	computeVertexNormals(const Ref<const MatrixXf>& vertex, const Ref<const ArrayXXi>& face, const VertexFaceAdjacency& adj,
+	const Ref<const MatrixXf>& faceNormal, MatrixXf& normal, bool angleWeighted = false);
+
+#endif	// _VERTEX_NORMAL_H_
@@ -0,0 +1,273 @@
+#include "weld.h"
+
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <iostream>
+using namespace std;
+
+// Sort the chunks in parallel and then merge them pairwise in parallel rounds
+template<class T, class Less>
+static void
+parallelSort(std::vector<T>& a, Less less)
+{
+	int	nChunks = 1;
+#ifdef _OPENMP
+	nChunks = omp_get_max_threads();
+#endif
+	if (nChunks == 1 || a.size() < 65536) { std::sort(a.begin(), a.end(), less); return; }
+
+	std::vector<size_t>	bound(nChunks + 1);
+	for (int i = 0; i <= nChunks; i++)
+		bound[i] = a.size() * i / nChunks;
+
+#pragma omp parallel for schedule(static, 1)
+	for (int i = 0; i < nChunks; i++)
+		std::sort(a.begin() + bound[i], a.begin() + bound[i + 1], less);
+
+	for (int width = 1; width < nChunks; width *= 2)
+	{
+#pragma omp parallel for schedule(static, 1)
+		for (int i = 0; i < nChunks - width; i += 2 * width)
+		{
+			int j = std::min(i + 2 * width, nChunks);
+			std::inplace_merge(a.begin() + bound[i], a.begin() + bound[i + width], a.begin() + bound[j], less);
+		}
+	}
+}
+
+struct FaceEntry
+{
+	int	a, b, c;	// Rotated so that a is the smallest, keeping the orientation
+	int	f;
+
+	bool operator<(const FaceEntry& e) const
+	{
+		if (a != e.a) return a < e.a;
+		if (b != e.b) return b < e.b;
+		if (c != e.c) return c < e.c;
+		return f < e.f;
+	}
+};
+
+static const int		cellBits = 21;
+static const uint64_t	cellMask = (uint64_t(1) << cellBits) - 1;
+
+static inline uint64_t
+cellKey(int64_t x, int64_t y, int64_t z)
+{
+	return (uint64_t(x) << (2 * cellBits)) | (uint64_t(y) << cellBits) | uint64_t(z);
+}
+
+static inline uint64_t
+hashKey(uint64_t k)
+{
+	k ^= k >> 33;	k *= 0xff51afd7ed558ccdULL;	k ^= k >> 33;
+	return k;
+}
+
+// Representative of each vertex: the smallest index within the tolerance.
+// The spatial hash is a counting sort of the vertices by the hashed grid cells,
+// so a bucket lists its vertices in the increasing order of indices.
+static void
+findRepresentatives(const Ref<const MatrixXf>& vertex, float tolerance, VectorXi& rep)
+{
+	int nVertices = int(vertex.cols());
+
+	Vector3f	bbMin = vertex.rowwise().minCoeff();
+	Vector3f	bbMax = vertex.rowwise().maxCoeff();
+
+	// Cells much larger than the tolerance: a ball rarely overlaps the neighbor cells.
+	float	cell = std::max(16 * tolerance, (bbMax - bbMin).maxCoeff() / float(cellMask - 1));
+	if (cell <= 0) cell = 1;
+
+	uint64_t	nBuckets = 16;
+	while (nBuckets < uint64_t(nVertices)) nBuckets *= 2;
+	uint64_t	mask = nBuckets - 1;
+
+	std::vector<uint64_t>	key(nVertices);
+	std::vector<int>		bucket(nVertices);
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < nVertices; i++)
+	{
+		Vector3f	c = (vertex.col(i) - bbMin) / cell;
+		key[i] = cellKey(int64_t(c.x()), int64_t(c.y()), int64_t(c.z()));
+		bucket[i] = int(hashKey(key[i]) & mask);
+	}
+
+	// Counting sort by the buckets, stable
+	std::vector<int>	offset(nBuckets + 1, 0);
+	for (int i = 0; i < nVertices; i++)
+		offset[bucket[i] + 1]++;
+	for (uint64_t b = 0; b < nBuckets; b++)
+		offset[b + 1] += offset[b];
+
+	std::vector<int>	sorted(nVertices);
+	{
+		std::vector<int>	cursor(offset.begin(), offset.end() - 1);
+		for (int i = 0; i < nVertices; i++)
+			sorted[cursor[bucket[i]]++] = i;
+	}
+
+	rep.resize(nVertices);
+	float	tolerance2 = tolerance * tolerance;
+
+#pragma omp parallel for schedule(dynamic, 4096)
+	for (int i = 0; i < nVertices; i++)
+	{
+		Vector3f	p = vertex.col(i);
+		Vector3f	lo = (p - bbMin).array() - tolerance;
+		Vector3f	hi = (p - bbMin).array() + tolerance;
+
+		int64_t	x0 = std::max<int64_t>(int64_t(floorf(lo.x() / cell)), 0), x1 = int64_t(hi.x() / cell);
+		int64_t	y0 = std::max<int64_t>(int64_t(floorf(lo.y() / cell)), 0), y1 = int64_t(hi.y() / cell);
+		int64_t	z0 = std::max<int64_t>(int64_t(floorf(lo.z() / cell)), 0), z1 = int64_t(hi.z() / cell);
+
+		int	r = i;
+		for (int64_t x = x0; x <= x1; x++)
+			for (int64_t y = y0; y <= y1; y++)
+				for (int64_t z = z0; z <= z1; z++)
+				{
+					uint64_t	k = cellKey(x, y, z);
+					uint64_t	b = hashKey(k) & mask;
+
+					// Vertices of the bucket smaller than the current one
+					for (int j = offset[b]; j < offset[b + 1] && sorted[j] < r; j++)
+					{
+						int v = sorted[j];
+						if (key[v] == k && (vertex.col(v) - p).squaredNorm() <= tolerance2) { r = v; break; }
+					}
+				}
+
+		rep(i) = r;
+	}
+
+	// Follow the chains: rep(i) <= i is final when i is visited.
+	for (int i = 0; i < nVertices; i++)
+		rep(i) = rep(rep(i));
+}
+
+bool
+weldMeshInPlace(Ref<MatrixXf> vertex, Ref<ArrayXXi> face, float tolerance, int& nVertices, int& nFaces, WeldStats& stats)
+{
+	nVertices = int(vertex.cols());
+	nFaces = int(face.cols());
+
+	stats = WeldStats();
+	if (nVertices == 0) return false;
+
+	// Merge the vertices
+	VectorXi	rep;
+	findRepresentatives(vertex, tolerance, rep);
+
+	VectorXi	remap(nVertices);
+	int n = 0;
+	for (int i = 0; i < nVertices; i++)
+	{
+		if (rep(i) == i)
+		{
+			if (n < i) vertex.col(n) = vertex.col(i);
+			remap(i) = n++;
+		}
+		else remap(i) = remap(rep(i));
+	}
+	stats.nMergedVertices = nVertices - n;
+
+	// Remap the faces rotated canonically
+	std::vector<FaceEntry>	entry(nFaces);
+
+#pragma omp parallel for schedule(static)
+	for (int f = 0; f < nFaces; f++)
+	{
+		int a = remap(face(0, f)), b = remap(face(1, f)), c = remap(face(2, f));
+
+		FaceEntry&	e = entry[f];
+		e.f = f;
+		if (a == b || b == c || c == a)	{ e.a = e.b = e.c = -1; continue; }	// Degenerate
+
+		if (a < b && a < c)	{ e.a = a; e.b = b; e.c = c; }
+		else if (b < c)		{ e.a = b; e.b = c; e.c = a; }
+		else				{ e.a = c; e.b = a; e.c = b; }
+	}
+
+	parallelSort(entry, std::less<FaceEntry>());
+
+	// Keep the first of the same faces in the original order
+	std::vector<char>	keep(nFaces, 0);
+	for (int i = 0; i < nFaces; i++)
+	{
+		const FaceEntry&	e = entry[i];
+		if (e.a < 0)	{ stats.nDegenerateFaces++; continue; }
+		if (i > 0 && e.a == entry[i - 1].a && e.b == entry[i - 1].b && e.c == entry[i - 1].c)
+		{
+			stats.nDuplicateFaces++;
+			continue;
+		}
+		keep[e.f] = 1;
+	}
+
+	int m = 0;
+	for (int f = 0; f < nFaces; f++)
+		if (keep[f])
+		{
+			for (int k = 0; k < 3; k++)
+				face(k, m) = remap(face(k, f));
+			m++;
+		}
+	stats.bytesSaved = size_t(stats.nMergedVertices) * 6 * sizeof(float) + size_t(nFaces - m) * 3 * sizeof(int);
+
+	bool	changed = stats.nMergedVertices > 0 || m < nFaces;
+	nVertices = n;
+	nFaces = m;
+
+	return changed;
+}
+
+bool
+weldMeshInPlace(Ref<MatrixXf> vertex, Ref<ArrayXXi> face, int& nVertices, int& nFaces, float relativeTolerance)
+{
+	nVertices = int(vertex.cols());
+	nFaces = int(face.cols());
+	if (nVertices == 0) return false;
+
+	float	diagonal = (vertex.rowwise().maxCoeff() - vertex.rowwise().minCoeff()).norm();
+
+	WeldStats	stats;
+	if (!weldMeshInPlace(vertex, face, relativeTolerance * diagonal, nVertices, nFaces, stats)) return false;
+
+	cout << "Status: Welded " << stats.nMergedVertices << " vertices, removed " << stats.nDegenerateFaces << " degenerate and "
+		<< stats.nDuplicateFaces << " duplicate faces, saved " << stats.bytesSaved / 1024 << " KB" << endl;
+
+	return true;
+}
+
+bool
+weldMesh(MatrixXf& vertex, ArrayXXi& face, float tolerance, WeldStats& stats)
+{
+	int nVertices, nFaces;
+	bool	changed = weldMeshInPlace(vertex, face, tolerance, nVertices, nFaces, stats);
+
+	vertex.conservativeResize(3, nVertices);
+	face.conservativeResize(3, nFaces);
+
+	return changed;
+}
+
+bool
+weldMesh(MatrixXf& vertex, ArrayXXi& face, float relativeTolerance)
+{
+	int nVertices, nFaces;
+	bool	changed = weldMeshInPlace(vertex, face, nVertices, nFaces, relativeTolerance);
+
+	vertex.conservativeResize(3, nVertices);
+	face.conservativeResize(3, nFaces);
+
+	return changed;
+}
@@ -0,0 +1,32 @@
+#ifndef _WELD_H_
+#define _WELD_H_
+
+#include <stddef.h>
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+struct WeldStats
+{
+	int		nMergedVertices;	// Coincident vertices merged into others
+	int		nDegenerateFaces;	// Faces collapsed by the merge or with repeated indices
+	int		nDuplicateFaces;	// Same vertices in the same orientation as an earlier face
+	size_t	bytesSaved;			// Positions, normals and indices
+
+	WeldStats() { nMergedVertices = 0; nDegenerateFaces = 0; nDuplicateFaces = 0; bytesSaved = 0; }
+};
+
+// Merge the vertices closer than the tolerance into the one with the smallest index,
+// found in parallel with a spatial hash of the grid cells.
+// Then remove the degenerate and duplicate faces. Returns true if anything changed.
+bool	weldMesh(MatrixXf& vertex, ArrayXXi& face, float tolerance, WeldStats& stats);
+
+// Tolerance relative to the diagonal of the bounding box, with the report
+bool	weldMesh(MatrixXf& vertex, ArrayXXi& face, float relativeTolerance = 1e-6f);
+
+// In place for the fixed storage, e.g. ArenaMesh: the vertices and faces left are
+// moved to the leading columns and their numbers returned in nVertices and nFaces.
+bool	weldMeshInPlace(Ref<MatrixXf> vertex, Ref<ArrayXXi> face, float tolerance, int& nVertices, int& nFaces, WeldStats& stats);
+bool	weldMeshInPlace(Ref<MatrixXf> vertex, Ref<ArrayXXi> face, int& nVertices, int& nFaces, float relativeTolerance = 1e-6f);
+
+#endif	// _WELD_H_
@@ -0,0 +1,78 @@
+#include "assetLoader.h"
+#include "mesh.h"
+
+#include <chrono>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <iostream>
+using namespace std;
+
+// Worker: no GL calls here
+static bool
+parseMeshAsset(MeshAsset* asset)
+{
+#ifdef _OPENMP
+	// Parse in parallel with one core less than the machine, left to the render thread
+	int	nThreads = omp_get_num_procs() - 1;
+	omp_set_num_threads(nThreads > 1 ? nThreads : 1);
+#endif
+
+	readMesh(asset->filename, asset->vertex, asset->normal, asset->face);
+	if (asset->face.cols() == 0)
+	{
+		cerr << "ERROR: Fail in loading " << asset->filename << endl;
+		return false;
+	}
+
+	return true;
+}
+
+void
+loadMeshAsync(const char* filename, MeshAsset& asset)
+{
+	asset.filename = filename;
+	asset.state = ASSET_LOADING;
+	asset.worker = std::async(std::launch::async, parseMeshAsset, &asset);
+}
+
+bool
+pollMeshAsset(MeshAsset& asset)
+{
+	if (asset.state == ASSET_LOADING && asset.worker.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		asset.state = asset.worker.get() ? ASSET_PARSED : ASSET_FAILED;
+
+	return asset.state == ASSET_PARSED;
+}
+
+void
+takeMeshAsset(MeshAsset& asset, MatrixXf& vertex, MatrixXf& normal, ArrayXXi& face)
+{
+	vertex.swap(asset.vertex);
+	normal.swap(asset.normal);
+	face.swap(asset.face);
+
+	asset.vertex.resize(3, 0);
+	asset.normal.resize(3, 0);
+	asset.face.resize(3, 0);
+
+	if (asset.state == ASSET_PARSED) asset.state = ASSET_READY;
+}
+
+void
+createPlaceholderMesh(MatrixXf& vertex, MatrixXf& normal, ArrayXXi& face)
+{
+	vertex.resize(3, 6);
+	vertex <<	1, -1, 0,  0, 0,  0,
+				0,  0, 1, -1, 0,  0,
+				0,  0, 0,  0, 1, -1;
+	normal = vertex;
+
+	// Counterclockwise from the outside
+	face.resize(3, 8);
+	face <<	0, 2, 1, 3, 2, 0, 3, 1,
+			2, 1, 3, 0, 0, 3, 1, 2,
+			4, 4, 4, 4, 5, 5, 5, 5;
+}
@@ -1,4 +1,5 @@
 #include "glSetup.h"
+#include "assetLoader.h"
 #include "mesh.h"
 
 #include <Eigen/Dense>
@@ -17,6 +18,7 @@ void init(const char * filename);
 void setupLight();
 
 void update();
+void serviceMeshAsset();
 void render(GLFWwindow* window);
 void reshape(GLFWwindow* window, int w, int h);
 void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -68,8 +70,9 @@ int main(int argc, char* argv[])
 	while (!glfwWindowShouldClose(window)){
 		if (!pause) 
 			update();
+		serviceMeshAsset();
 		render(window); 
-		glfwSwapBuffers(window); 
+		swapBuffers(window); 
 		glfwPollEvents();
 	}
 
@@ -89,10 +92,17 @@ Matrix3f R, Rn;
 Quaternionf q;
 Vector3f axis;
 
+// Mesh parsed in the background, the placeholder drawn until then
+MeshAsset	meshAsset;
+double		loadStart = 0;
+
 void init(const char * filename)
 {
 	cout << "Reading" << filename << endl;
-	readMesh(filename, vertexO, normalO, face);
+	loadStart = glfwGetTime();
+	loadMeshAsync(filename, meshAsset);
+
+	createPlaceholderMesh(vertexO, normalO, face);
 	vertexR = vertexQ = vertexO;
 	normalR = normalQ = normalO;
 
@@ -114,6 +124,18 @@ void init(const char * filename)
 	cout << "Keyboard input: x for axes on/off"<< endl;
  }
 
+// The mesh parsed by the worker replaces the placeholder
+void serviceMeshAsset()
+{
+	if (!pollMeshAsset(meshAsset)) return;
+
+	takeMeshAsset(meshAsset, vertexO, normalO, face);
+	vertexR = vertexQ = vertexO;
+	normalR = normalQ = normalO;
+
+	cout << "Status: " << meshAsset.filename << " loaded in " << (glfwGetTime() - loadStart) * 1000.0 << " ms" << endl;
+}
+
 void basicRotation(){
 	float angleInc = float(M_PI) / 1200; // In radian 156
 		
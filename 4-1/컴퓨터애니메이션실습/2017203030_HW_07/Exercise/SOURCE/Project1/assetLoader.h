@@ -0,0 +1,47 @@
+#ifndef _ASSET_LOADER_H_
+#define _ASSET_LOADER_H_
+
+#include <future>
+
+#include <Eigen/Dense>
+using namespace Eigen;
+
+// Background loading: the mesh file is parsed and its normals computed on a worker
+// thread with a future, and the main thread takes the arrays when they are ready.
+// A placeholder mesh is drawn until then, so the window opens at once.
+
+enum AssetState
+{
+	ASSET_EMPTY,
+	ASSET_LOADING,	// Worker running
+	ASSET_PARSED,	// Host data ready for the upload
+	ASSET_READY,	// Taken by the main thread
+	ASSET_FAILED
+};
+
+struct MeshAsset
+{
+	const char*			filename;
+	AssetState			state;
+	std::future<bool>	worker;
+
+	MatrixXf	vertex;
+	MatrixXf	normal;
+	ArrayXXi	face;
+
+	MeshAsset() { filename = NULL; state = ASSET_EMPTY; }
+};
+
+// Start readMesh() on a worker
+void	loadMeshAsync(const char* filename, MeshAsset& asset);
+
+// Non-blocking check of the worker. Returns true when the asset is parsed.
+bool	pollMeshAsset(MeshAsset& asset);
+
+// Move the parsed arrays out of the asset
+void	takeMeshAsset(MeshAsset& asset, MatrixXf& vertex, MatrixXf& normal, ArrayXXi& face);
+
+// Octahedron of the unit radius with the vertex normals, drawn while loading
+void	createPlaceholderMesh(MatrixXf& vertex, MatrixXf& normal, ArrayXXi& face);
+
+#endif	// _ASSET_LOADER_H_
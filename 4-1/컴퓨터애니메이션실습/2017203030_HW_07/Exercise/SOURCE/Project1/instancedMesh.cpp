@@ -0,0 +1,117 @@
+#include "instancedMesh.h"
+#include "glShader.h"
+
+#include <stddef.h>		// offsetof
+
+#include <iostream>
+using namespace std;
+
+// Attribute locations in sv07_instanced.glsl
+static const GLuint	positionLocation = 0;
+static const GLuint	normalLocation = 1;
+static const GLuint	matrixLocation = 2;		// 4 columns in 2, 3, 4 and 5
+static const GLuint	colorLocation = 6;
+
+bool
+createInstancedMesh(const char* vertexShaderFile, const char* fragmentShaderFile, InstancedMesh& im)
+{
+	im.supported = false;
+	if (!GLEW_VERSION_3_3)
+	{
+		cerr << "Status: No instanced arrays, drawing the copies one by one" << endl;
+		return false;
+	}
+
+	createShaders(vertexShaderFile, fragmentShaderFile, im.program, im.vertexShader, im.fragmentShader);
+
+	GLint	linked = GL_FALSE;
+	glGetProgramiv(im.program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		cerr << "ERROR: Fail in linking " << vertexShaderFile << " and " << fragmentShaderFile << endl;
+		deleteShaders(im.program, im.vertexShader, im.fragmentShader);
+		im.program = im.vertexShader = im.fragmentShader = 0;
+		return false;
+	}
+
+	glGenBuffers(1, &im.instanceId);
+
+	im.supported = isOK("createInstancedMesh()", __FILE__, __LINE__, false);
+	return im.supported;
+}
+
+void
+uploadInstances(InstancedMesh& im, int numInstances, const InstanceData* instance)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, im.instanceId);
+
+	// Grow geometrically, and orphan the old storage to avoid waiting for the previous frame
+	if (numInstances > im.capacity)
+		im.capacity = (numInstances > 2 * im.capacity) ? numInstances : 2 * im.capacity;
+	glBufferData(GL_ARRAY_BUFFER, im.capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, numInstances * sizeof(InstanceData), instance);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	im.numInstances = numInstances;
+}
+
+void
+drawInstances(const InstancedMesh& im, const MeshVBO& vbo, int first, int count)
+{
+	if (count <= 0) return;
+
+	glUseProgram(im.program);
+
+	// Per-vertex attributes
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.vertexId);
+	glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(positionLocation);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.normalId);
+	glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(normalLocation);
+
+	// Per-instance attributes advancing once per copy from the first instance
+	glBindBuffer(GL_ARRAY_BUFFER, im.instanceId);
+	size_t	base = first * sizeof(InstanceData);
+	for (GLuint k = 0; k < 4; k++)
+	{
+		glVertexAttribPointer(matrixLocation + k, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(const void*)(base + offsetof(InstanceData, transform) + 4 * k * sizeof(GLfloat)));
+		glVertexAttribDivisor(matrixLocation + k, 1);
+		glEnableVertexAttribArray(matrixLocation + k);
+	}
+	glVertexAttribPointer(colorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+		(const void*)(base + offsetof(InstanceData, color)));
+	glVertexAttribDivisor(colorLocation, 1);
+	glEnableVertexAttribArray(colorLocation);
+
+	// All the copies in one call
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo.indexId);
+	glDrawElementsInstanced(GL_TRIANGLES, 3 * vbo.numTris, GL_UNSIGNED_INT, 0, count);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	// Restore the state for the fixed-function drawing
+	for (GLuint k = 0; k < 4; k++)
+	{
+		glVertexAttribDivisor(matrixLocation + k, 0);
+		glDisableVertexAttribArray(matrixLocation + k);
+	}
+	glVertexAttribDivisor(colorLocation, 0);
+	glDisableVertexAttribArray(colorLocation);
+	glDisableVertexAttribArray(normalLocation);
+	glDisableVertexAttribArray(positionLocation);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glUseProgram(0);
+}
+
+void
+deleteInstancedMesh(InstancedMesh& im)
+{
+	if (im.instanceId) glDeleteBuffers(1, &im.instanceId);
+	if (im.program) deleteShaders(im.program, im.vertexShader, im.fragmentShader);
+
+	im = InstancedMesh();
+}
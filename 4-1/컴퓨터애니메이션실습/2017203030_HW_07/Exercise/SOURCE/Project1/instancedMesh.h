@@ -0,0 +1,44 @@
+#ifndef _INSTANCED_MESH_H_
+#define _INSTANCED_MESH_H_
+
+#include "meshVBO.h"
+
+// Hardware instancing of a retained mesh: the transforms and colors of all the
+// copies are uploaded once per frame into one buffer, and each range of copies
+// is drawn with a single glDrawElementsInstanced() call.
+
+// Per-instance attributes, 80 bytes
+struct InstanceData
+{
+	GLfloat	transform[16];	// Column-major 4 x 4 transform
+	GLfloat	color[4];		// Diffuse color
+};
+
+struct InstancedMesh
+{
+	GLuint	program;
+	GLuint	vertexShader;
+	GLuint	fragmentShader;
+
+	GLuint	instanceId;		// Buffer for the per-instance attributes
+	int		capacity;		// # instances allocated in the buffer
+	int		numInstances;	// # instances uploaded for the current frame
+
+	bool	supported;		// GL 3.3 instanced arrays and the shaders are available
+
+	InstancedMesh() { program = 0; vertexShader = 0; fragmentShader = 0; instanceId = 0; capacity = 0; numInstances = 0; supported = false; }
+};
+
+// Returns false, leaving supported off, without instanced arrays or when the shaders fail.
+bool	createInstancedMesh(const char* vertexShaderFile, const char* fragmentShaderFile, InstancedMesh& im);
+
+// Replace the instances of the frame, orphaning the previous contents of the buffer
+void	uploadInstances(InstancedMesh& im, int numInstances, const InstanceData* instance);
+
+// Draw count copies of the mesh starting from the first instance uploaded,
+// with the fixed-function matrices, light 0 and material.
+void	drawInstances(const InstancedMesh& im, const MeshVBO& vbo, int first, int count);
+
+void	deleteInstancedMesh(InstancedMesh& im);
+
+#endif	// _INSTANCED_MESH_H_
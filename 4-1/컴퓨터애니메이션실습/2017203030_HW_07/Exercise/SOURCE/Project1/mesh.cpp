@@ -1,4 +1,5 @@
-#include <fstream>
+#include "mesh.h"
+#include "offReader.h"
 
 #include <Eigen/Dense>
 using namespace Eigen;
@@ -10,36 +11,18 @@ using namespace std;
 int
 readMesh(const char * filename, MatrixXf& vertex, MatrixXf& normal, ArrayXXi& face)
 {
-	ifstream	is(filename);
-	if (is.fail()) return 0;
+	int nEdges = 0;
+	if (!readOFF(filename, vertex, face, nEdges)) return 0;
 
-	char	magicNumber[256];
-	is >> magicNumber;
+	int nVertices = int(vertex.cols());
+	int nFaces = int(face.cols());
 
-	// # vertices, # faces, # edges
-	int nVertices = 0, nFaces = 0, nEdges = 0;
-	is >> nVertices >> nFaces >> nEdges;
-	cout << "# vertices = " << nVertices << endl;
-	cout << "# faces = " << nFaces << endl;
-
-	// Vertices
-	vertex.resize(3, nVertices);
-	for (int i = 0; i < nVertices; i++)
-		is >> vertex(0, i) >> vertex(1, i) >> vertex(2, i);
-	
 	// Normals
 	normal.resize(3, nVertices);
 	normal.setZero();
 
-	// Faces
-	face.resize(3, nFaces); // Only support triangles
-
-	int n;
 	for (int i = 0; i < nFaces; i++)
 	{
-		is >> n >> face(0, i) >> face(1, i) >> face(2, i);
-		if (n != 3) cout << "# verticesof the " << i << " - th faces - " << n << endl;
-
 		// Normal vector of the face	
 		Vector3f	vl = vertex.col(face(1, i)) - vertex.col(face(0, i));
 		Vector3f	v2 = vertex.col(face(2, i)) - vertex.col(face(0, i));
@@ -62,37 +45,21 @@ readMesh(const char * filename, MatrixXf& vertex, MatrixXf& normal, ArrayXXi& fa
 int
 readMesh(const char* filename, MatrixXf& vertex, ArrayXXi& face, MatrixXf& faceNormal, MatrixXf& normal)
 {
-	ifstream	is(filename);
-	if (is.fail()) return 0;
+	int nEdges = 0;
+	if (!readOFF(filename, vertex, face, nEdges)) return 0;
 
-	char	magicNumber[256];
-	is >> magicNumber;
-
-	// # vertices, # faces, # edges
-	int nVertices = 0, nFaces = 0, nEdges = 0;
-	is >> nVertices >> nFaces >> nEdges;
-	cout << "# vertices = " << nVertices << endl;
-	cout << "# faces = " << nFaces << endl;
-
-	// Vertices
-	vertex.resize(3, nVertices);
-	for (int i = 0; i < nVertices; i++)
-		is >> vertex(0, i) >> vertex(1, i) >> vertex(2, i);
+	int nVertices = int(vertex.cols());
+	int nFaces = int(face.cols());
 
 	// Normals
 	normal.resize(3, nVertices);
 	normal.setZero();
 
-	// Faces
-	face.resize(3, nFaces);			// Only support triangles
+	// Face normals
 	faceNormal.resize(3, nFaces);
 
-	int n;
 	for (int i = 0; i < nFaces; i++)
 	{
-		is >> n >> face(0, i) >> face(1, i) >> face(2, i);
-		if (n != 3) cout << "# vertices of the " << i << " - th faces = " << n << endl;
-
 		// Normal vector of the face
 		Vector3f	v1 = vertex.col(face(1, i)) - vertex.col(face(0, i));
 		Vector3f	v2 = vertex.col(face(2, i)) - vertex.col(face(0, i));
@@ -0,0 +1,34 @@
+#ifndef _MESH_VBO_H_
+#define _MESH_VBO_H_
+
+#include <GL/glew.h>
+
+// Retained mesh for the fixed-function pipeline: the arrays are uploaded once
+// to buffer objects and the whole mesh is drawn with a single call, instead of
+// one glNormal3fv()/glVertex3fv() pair per corner every frame.
+struct MeshVBO
+{
+	GLuint	vertexId;	// Buffer for vertex positions
+	GLuint	normalId;	// Buffer for normal vectors
+	GLuint	indexId;	// Buffer for triangle indices, 0 for the split vertices
+
+	int		numTris;	// # of triangles
+	int		numVertices;	// # of vertices in the buffers
+
+	MeshVBO() { vertexId = 0; normalId = 0; indexId = 0; numTris = 0; numVertices = 0; }
+};
+
+// Smooth shading: shared vertices with the vertex normals, drawn with glDrawElements()
+bool	uploadMeshVBO(int numVertices, const GLfloat* vertex, const GLfloat* normal, int numTris, const GLuint* index,
+	MeshVBO& vbo);
+
+// Flat shading: 3 split vertices per triangle carrying its face normal, drawn with glDrawArrays()
+bool	uploadFlatMeshVBO(const GLfloat* vertex, int numTris, const GLuint* index, const GLfloat* faceNormal,
+	MeshVBO& vbo);
+
+// Draw with the current material and modelview matrix
+void	drawMeshVBO(const MeshVBO& vbo);
+
+void	deleteMeshVBO(MeshVBO& vbo);
+
+#endif	// _MESH_VBO_H_
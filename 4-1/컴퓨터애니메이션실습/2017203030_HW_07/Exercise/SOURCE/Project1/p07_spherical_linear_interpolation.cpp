@@ -1,10 +1,15 @@
 #include "glSetup.h"
+#include "assetLoader.h"
+#include "instancedMesh.h"
 #include "mesh.h"
+#include "meshVBO.h"
 
 #include <Eigen/Dense>
 using namespace Eigen;
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 using namespace std;
 
 #ifdef _WIN32
@@ -20,6 +25,7 @@ void render(GLFWwindow* window);
 void renderEx(GLFWwindow* window);
 void reshape(GLFWwindow* window, int w, int h);
 void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods);
+void benchmarkDrawMesh(GLFWwindow* window, int nFrames = 300);
 
 bool pause = false;
 
@@ -40,13 +46,32 @@ MatrixXf vertex;
 MatrixXf normal;
 ArrayXXi face;
 
+// Retained VBO path, or immediate mode for comparison
+MeshVBO	meshVBO;
+bool	retained = true;
+
+// Mesh parsed in the background, the placeholder drawn until then
+MeshAsset	meshAsset;
+double		loadStart = 0;
+
+void serviceMeshAsset();
+
+// Instanced drawing of the trails
+InstancedMesh	instanced;
+vector<InstanceData>	instances;
+
 
 float timeStep = 1.0f / 120;
 float currTime = 0;
 
 Matrix4f	T;
-Matrix4f	T1[10];
-Matrix4f	T2[10];
+Matrix4f	prevT;		// T of the previous update, blended with T in render()
+float		alpha = 1;	// Fraction of a step since the last update
+
+// Trails of the interpolated copies: rotation matrices and slerp
+int		nTrails = 10;
+vector<Matrix4f, aligned_allocator<Matrix4f> >	T1(nTrails);
+vector<Matrix4f, aligned_allocator<Matrix4f> >	T2(nTrails);
 Quaternionf q1, q2;
 Vector3f	p1, p2;
 
@@ -93,23 +118,18 @@ int main(int argc, char* argv[])
 	cout << endl;
 	init(filename);
 
-	float previous = (float)glfwGetTime();
-	float elapsed = 0;
+	// Fixed time steps, sleeping between the frames
+	FrameScheduler	scheduler;
+	initializeScheduler(scheduler, timeStep);
 
 	while (!glfwWindowShouldClose(window)) {
-		float now = (float)glfwGetTime();
-		float delta = now - previous;
-		previous = now;
-
-		elapsed += delta;
-
-		if (elapsed > timeStep) {
-			if (!pause)
-				update(elapsed);
-			else
-				update(0);
-			elapsed = 0;
-		}
+		int	steps = waitNextFrame(scheduler);
+
+		for (int i = 0; i < steps; i++)
+			update(pause ? 0 : timeStep);
+		alpha = interpolationAlpha(scheduler);
+		serviceMeshAsset();
+
 		if (method == 2)
 			render(window);
 
@@ -124,9 +144,13 @@ int main(int argc, char* argv[])
 			renderEx(window);
 		}
 		
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		swapBuffers(window);
 	}
+	printSchedulerStats(scheduler);
+	finalizeScheduler(scheduler);
+
+	deleteInstancedMesh(instanced);
+	deleteMeshVBO(meshVBO);
 
 	glfwDestroyWindow(window);
 	glfwTerminate();
@@ -136,10 +160,23 @@ int main(int argc, char* argv[])
 void init(const char* filename)
 {
 	cout << "Reading" << filename << endl;
-	readMesh(filename, vertex, normal, face);
+	loadStart = glfwGetTime();
+	loadMeshAsync(filename, meshAsset);
+
+	// Placeholder until the mesh arrives, drawn with a single call every frame
+	createPlaceholderMesh(vertex, normal, face);
+	uploadMeshVBO(int(vertex.cols()), vertex.data(), normal.data(), int(face.cols()), (const GLuint*)face.data(), meshVBO);
+
+	// Per-instance transforms and colors for the trails
+	createInstancedMesh("sv07_instanced.glsl", "sf07_instanced.glsl", instanced);
+
+	cout << "Keyboard Input : r for the retained VBO/immediate mode" << endl;
+	cout << "Keyboard Input : b for the frame rates of both" << endl;
+	cout << "Keyboard Input : up/down for 10 times more/fewer copies in the trails" << endl << endl;
 
 	T.setIdentity();
-	for (int i = 0; i < 10; i++)
+	prevT = T;
+	for (int i = 0; i < nTrails; i++)
 	{
 		T1[i].setIdentity();
 		T2[i].setIdentity();
@@ -172,6 +209,34 @@ void init(const char* filename)
 	cout << "ql -> q3: Angle = " << aa.angle() / M_PI * 180 << " degree,";
 	cout << "Axis = " << aa.axis().transpose() << endl << endl;
 }
+// The mesh parsed by the worker replaces the placeholder. Its upload is the only GL work of the loading.
+void serviceMeshAsset()
+{
+	if (!pollMeshAsset(meshAsset)) return;
+
+	takeMeshAsset(meshAsset, vertex, normal, face);
+
+	deleteMeshVBO(meshVBO);
+	uploadMeshVBO(int(vertex.cols()), vertex.data(), normal.data(), int(face.cols()), (const GLuint*)face.data(), meshVBO);
+
+	cout << "Status: " << meshAsset.filename << " loaded in " << (glfwGetTime() - loadStart) * 1000.0 << " ms" << endl;
+}
+// T alpha of the way from prevT: the rotation matrices of method 2 blended linearly
+// as in rlerp(), the others by slerp as they stay orthonormal
+Matrix4f blendT(float alpha)
+{
+	Matrix4f	M = T;
+	M.block<3, 1>(0, 3) = (1 - alpha) * prevT.block<3, 1>(0, 3) + alpha * T.block<3, 1>(0, 3);
+
+	if (method == 2)
+		M.block<3, 3>(0, 0) = (1 - alpha) * prevT.block<3, 3>(0, 0) + alpha * T.block<3, 3>(0, 0);
+	else {
+		Quaternionf	qa(Matrix3f(prevT.block<3, 3>(0, 0)));
+		Quaternionf	qb(Matrix3f(T.block<3, 3>(0, 0)));
+		M.block<3, 3>(0, 0) = Matrix3f(qa.slerp(alpha, qb));
+	}
+	return M;
+}
 Matrix3f rlerp(float t, Quaternionf& q1, Quaternionf& q2)
 {
 	Matrix3f  R = (1 - t) * Matrix3f(q1) + t * Matrix3f(q2);
@@ -192,19 +257,22 @@ Matrix3f qlerp(float t, Quaternionf& q1, Quaternionf& q2)
 }
 void update(float elapsed)
 {
+	PROFILE_ZONE("update");
+
+	prevT = T;
 	currTime += elapsed;
 
 	int	n = int(currTime / interval);
 	float s = (currTime - n * interval) / interval;
 	float t = (s < 0.5) ? 2 * s : 2 * (1 - s);
 
-	float _t = 0.1;
+	float _t = 1.0f / nTrails;
 
 	Vector3f p = (1 - t) * p1 + t * p2;
 	Vector3f _p;
 	T.block<3, 1>(0, 3) = p;
 
-	for (int i = 0; i < 10; i++)
+	for (int i = 0; i < nTrails; i++)
 	{
 		_p = (1 - _t * i) * p1 + _t * i * p2;
 		T1[i].block<3, 1>(0, 3) = _p;
@@ -237,7 +305,7 @@ void update(float elapsed)
 
 	if (method == 7)
 	{
-		for (int i = 0; i < 10; i++)
+		for (int i = 0; i < nTrails; i++)
 		{
 			T1[i].block<3, 3>(0, 0) = rlerp(_t * i, q1, q2);
 
@@ -260,6 +328,11 @@ void drawMesh()
 	glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, mat_specular);
 	glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, mat_shininess);
 
+	if (retained) {
+		drawMeshVBO(meshVBO);
+		return;
+	}
+
 	glBegin(GL_TRIANGLES);
 	for (int i = 0; i < face.cols(); i++) {
 		glNormal3fv(normal.col(face(0, i)).data());
@@ -285,6 +358,11 @@ void drawWireFrame()
 	//glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, mat_specular);
 	//glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, mat_shininess);
 
+	if (retained) {
+		drawMeshVBO(meshVBO);
+		return;
+	}
+
 	glBegin(GL_TRIANGLES);
 	for (int i = 0; i < face.cols(); i++) {
 		glNormal3fv(normal.col(face(0, i)).data());
@@ -299,6 +377,8 @@ void drawWireFrame()
 
 void render(GLFWwindow* window)
 {
+	PROFILE_GPU_ZONE("render");
+
 	glClearColor(bgColor[0], bgColor[1], bgColor[2], bgColor[3]);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -312,12 +392,49 @@ void render(GLFWwindow* window)
 
 	setupLight();
 	
-	glMultMatrixf(T.data());
+	// Between the last two updates, as the time of the frame falls between them
+	Matrix4f	M = blendT(alpha);
+	glMultMatrixf(M.data());
 	drawMesh();
 }
 
+// Both trails uploaded once per frame, and each drawn with a single instanced call
+void drawTrailsInstanced()
+{
+	GLfloat red[4] = { 0.95f, 0.0f, 0.0f, 1 };
+	GLfloat green[4] = { 0.0f, 0.95f, 0.0f, 1 };
+
+	instances.resize(2 * nTrails);
+	for (int i = 0; i < nTrails; i++) {
+		Map<Matrix4f>(instances[i].transform) = T1[i];
+		Map<Vector4f>(instances[i].color) = Map<Vector4f>(red);
+
+		Map<Matrix4f>(instances[nTrails + i].transform) = T2[i];
+		Map<Vector4f>(instances[nTrails + i].color) = Map<Vector4f>(green);
+	}
+	uploadInstances(instanced, int(instances.size()), instances.data());
+
+	// Material of drawMesh() except the diffuse color of each instance
+	GLfloat mat_ambient[4] = { 0.10f, 0.10f, 0.10f, 1 };
+	GLfloat mat_specular[4] = { 0.10f, 0.10f, 0.10f, 1 };
+	GLfloat mat_shininess = 128;
+
+	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, mat_ambient);
+	glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, mat_specular);
+	glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, mat_shininess);
+
+	// The polygon mode can not change per instance: filled and wireframe trails in two calls
+	glPolygonMode(GL_FRONT, GL_FILL);
+	drawInstances(instanced, meshVBO, 0, nTrails);
+
+	glPolygonMode(GL_FRONT, GL_LINE);
+	drawInstances(instanced, meshVBO, nTrails, nTrails);
+}
+
 void renderEx(GLFWwindow* window)
 {
+	PROFILE_GPU_ZONE("renderEx");
+
 	glClearColor(bgColor[0], bgColor[1], bgColor[2], bgColor[3]);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -331,17 +448,23 @@ void renderEx(GLFWwindow* window)
 
 	setupLight();
 
-	for (int i = 0; i < 10; i++)
+	if (retained && instanced.supported)
 	{
+		drawTrailsInstanced();
+		return;
+	}
+
+	for (int i = 0; i < nTrails; i++)
+	{
+		glPushMatrix();
 		glMultMatrixf(T1[i].data());
 		drawMesh();
-		Matrix4f _T = T1[i].inverse();
-		glMultMatrixf(_T.data());
+		glPopMatrix();
 
+		glPushMatrix();
 		glMultMatrixf(T2[i].data());
 		drawWireFrame();
-		_T = T2[i].inverse();
-		glMultMatrixf(_T.data());
+		glPopMatrix();
 	}
 }
 
@@ -399,7 +522,51 @@ void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
 		case GLFW_KEY_SPACE:
 			pause = !pause;
 			break;
+		case GLFW_KEY_R:
+			retained = !retained;
+			cout << (retained ? "Retained VBO" : "Immediate mode") << endl;
+			break;
+		case GLFW_KEY_B:
+			benchmarkDrawMesh(window);
+			break;
+		case GLFW_KEY_UP:
+		case GLFW_KEY_DOWN:
+			nTrails = (key == GLFW_KEY_UP) ? min(10 * nTrails, 100000) : max(nTrails / 10, 10);
+			T1.assign(nTrails, Matrix4f::Identity());
+			T2.assign(nTrails, Matrix4f::Identity());
+			update(0);
+			cout << "# copies in each trail = " << nTrails << endl;
+			break;
 		}
 	}
 }
 
+// Frame rates of the immediate mode and the retained VBO path drawing the same frames
+void benchmarkDrawMesh(GLFWwindow* window, int nFrames)
+{
+	bool	current = retained;
+	double	fps[2];
+
+	for (int k = 0; k < 2; k++) {
+		retained = (k == 1);
+
+		render(window);		// Warm up
+		glFinish();
+
+		double	t0 = glfwGetTime();
+		for (int i = 0; i < nFrames; i++) {
+			render(window);
+			if (method == 7)
+				renderEx(window);
+			glfwSwapBuffers(window);
+		}
+		glFinish();
+		fps[k] = nFrames / (glfwGetTime() - t0);
+	}
+	retained = current;
+
+	cout << "Benchmark: " << face.cols() << " triangles, " << nFrames << " frames" << endl;
+	cout << "  immediate : " << fps[0] << " fps" << endl;
+	cout << "  retained  : " << fps[1] << " fps" << endl;
+	cout << "  speedup   : " << fps[1] / fps[0] << "x" << endl;
+}
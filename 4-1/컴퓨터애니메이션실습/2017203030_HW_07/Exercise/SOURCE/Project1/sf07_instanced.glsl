@@ -0,0 +1,28 @@
+#version 400 compatibility
+
+in vec3	position;
+in vec3	normal;
+in vec4	color;
+
+out vec4 outColor;
+
+// Blinn-Phong with the fixed-function light 0 and material, the instance color as the diffuse
+void
+main()
+{
+	vec3	N = normalize(normal);
+	if (!gl_FrontFacing) N = -N;
+
+	vec3	L = normalize(gl_LightSource[0].position.xyz - position * gl_LightSource[0].position.w);
+	vec3	V = normalize(-position);
+	vec3	H = normalize(L + V);
+
+	float	lambertian = max(dot(N, L), 0.0);
+	float	specular = (lambertian > 0.0) ? pow(max(dot(N, H), 0.0), gl_FrontMaterial.shininess) : 0.0;
+
+	vec3	c = gl_FrontMaterial.ambient.rgb * gl_LightSource[0].ambient.rgb
+			+ lambertian * color.rgb * gl_LightSource[0].diffuse.rgb
+			+ specular * gl_FrontMaterial.specular.rgb * gl_LightSource[0].specular.rgb;
+
+	outColor = vec4(c, color.a);
+}
@@ -0,0 +1,29 @@
+#version 400 compatibility
+
+layout (location = 0) in vec3	VertexPosition;
+layout (location = 1) in vec3	VertexNormal;
+
+// Per-instance attributes: a column-major transform and a diffuse color
+layout (location = 2) in mat4	InstanceMatrix;		// Locations 2, 3, 4 and 5
+layout (location = 6) in vec4	InstanceColor;
+
+out vec3	position;
+out vec3	normal;
+out vec4	color;
+
+// The view and projection come from the fixed-function matrix stacks.
+void
+main(void)
+{
+	vec4	P = gl_ModelViewMatrix * InstanceMatrix * vec4(VertexPosition, 1.0);
+	gl_Position = gl_ProjectionMatrix * P;
+
+	// View coordinate system. The cofactor matrix transforms the normals
+	// like the inverse transpose, also for the blended rotation matrices.
+	mat3	M = mat3(InstanceMatrix);
+	mat3	C = mat3(cross(M[1], M[2]), cross(M[2], M[0]), cross(M[0], M[1]));
+
+	position = vec3(P);
+	normal = normalize(gl_NormalMatrix * C * VertexNormal);
+	color = InstanceColor;
+}
@@ -1,5 +1,7 @@
 #include "glSetup.h"
+#include "assetLoader.h"
 #include "mesh.h"
+#include "meshVBO.h"
 
 #include <Eigen/Dense>
 using namespace Eigen;
@@ -19,6 +21,7 @@ void update(float elapsed);
 void render(GLFWwindow* window);
 void reshape(GLFWwindow* window, int w, int h);
 void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods);
+void benchmarkDrawMesh(GLFWwindow* window, int nFrames = 300);
 
 bool pause = false;
 
@@ -39,11 +42,23 @@ MatrixXf vertex;
 MatrixXf normal;
 ArrayXXi face;
 
+// Retained VBO path, or immediate mode for comparison
+MeshVBO	meshVBO;
+bool	retained = true;
+
+// Mesh parsed in the background, the placeholder drawn until then
+MeshAsset	meshAsset;
+double		loadStart = 0;
+
+void serviceMeshAsset();
+
 
 float timeStep = 1.0f / 120;
 float currTime = 0;
 
 Matrix4f	T;
+Matrix4f	prevT;		// T of the previous update, blended with T in render()
+float		alpha = 1;	// Fraction of a step since the last update
 Quaternionf q1, q2;
 Vector3f	p1, p2;
 
@@ -89,27 +104,24 @@ int main(int argc, char* argv[])
 	cout << endl;
 	init(filename);
 
-	float previous = (float)glfwGetTime();
-	float elapsed = 0;
+	// Fixed time steps, sleeping between the frames
+	FrameScheduler	scheduler;
+	initializeScheduler(scheduler, timeStep);
 
 	while (!glfwWindowShouldClose(window)) {
-		float now = (float)glfwGetTime();
-		float delta = now - previous;
-		previous = now;
-
-		elapsed += delta;
-
-		if (elapsed > timeStep) {
-			if (!pause)
-				update(elapsed);
-			else
-				update(0);
-			elapsed = 0;
-		}
+		int	steps = waitNextFrame(scheduler);
+
+		for (int i = 0; i < steps; i++)
+			update(pause ? 0 : timeStep);
+		alpha = interpolationAlpha(scheduler);
+		serviceMeshAsset();
 		render(window);
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		swapBuffers(window);
 	}
+	printSchedulerStats(scheduler);
+	finalizeScheduler(scheduler);
+
+	deleteMeshVBO(meshVBO);
 
 	glfwDestroyWindow(window);
 	glfwTerminate();
@@ -119,9 +131,18 @@ int main(int argc, char* argv[])
 void init(const char* filename)
 {
 	cout << "Reading" << filename << endl;
-	readMesh(filename, vertex, normal, face);
+	loadStart = glfwGetTime();
+	loadMeshAsync(filename, meshAsset);
+
+	// Placeholder until the mesh arrives, drawn with a single call every frame
+	createPlaceholderMesh(vertex, normal, face);
+	uploadMeshVBO(int(vertex.cols()), vertex.data(), normal.data(), int(face.cols()), (const GLuint*)face.data(), meshVBO);
+
+	cout << "Keyboard Input : r for the retained VBO/immediate mode" << endl;
+	cout << "Keyboard Input : b for the frame rates of both" << endl << endl;
 
 	T.setIdentity();
+	prevT = T;
 
 	p1 = Vector3f(-1, 0.5, 2);
 	p2 = Vector3f(2, 0.5, -1);
@@ -150,6 +171,34 @@ void init(const char* filename)
 	cout << "ql -> q3: Angle = " << aa.angle() / M_PI * 180 << " degree,";
 	cout << "Axis = " << aa.axis().transpose() << endl << endl;
 }
+// The mesh parsed by the worker replaces the placeholder. Its upload is the only GL work of the loading.
+void serviceMeshAsset()
+{
+	if (!pollMeshAsset(meshAsset)) return;
+
+	takeMeshAsset(meshAsset, vertex, normal, face);
+
+	deleteMeshVBO(meshVBO);
+	uploadMeshVBO(int(vertex.cols()), vertex.data(), normal.data(), int(face.cols()), (const GLuint*)face.data(), meshVBO);
+
+	cout << "Status: " << meshAsset.filename << " loaded in " << (glfwGetTime() - loadStart) * 1000.0 << " ms" << endl;
+}
+// T alpha of the way from prevT: the rotation matrices of method 2 blended linearly
+// as in rlerp(), the others by slerp as they stay orthonormal
+Matrix4f blendT(float alpha)
+{
+	Matrix4f	M = T;
+	M.block<3, 1>(0, 3) = (1 - alpha) * prevT.block<3, 1>(0, 3) + alpha * T.block<3, 1>(0, 3);
+
+	if (method == 2)
+		M.block<3, 3>(0, 0) = (1 - alpha) * prevT.block<3, 3>(0, 0) + alpha * T.block<3, 3>(0, 0);
+	else {
+		Quaternionf	qa(Matrix3f(prevT.block<3, 3>(0, 0)));
+		Quaternionf	qb(Matrix3f(T.block<3, 3>(0, 0)));
+		M.block<3, 3>(0, 0) = Matrix3f(qa.slerp(alpha, qb));
+	}
+	return M;
+}
 Matrix3f rlerp(float t, Quaternionf& q1, Quaternionf& q2)
 {
 	Matrix3f  R = (1 - t) * Matrix3f(q1) + t * Matrix3f(q2);
@@ -170,6 +219,9 @@ Matrix3f qlerp(float t, Quaternionf& q1, Quaternionf& q2)
 }
 void update(float elapsed)
 {
+	PROFILE_ZONE("update");
+
+	prevT = T;
 	currTime += elapsed;
 
 	int	n = int(currTime / interval);
@@ -212,6 +264,11 @@ void drawMesh()
 	glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, mat_specular);
 	glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, mat_shininess);
 
+	if (retained) {
+		drawMeshVBO(meshVBO);
+		return;
+	}
+
 	glBegin(GL_TRIANGLES);
 	for (int i = 0; i < face.cols(); i++) {
 		glNormal3fv(normal.col(face(0, i)).data());
@@ -225,6 +282,8 @@ void drawMesh()
 }
 void render(GLFWwindow* window)
 {
+	PROFILE_GPU_ZONE("render");
+
 	glClearColor(bgColor[0], bgColor[1], bgColor[2], bgColor[3]);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -238,7 +297,9 @@ void render(GLFWwindow* window)
 
 	setupLight();
 
-	glMultMatrixf(T.data());
+	// Between the last two updates, as the time of the frame falls between them
+	Matrix4f	M = blendT(alpha);
+	glMultMatrixf(M.data());
 	drawMesh();
 }
 void setupLight()
@@ -291,6 +352,41 @@ void keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
 		case GLFW_KEY_SPACE:
 			pause = !pause;
 			break;
+		case GLFW_KEY_R:
+			retained = !retained;
+			cout << (retained ? "Retained VBO" : "Immediate mode") << endl;
+			break;
+		case GLFW_KEY_B:
+			benchmarkDrawMesh(window);
+			break;
 		}
 	}
-}
\ No newline at end of file
+}
+
+// Frame rates of the immediate mode and the retained VBO path drawing the same frames
+void benchmarkDrawMesh(GLFWwindow* window, int nFrames)
+{
+	bool	current = retained;
+	double	fps[2];
+
+	for (int k = 0; k < 2; k++) {
+		retained = (k == 1);
+
+		render(window);		// Warm up
+		glFinish();
+
+		double	t0 = glfwGetTime();
+		for (int i = 0; i < nFrames; i++) {
+			render(window);
+			glfwSwapBuffers(window);
+		}
+		glFinish();
+		fps[k] = nFrames / (glfwGetTime() - t0);
+	}
+	retained = current;
+
+	cout << "Benchmark: " << face.cols() << " triangles, " << nFrames << " frames" << endl;
+	cout << "  immediate : " << fps[0] << " fps" << endl;
+	cout << "  retained  : " << fps[1] << " fps" << endl;
+	cout << "  speedup   : " << fps[1] / fps[0] << "x" << endl;
+}
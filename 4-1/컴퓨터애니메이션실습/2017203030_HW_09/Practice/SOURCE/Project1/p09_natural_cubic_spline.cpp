@@ -43,7 +43,7 @@ main(int argc, char* argv[])
     while (!glfwWindowShouldClose(window))
     {
         render(window);             // Draw one frame
-        glfwSwapBuffers(window);    // Swap buffers
+        swapBuffers(window);    // Swap buffers
         glfwPollEvents();           // Events
     }
 
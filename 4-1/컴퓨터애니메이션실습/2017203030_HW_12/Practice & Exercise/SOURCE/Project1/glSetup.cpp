@@ -1,9 +1,19 @@
 #include "glSetup.h"
 
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <iostream>
+#include <vector>
 using namespace std;
 
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>		//timeBeginPeriod() in winmm.lib
+#endif
+
 bool	fullScreen = false;
 bool	noMenuBar = false;
 bool	perspectiveView = true;
@@ -26,6 +36,75 @@ float	fovy = 46.4f;		 		//fovy of 28mm lens in degree
 float	nearDist = 1.0f;
 float	farDist = 20.0f;
 
+bool	headless = false;			//Offscreen rendering without a window system
+int		headlessFrames = 300;		//# frames before closing the window
+
+// Headless backend
+static bool				osmesa = false;			//OSMesa instead of EGL
+static int				headlessW = 1280, headlessH = 720;
+static const char*		headlessOutput = NULL;	//PPM file of the last frame
+static GLuint			fbo = 0, colorRb = 0, depthRb = 0;			//Multisampled target
+static GLuint			resolveFbo = 0, resolveRb = 0;				//Single-sampled copy for the readback
+static vector<unsigned char>	pixels;
+static int				nFrames = 0;
+static double			firstFrameTime = 0;
+
+bool	profiling = false;			//Frame timing, zones and the overlay
+
+// Profiler
+static const int		PROFILE_HISTORY = 240;			//Frames in the histogram and the overlay
+static const int		PROFILE_LATENCY = 3;			//Frames the GPU queries stay in flight
+static const size_t		PROFILE_MAX_EVENTS = 1 << 20;	//Trace events kept for the export
+
+struct ProfileEvent
+{
+	const char*	name;
+	double		begin, end;		//Seconds of glfwGetTime()
+	int			tid;			//1 for the CPU, 2 for the GPU
+};
+
+struct OpenZone
+{
+	const char*	name;
+	double		begin;
+	int			gpuZone;		//Index into the zones of the GPU frame, -1 for a CPU zone
+};
+
+struct GpuZone
+{
+	const char*	name;
+	GLuint		begin, end;		//Timestamp queries
+};
+
+// Queries of a frame, read back PROFILE_LATENCY frames later so that nothing waits for the GPU
+struct GpuFrame
+{
+	vector<GLuint>	queries;	//Pool of timestamp queries
+	int				nUsed;
+	vector<GpuZone>	zones;
+	GLuint			frameQuery;	//GL_TIME_ELAPSED of the whole frame
+	bool			pending;
+	double			cpuBase;	//glfwGetTime() and GL_TIMESTAMP at the beginning of the frame
+	GLint64			gpuBase;
+
+	GpuFrame() { nUsed = 0; frameQuery = 0; pending = false; cpuBase = 0; gpuBase = 0; }
+};
+
+static const char*			traceFile = NULL;		//Chrome trace-event JSON written at the end
+static const char*			windowTitle = "";
+static bool					gpuTimers = false;
+static GpuFrame				gpuFrames[PROFILE_LATENCY];
+static int					frameIndex = 0;
+static double				frameBegin = 0;
+static double				titleTime = 0;
+static int					nDropped = 0;			//GPU frames not ready in time
+static vector<OpenZone>		openZones;
+static vector<ProfileEvent>	events;
+static float				cpuFrameTimes[PROFILE_HISTORY];	//Rings in ms
+static float				gpuFrameTimes[PROFILE_HISTORY];
+static int					nCpuFrameTimes = 0, nGpuFrameTimes = 0;
+static char					overlayText[2][64];		//Percentiles over the graph, refreshed with the title
+
 void
 errorCallback(int error, const char* description)
 {
@@ -59,10 +138,498 @@ reshape(GLFWwindow* window, int w, int h)
 	cerr << " with screeen " << screenW << " x " << screenH << endl;
 }
 
+// Options of the headless mode and the profiler from the command line or the environment
+static void
+parseOptions(int argc, char* argv[])
+{
+	const char*	env = getenv("GL_HEADLESS");
+	if (env && env[0] && strcmp(env, "0") != 0)
+	{
+		headless = true;
+		osmesa = (strcmp(env, "osmesa") == 0);
+	}
+
+	env = getenv("GL_PROFILE");
+	if (env && env[0] && strcmp(env, "0") != 0) profiling = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char*	arg = argv[i];
+		if (strcmp(arg, "--headless") == 0)					headless = true;
+		else if (strncmp(arg, "--headless=", 11) == 0)		{ headless = true; osmesa = (strcmp(arg + 11, "osmesa") == 0); }
+		else if (strncmp(arg, "--size=", 7) == 0)			sscanf(arg + 7, "%dx%d", &headlessW, &headlessH);
+		else if (strncmp(arg, "--frames=", 9) == 0)			headlessFrames = atoi(arg + 9);
+		else if (strncmp(arg, "--output=", 9) == 0)			headlessOutput = arg + 9;
+		else if (strcmp(arg, "--profile") == 0)				profiling = true;
+		else if (strncmp(arg, "--trace=", 8) == 0)			{ profiling = true; traceFile = arg + 8; }
+	}
+
+	if (headlessW < 1) headlessW = 1;
+	if (headlessH < 1) headlessH = 1;
+	if (headlessFrames < 1) headlessFrames = 1;
+}
+
+// Framebuffer object standing in for the window: 4x MSAA like the window,
+// resolved into a single-sampled one for the readback
+static bool
+createHeadlessFramebuffer(int w, int h)
+{
+	GLint	maxSamples = 0;
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+	GLsizei	samples = (maxSamples < 4) ? maxSamples : 4;
+
+	glGenRenderbuffers(1, &colorRb);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorRb);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, w, h);
+
+	glGenRenderbuffers(1, &depthRb);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthRb);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, w, h);
+
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRb);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRb);
+	bool	complete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+	glGenRenderbuffers(1, &resolveRb);
+	glBindRenderbuffer(GL_RENDERBUFFER, resolveRb);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+
+	glGenFramebuffers(1, &resolveFbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, resolveFbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveRb);
+	complete = complete && (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, w, h);
+
+	pixels.resize(size_t(w) * h * 4);
+
+	if (!complete) cerr << "ERROR: Fail in createHeadlessFramebuffer(" << w << ", " << h << ")" << endl;
+	else cerr << "Status: Headless framebuffer " << w << " x " << h << " with " << samples << " samples" << endl;
+	return complete;
+}
+
+// Binary PPM, flipped as the rows of OpenGL go from the bottom
+static void
+saveFrame(const char* filename, int w, int h, const unsigned char* rgba)
+{
+	FILE*	fp = fopen(filename, "wb");
+	if (!fp)
+	{
+		cerr << "ERROR: Fail in opening " << filename << endl;
+		return;
+	}
+
+	fprintf(fp, "P6\n%d %d\n255\n", w, h);
+
+	vector<unsigned char>	row(size_t(w) * 3);
+	for (int y = h - 1; y >= 0; y--)
+	{
+		const unsigned char*	src = rgba + size_t(y) * w * 4;
+		for (int x = 0; x < w; x++)
+		{
+			row[3 * x + 0] = src[4 * x + 0];
+			row[3 * x + 1] = src[4 * x + 1];
+			row[3 * x + 2] = src[4 * x + 2];
+		}
+		fwrite(&row[0], 1, row.size(), fp);
+	}
+	fclose(fp);
+
+	cerr << "Status: Frame saved in " << filename << endl;
+}
+
+// Profiling
+//
+static void
+addEvent(const char* name, double begin, double end, int tid)
+{
+	if (events.size() >= PROFILE_MAX_EVENTS) return;
+
+	ProfileEvent	e = { name, begin, end, tid };
+	events.push_back(e);
+}
+
+static void
+addFrameTime(float* ring, int& n, float ms)
+{
+	ring[n % PROFILE_HISTORY] = ms;
+	n++;
+}
+
+static float
+percentile(const float* ring, int n, float p)
+{
+	int	count = (n < PROFILE_HISTORY) ? n : PROFILE_HISTORY;
+	if (count == 0) return 0;
+
+	vector<float>	sorted(ring, ring + count);
+	size_t	k = size_t(p * (count - 1) + 0.5f);
+	nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+	return sorted[k];
+}
+
+static GLuint
+gpuTimestamp(GpuFrame& f)
+{
+	if (f.nUsed == int(f.queries.size()))
+	{
+		GLuint	q;
+		glGenQueries(1, &q);
+		f.queries.push_back(q);
+	}
+
+	GLuint	q = f.queries[f.nUsed++];
+	glQueryCounter(q, GL_TIMESTAMP);
+	return q;
+}
+
+// Read back the queries of an old frame if they are ready, otherwise drop them
+static void
+resolveGpuFrame(GpuFrame& f)
+{
+	if (!f.pending) return;
+	f.pending = false;
+
+	GLint	available = 0;
+	glGetQueryObjectiv(f.frameQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) { nDropped++; return; }
+
+	GLuint64	elapsed = 0;
+	glGetQueryObjectui64v(f.frameQuery, GL_QUERY_RESULT, &elapsed);
+	addFrameTime(gpuFrameTimes, nGpuFrameTimes, float(elapsed * 1e-6));
+
+	// GPU zones on the CPU timeline, aligned at the beginning of the frame
+	for (size_t i = 0; i < f.zones.size(); i++)
+	{
+		const GpuZone&	z = f.zones[i];
+		if (!z.end) continue;
+
+		GLuint64	b = 0, e = 0;
+		glGetQueryObjectui64v(z.begin, GL_QUERY_RESULT, &b);
+		glGetQueryObjectui64v(z.end, GL_QUERY_RESULT, &e);
+		addEvent(z.name, f.cpuBase + (GLint64(b) - f.gpuBase) * 1e-9, f.cpuBase + (GLint64(e) - f.gpuBase) * 1e-9, 2);
+	}
+}
+
+void
+profileBeginZone(const char* name, bool gpu)
+{
+	if (!profiling) return;
+
+	OpenZone	z = { name, glfwGetTime(), -1 };
+	if (gpu && gpuTimers)
+	{
+		GpuFrame&	f = gpuFrames[frameIndex % PROFILE_LATENCY];
+		GpuZone		g = { name, gpuTimestamp(f), 0 };
+		z.gpuZone = int(f.zones.size());
+		f.zones.push_back(g);
+	}
+	openZones.push_back(z);
+}
+
+void
+profileEndZone()
+{
+	if (!profiling || openZones.empty()) return;
+
+	OpenZone	z = openZones.back();
+	openZones.pop_back();
+
+	if (z.gpuZone >= 0)
+	{
+		GpuFrame&	f = gpuFrames[frameIndex % PROFILE_LATENCY];
+		f.zones[z.gpuZone].end = gpuTimestamp(f);
+	}
+	addEvent(z.name, z.begin, glfwGetTime(), 1);
+}
+
+static void
+beginProfileFrame()
+{
+	// CPU frame time from the beginning of the previous frame, the swap included
+	double	now = glfwGetTime();
+	if (frameIndex > 0) addFrameTime(cpuFrameTimes, nCpuFrameTimes, float((now - frameBegin) * 1000.0));
+	frameBegin = now;
+
+	if (!gpuTimers) return;
+
+	// Reuse the queries of PROFILE_LATENCY frames ago
+	GpuFrame&	f = gpuFrames[frameIndex % PROFILE_LATENCY];
+	resolveGpuFrame(f);
+
+	f.nUsed = 0;
+	f.zones.clear();
+	glGetInteger64v(GL_TIMESTAMP, &f.gpuBase);
+	f.cpuBase = glfwGetTime();
+	glBeginQuery(GL_TIME_ELAPSED, f.frameQuery);
+}
+
+// Seven-segment glyphs, the bits 0 to 6 for the segments a to g:
+// a top, b upper right, c lower right, d bottom, e lower left, f upper left and g middle
+static int
+glyphSegments(char c)
+{
+	switch (c)
+	{
+	case '0': return 0x3F;	case '1': return 0x06;	case '2': return 0x5B;	case '3': return 0x4F;
+	case '4': return 0x66;	case '5': return 0x6D;	case '6': return 0x7D;	case '7': return 0x07;
+	case '8': return 0x7F;	case '9': return 0x6F;	case 'C': return 0x39;	case 'G': return 0x3D;
+	case 'P': return 0x73;	case 'U': return 0x3E;	case '-': return 0x40;
+	default: return 0;
+	}
+}
+
+static void
+clearRect(int x, int y, int w, int h)
+{
+	glScissor(x, y, w, h);
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
+// Digits, '.' and the letters above in strokes of s pixels, 7s high, with scissored clears
+static void
+drawSegmentText(const char* text, int x, int y, int s)
+{
+	int	w = 4 * s;
+	for (const char* c = text; *c; c++)
+	{
+		if (*c == '.')	{ clearRect(x, y, s, s);	x += 2 * s;	continue; }
+		if (*c == ' ')	{ x += 3 * s;	continue; }
+
+		int	g = glyphSegments(*c);
+		if (g & 0x01) clearRect(x, y + 6 * s, w, s);
+		if (g & 0x02) clearRect(x + w - s, y + 3 * s, s, 4 * s);
+		if (g & 0x04) clearRect(x + w - s, y, s, 4 * s);
+		if (g & 0x08) clearRect(x, y, w, s);
+		if (g & 0x10) clearRect(x, y, s, 4 * s);
+		if (g & 0x20) clearRect(x, y + 3 * s, s, 4 * s);
+		if (g & 0x40) clearRect(x, y + 3 * s, w, s);
+		x += w + 2 * s;
+	}
+}
+
+// Bars of the recent CPU frame times from the bottom left with a line at 60 Hz and
+// the CPU and GPU p50/p95/p99 above, drawn by scissored clears so that it works
+// in any context with any program bound
+static void
+drawProfileOverlay()
+{
+	GLboolean	scissor = glIsEnabled(GL_SCISSOR_TEST);
+	GLint		box[4];
+	GLfloat		clearColor[4];
+	glGetIntegerv(GL_SCISSOR_BOX, box);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+
+	int		barW = (dpiScaling > 1) ? int(2 * dpiScaling) : 2;
+	int		maxH = (dpiScaling > 1) ? int(100 * dpiScaling) : 100;
+	float	maxMs = 100.0f / 3;		//Top of the graph
+
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(0, 0, PROFILE_HISTORY * barW, maxH);
+	glClearColor(0, 0, 0, 1);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	int	count = (nCpuFrameTimes < PROFILE_HISTORY) ? nCpuFrameTimes : PROFILE_HISTORY;
+	for (int i = 0; i < count; i++)
+	{
+		float	ms = cpuFrameTimes[(nCpuFrameTimes - count + i) % PROFILE_HISTORY];
+		int		h = (ms < maxMs) ? int(ms / maxMs * maxH) : maxH;
+
+		if (ms < 17)		glClearColor(0.2f, 0.8f, 0.2f, 1);
+		else if (ms < 34)	glClearColor(0.9f, 0.8f, 0.1f, 1);
+		else				glClearColor(0.9f, 0.2f, 0.1f, 1);
+
+		glScissor(i * barW, 0, barW - 1, (h > 0) ? h : 1);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	glClearColor(0.6f, 0.6f, 0.6f, 1);
+	glScissor(0, int(1000.0f / 60 / maxMs * maxH), PROFILE_HISTORY * barW, 1);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// Percentiles in ms, a line per processor on a band above the graph
+	int	s = (dpiScaling > 1) ? int(2 * dpiScaling) : 2;
+	int	nLines = gpuTimers ? 2 : 1;
+
+	glClearColor(0, 0, 0, 1);
+	clearRect(0, maxH, PROFILE_HISTORY * barW, nLines * 10 * s + s);
+	for (int i = 0; i < nLines; i++)
+	{
+		if (i == 0)	glClearColor(0.9f, 0.9f, 0.9f, 1);
+		else		glClearColor(0.5f, 0.8f, 1.0f, 1);
+		drawSegmentText(overlayText[i], s, maxH + (nLines - i) * 10 * s - 8 * s, s);
+	}
+
+	// Restore the state of the demo
+	glScissor(box[0], box[1], box[2], box[3]);
+	if (!scissor) glDisable(GL_SCISSOR_TEST);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+}
+
+static void
+endProfileFrame(GLFWwindow* window)
+{
+	if (gpuTimers)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		gpuFrames[frameIndex % PROFILE_LATENCY].pending = true;
+	}
+
+	// Zones left open are not carried into the next frame.
+	openZones.clear();
+
+	double	now = glfwGetTime();
+	addEvent("frame", frameBegin, now, 1);
+	frameIndex++;
+
+	drawProfileOverlay();
+
+	// Percentiles in the title twice a second
+	if (now - titleTime > 0.5)
+	{
+		char	title[256];
+		snprintf(title, sizeof(title), "%s | CPU p50 %.2f p95 %.2f p99 %.2f ms | GPU p50 %.2f ms", windowTitle,
+			percentile(cpuFrameTimes, nCpuFrameTimes, 0.50f), percentile(cpuFrameTimes, nCpuFrameTimes, 0.95f),
+			percentile(cpuFrameTimes, nCpuFrameTimes, 0.99f), percentile(gpuFrameTimes, nGpuFrameTimes, 0.50f));
+		glfwSetWindowTitle(window, title);
+		titleTime = now;
+
+		snprintf(overlayText[0], sizeof(overlayText[0]), "CPU P50 %.2f P95 %.2f P99 %.2f",
+			percentile(cpuFrameTimes, nCpuFrameTimes, 0.50f), percentile(cpuFrameTimes, nCpuFrameTimes, 0.95f),
+			percentile(cpuFrameTimes, nCpuFrameTimes, 0.99f));
+		snprintf(overlayText[1], sizeof(overlayText[1]), "GPU P50 %.2f P95 %.2f P99 %.2f",
+			percentile(gpuFrameTimes, nGpuFrameTimes, 0.50f), percentile(gpuFrameTimes, nGpuFrameTimes, 0.95f),
+			percentile(gpuFrameTimes, nGpuFrameTimes, 0.99f));
+	}
+}
+
+// Chrome trace-event JSON for chrome://tracing or Perfetto
+static void
+saveTrace(const char* filename)
+{
+	FILE*	fp = fopen(filename, "w");
+	if (!fp)
+	{
+		cerr << "ERROR: Fail in opening " << filename << endl;
+		return;
+	}
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		const ProfileEvent&	e = events[i];
+		fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+			e.name, e.tid, e.begin * 1e6, (e.end - e.begin) * 1e6);
+	}
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+
+	cerr << "Status: Trace of " << events.size() << " events saved in " << filename << endl;
+}
+
+static void
+finishProfile()
+{
+	cout << "Status: Frame time over " << ((nCpuFrameTimes < PROFILE_HISTORY) ? nCpuFrameTimes : PROFILE_HISTORY)
+		<< " frames p50 " << percentile(cpuFrameTimes, nCpuFrameTimes, 0.50f)
+		<< " p95 " << percentile(cpuFrameTimes, nCpuFrameTimes, 0.95f)
+		<< " p99 " << percentile(cpuFrameTimes, nCpuFrameTimes, 0.99f) << " ms" << endl;
+	if (gpuTimers)
+		cout << "Status: GPU time p50 " << percentile(gpuFrameTimes, nGpuFrameTimes, 0.50f)
+			<< " p95 " << percentile(gpuFrameTimes, nGpuFrameTimes, 0.95f)
+			<< " p99 " << percentile(gpuFrameTimes, nGpuFrameTimes, 0.99f) << " ms, "
+			<< nDropped << " frames dropped" << endl;
+
+	if (traceFile) saveTrace(traceFile);
+}
+
+static void
+initializeProfiler(const char* title)
+{
+	windowTitle = title;
+
+	// Timer queries from OpenGL 3.3 or ARB_timer_query
+	gpuTimers = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query);
+	if (gpuTimers)
+		for (int i = 0; i < PROFILE_LATENCY; i++) glGenQueries(1, &gpuFrames[i].frameQuery);
+	else
+		cerr << "Status: No timer queries, profiling the CPU only" << endl;
+
+	beginProfileFrame();
+}
+
+// Resolve and read back the frame as a window system would present it
+static void
+readBackFrame(GLFWwindow* window)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFbo);
+	glBlitFramebuffer(0, 0, headlessW, headlessH, 0, 0, headlessW, headlessH, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, headlessW, headlessH, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	// The first frame is left out of the throughput as it warms up the driver.
+	double	now = glfwGetTime();
+	if (++nFrames == 1) firstFrameTime = now;
+
+	if (nFrames >= headlessFrames)
+	{
+		if (nFrames > 1)
+		{
+			double	ms = (now - firstFrameTime) * 1000.0 / (nFrames - 1);
+			cout << "Status: Headless " << nFrames - 1 << " frames of " << headlessW << " x " << headlessH
+				<< " in " << ms << " ms/frame, " << 1000.0 / ms << " fps" << endl;
+		}
+
+		if (headlessOutput) saveFrame(headlessOutput, headlessW, headlessH, &pixels[0]);
+
+		glfwSetWindowShouldClose(window, GL_TRUE);
+	}
+}
+
+void
+swapBuffers(GLFWwindow* window)
+{
+	if (profiling) endProfileFrame(window);
+
+	if (headless)	readBackFrame(window);
+	else			glfwSwapBuffers(window);
+
+	// The last frame closes the profile.
+	if (profiling)
+	{
+		if (glfwWindowShouldClose(window)) finishProfile();
+		else beginProfileFrame();
+	}
+}
+
 GLFWwindow*
 initializeOpenGL(int argc, char* argv[], GLfloat bgColor[4], bool modern)
 {
 	glfwSetErrorCallback(errorCallback);		////////// 
+
+	// No window system in the headless mode
+	parseOptions(argc, argv);
+	if (headless)
+	{
+#ifdef GLFW_PLATFORM_NULL
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+		cerr << "ERROR: The headless mode requires GLFW 3.4 or later" << endl;
+		return NULL;
+#endif
+	}
+
 	// Init GLFW
 	if (!glfwInit()) exit(EXIT_FAILURE);
 	if (modern)
@@ -82,19 +649,33 @@ initializeOpenGL(int argc, char* argv[], GLfloat bgColor[4], bool modern)
 	glfwWindowHint(GLFW_SAMPLES, 4);	// MSAA
 
 	// Create the window 
-	GLFWmonitor* monitor = glfwGetPrimaryMonitor();
-	int monitorW, monitorH;
-	glfwGetMonitorPhysicalSize(monitor, &monitorW, &monitorH);
-	cerr << "Status: Monitor " << monitorW << "mm x " << monitorH << "mm" << endl;
+	GLFWmonitor* monitor = NULL;
+	if (headless)
+	{
+		// The window only holds the context, which renders into a framebuffer object.
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, osmesa ? GLFW_OSMESA_CONTEXT_API : GLFW_EGL_CONTEXT_API);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		cerr << "Status: Headless with " << (osmesa ? "OSMesa" : "EGL") << endl;
 
-	// Full screen
-	if (fullScreen) screenScale = 1.0;
+		screenW = headlessW;
+		screenH = headlessH;
+	}
+	else
+	{
+		monitor = glfwGetPrimaryMonitor();
+		int monitorW, monitorH;
+		glfwGetMonitorPhysicalSize(monitor, &monitorW, &monitorH);
+		cerr << "Status: Monitor " << monitorW << "mm x " << monitorH << "mm" << endl;
 
-	const GLFWvidmode* videoMode = glfwGetVideoMode(monitor);
-	if (screenW == 0)	screenW = int(videoMode->width * screenScale);
-	if (screenH == 0)	screenH = int(videoMode->height * screenScale);
+		// Full screen
+		if (fullScreen) screenScale = 1.0;
 
-	if (!fullScreen || !noMenuBar) monitor = NULL;
+		const GLFWvidmode* videoMode = glfwGetVideoMode(monitor);
+		if (screenW == 0)	screenW = int(videoMode->width * screenScale);
+		if (screenH == 0)	screenH = int(videoMode->height * screenScale);
+
+		if (!fullScreen || !noMenuBar) monitor = NULL;
+	}
 	GLFWwindow* window = glfwCreateWindow(screenW, screenH, argv[0], monitor, NULL);
 	if (!window)
 	{
@@ -107,10 +688,13 @@ initializeOpenGL(int argc, char* argv[], GLfloat bgColor[4], bool modern)
 	glfwMakeContextCurrent(window);
 
 	// Clear the background ASAP
-	glClearColor(bgColor[0], bgColor[1], bgColor[2], bgColor[3]);
-	glClear(GL_COLOR_BUFFER_BIT);
-	glFlush();
-	glfwSwapBuffers(window);
+	if (!headless)
+	{
+		glClearColor(bgColor[0], bgColor[1], bgColor[2], bgColor[3]);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glFlush();
+		glfwSwapBuffers(window);
+	}
 
 	// Check the size of the window
 
@@ -118,6 +702,7 @@ initializeOpenGL(int argc, char* argv[], GLfloat bgColor[4], bool modern)
 	cerr << "Status: Screeen " << screenW << " x " << screenH << endl;
 
 	glfwGetFramebufferSize(window, &windowW, &windowH);
+	if (headless) { windowW = headlessW; windowH = headlessH; }
 	cerr << "Status: Framebuffer " << windowW << " x " << windowH << endl;
 
 	// DPI scaling
@@ -134,11 +719,15 @@ initializeOpenGL(int argc, char* argv[], GLfloat bgColor[4], bool modern)
 	// Vertical sync ...
 	glfwSwapInterval(vsync);	// 0 for immediate mode (Tearing possible)
 
-	if (modern)
+	if (modern || headless || profiling)
 	{
-		cout << "Status: GLSL " << glGetString(GL_SHADING_LANGUAGE_VERSION) << endl;
+		if (modern) cout << "Status: GLSL " << glGetString(GL_SHADING_LANGUAGE_VERSION) << endl;
 		cerr << "Status: GLEW " << glewGetString(GLEW_VERSION) << endl;
 		GLenum error = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+		// GLEW built for GLX finds no X display, but the core entry points are loaded.
+		if (headless && error == GLEW_ERROR_NO_GLX_DISPLAY) error = GLEW_OK;
+#endif
 		if (error != GLEW_OK)
 		{
 			cerr << "ERROR: " << glewGetErrorString(error) << endl;
@@ -146,6 +735,16 @@ initializeOpenGL(int argc, char* argv[], GLfloat bgColor[4], bool modern)
 		}
 	}
 
+	// The framebuffer object stays bound as the default framebuffer of the demo.
+	if (headless && !createHeadlessFramebuffer(headlessW, headlessH))
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return NULL;
+	}
+
+	if (profiling) initializeProfiler(argv[0]);
+
 	return window;
 }
 
@@ -160,4 +759,103 @@ drawAxes(float l, float w)
 	glColor3f(0, 1, 0);	glVertex3f(0, 0, 0);	glVertex3f(0, l, 0);	// y-axis
 	glColor3f(0, 0, 1);	glVertex3f(0, 0, 0);	glVertex3f(0, 0, l); 	// z-axis
 	glEnd();
-}
\ No newline at end of file
+}
+
+// Frame scheduler
+//
+void
+initializeScheduler(FrameScheduler& fs, double timeStep, double frameInterval)
+{
+	fs = FrameScheduler();
+	fs.timeStep = timeStep;
+	fs.frameInterval = (frameInterval > 0) ? frameInterval : timeStep;
+	fs.maxSteps = (timeStep < 0.1) ? int(0.1 / timeStep) : 1;	//Up to 100ms of updates in a frame
+
+	fs.previous = glfwGetTime();
+	fs.deadline = fs.previous + fs.frameInterval;
+
+#ifdef _WIN32
+	// 1ms sleeps instead of the 15.6ms default
+	if (timeBeginPeriod(1) == TIMERR_NOERROR) fs.timerPeriod = 1;
+#endif
+}
+
+void
+finalizeScheduler(FrameScheduler& fs)
+{
+#ifdef _WIN32
+	if (fs.timerPeriod) timeEndPeriod(fs.timerPeriod);
+#endif
+	fs.timerPeriod = 0;
+}
+
+int
+waitNextFrame(FrameScheduler& fs)
+{
+	// No pacing in the headless mode: a frame interval of simulated time per frame
+	if (headless)
+	{
+		glfwPollEvents();
+		fs.accumulator += fs.frameInterval;
+		int	steps = int(fs.accumulator / fs.timeStep);
+		fs.accumulator -= steps * fs.timeStep;
+		return steps;
+	}
+
+	// Sleep through most of the remaining time, woken early only by the events,
+	// and spin for the last stretch shorter than the timer granularity
+	const double	spinMargin = 0.002;
+	for (;;)
+	{
+		double	remaining = fs.deadline - glfwGetTime();
+		if (remaining <= 0) break;
+		if (remaining > spinMargin) glfwWaitEventsTimeout(remaining - spinMargin);
+	}
+	glfwPollEvents();
+
+	double	now = glfwGetTime();
+	double	interval = now - fs.previous;
+	fs.previous = now;
+
+	// Achieved rate and jitter
+	if (now - fs.deadline > fs.maxLate) fs.maxLate = now - fs.deadline;
+	fs.nFrames++;
+	fs.sumInterval += interval;
+	fs.sumInterval2 += interval * interval;
+
+	// Next deadline on the same grid, or a full interval from now if already missed
+	fs.deadline += fs.frameInterval;
+	if (fs.deadline <= now) fs.deadline = now + fs.frameInterval;
+
+	// Fixed steps due, dropping the time beyond maxSteps after a long stall
+	fs.accumulator += interval;
+	int	steps = int(fs.accumulator / fs.timeStep);
+	if (steps > fs.maxSteps)
+	{
+		steps = fs.maxSteps;
+		fs.accumulator = steps * fs.timeStep;
+	}
+	fs.accumulator -= steps * fs.timeStep;
+
+	return steps;
+}
+
+float
+interpolationAlpha(const FrameScheduler& fs)
+{
+	return float(fs.accumulator / fs.timeStep);
+}
+
+void
+printSchedulerStats(const FrameScheduler& fs)
+{
+	if (fs.nFrames == 0) return;
+
+	double	mean = fs.sumInterval / fs.nFrames;
+	double	variance = fs.sumInterval2 / fs.nFrames - mean * mean;
+	double	jitter = (variance > 0) ? sqrt(variance) : 0;
+
+	cout << "Status: " << fs.nFrames << " frames at " << 1.0 / mean << " fps"
+		<< " (target " << 1.0 / fs.frameInterval << "), jitter " << jitter * 1000.0 << " ms"
+		<< ", late at most " << fs.maxLate * 1000.0 << " ms" << endl;
+}
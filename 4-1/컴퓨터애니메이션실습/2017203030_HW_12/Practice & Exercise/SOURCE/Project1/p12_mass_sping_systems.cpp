@@ -120,33 +120,24 @@ main(int argc, char* argv[])
 	init();
 	initializeParticleSystem();
 
-	// Main loop
-	float	previous = (float)glfwGetTime();
-	float	elapsed = 0;
+	// Main loop: fixed time steps, sleeping until the next frame
+	FrameScheduler	scheduler;
+	initializeScheduler(scheduler, timeStep);
 
 	while (!glfwWindowShouldClose(window))
 	{
-		glfwPollEvents();	// Events
-
-		// Time	passed during a single loop
-		float now = (float)glfwGetTime();
-		float delta = now - previous;
-		previous = now;
-
-		// Time passed after the previous frame
-		elapsed += delta;
+		// Events and the number of time steps due
+		int	steps = waitNextFrame(scheduler);
 
 		// Deal with the current frame
-		if (elapsed > timeStep)
-		{
-			if (!pause) update(elapsed);
-
-			elapsed = 0;	// Rest the elapsed time
-		}
+		if (!pause)
+			for (int i = 0; i < steps; i++) update(timeStep);
 
 		render(window);				// Draw one frame
-		glfwSwapBuffers(window);	// Swap buffers
+		swapBuffers(window);	// Swap buffers
 	}
+	printSchedulerStats(scheduler);
+	finalizeScheduler(scheduler);
 
 	// Finalization
 	quit();
@@ -222,6 +213,8 @@ quit()
 void
 update(float delta_t)
 {
+	PROFILE_ZONE("update");
+
 	// Solve ordinary differential equation	
 	for (int i = 0; i < N_SUBSTEPS; i++)
 	{
@@ -331,6 +324,8 @@ collisionHandling()
 void
 render(GLFWwindow* window)
 {
+	PROFILE_GPU_ZONE("render");
+
 	// Background color
 	glClearColor(bgColor[0], bgColor[1], bgColor[2], bgColor[3]);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
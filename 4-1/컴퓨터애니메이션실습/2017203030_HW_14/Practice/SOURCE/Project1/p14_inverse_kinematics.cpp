@@ -106,7 +106,7 @@ main(int argc, char* argv[])
 		}
 
 		render(window);				// Draw one frame
-		glfwSwapBuffers(window);	// Swap buffers
+		swapBuffers(window);	// Swap buffers
 		glfwPollEvents();			// Events
 	}
 